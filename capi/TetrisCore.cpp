@@ -0,0 +1,329 @@
+#include "TetrisCore.h"
+
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisMoveGen.h"
+#include "TetrisRandom.h"
+#include "Tetrimino.h"
+
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+
+static_assert(TETRIS_BOARD_WIDTH == TABLE_WIDTH_TILES && TETRIS_BOARD_HEIGHT == TABLE_HEIGHT_TILES, "board size of the C API");
+static_assert(TETRIS_NEXT_PIECES == CNT_NEXT_PIECES, "NEXT queue of the C API");
+static_assert(TETRIS_MAX_PLACEMENTS == TetrisMoveGen::MAX_MOVES, "placements of the C API");
+static_assert(TETRIS_MOVE_LEFT == 1 << ACTION_MOVE_LEFT && TETRIS_MOVE_RIGHT == 1 << ACTION_MOVE_RIGHT
+              && TETRIS_ROT_LEFT == 1 << ACTION_ROT_LEFT && TETRIS_ROT_RIGHT == 1 << ACTION_ROT_RIGHT
+              && TETRIS_SOFT_DROP == 1 << ACTION_SOFT_DROP && TETRIS_HARD_DROP == 1 << ACTION_HARD_DROP
+              && TETRIS_HOLD == 1 << ACTION_HOLD, "action bits of the C API");
+static_assert((int)TETRIS_RANDOMIZER_PURE == (int)RANDOMIZER_PURE && (int)CNT_RANDOMIZERS == TETRIS_RANDOMIZER_PURE + 1, "randomizers of the C API");
+static_assert(sizeof(tetris_placement) == sizeof(TetroPlacement)
+              && offsetof(tetris_placement, type) == offsetof(TetroPlacement, nType)
+              && offsetof(tetris_placement, rotation) == offsetof(TetroPlacement, nRot)
+              && offsetof(tetris_placement, x) == offsetof(TetroPlacement, x)
+              && offsetof(tetris_placement, y) == offsetof(TetroPlacement, y), "placements of the C API");
+
+
+
+//=======================
+//  A game of the C API: the engine, and the buffers of the move generator
+//=======================
+struct tetris_core
+{
+    tetris_core(const TetrisRules& rules, uint64_t seed, const TetrisRandomizer* pRandomizer)
+    : m_Rules(rules)
+    , m_pRandomizer(pRandomizer)
+    , m_Engine(rules, seed, pRandomizer)
+    {
+    }
+
+    TetrisRules m_Rules;
+    const TetrisRandomizer* m_pRandomizer;
+    TetrisEngine m_Engine;
+
+    TetrisMoveGen m_MoveGen;
+    TetrisMove m_Moves[TetrisMoveGen::MAX_MOVES];
+    TetrisAction m_Path[TetrisMoveGen::CNT_NODES];
+};
+
+
+namespace
+{
+    // a snapshot: this header, then the engine state
+    struct SnapshotHeader
+    {
+        uint32_t nMagic;
+        uint32_t nSize;
+    };
+
+    const uint32_t SNAPSHOT_MAGIC = 0x53534354;        // "TCSS"
+    // the config of ABI version 1 (the fields added later are read only if struct_size holds them)
+    const size_t CONFIG_SIZE_V1 = offsetof(tetris_config, randomizer) + sizeof(int32_t);
+    const size_t SNAPSHOT_SIZE = sizeof(SnapshotHeader) + sizeof(TetrisEngineState);
+
+
+    void SpawnPending(TetrisEngine& engine)
+    {
+        TetrisInput noInput;
+        if (engine.IsSpawnPending())
+            engine.UpdateGame(noInput, 0);
+    }
+
+    // HOLD, if it is allowed; false otherwise
+    bool PressHold(TetrisEngine& engine)
+    {
+        if (!engine.IsHoldAllowed())
+            return false;
+        TetrisInput input;
+        input.Set(ACTION_HOLD, true, false);
+        engine.UpdateGame(input, 0);
+        return true;
+    }
+
+    TetroPlacement ToPlacement(const tetris_placement& placement)
+    {
+        TetroPlacement p;
+        memcpy(&p, &placement, sizeof(p));
+        return p;
+    }
+
+    bool IsValid(const tetris_placement& placement)
+    {
+        return placement.type >= 0 && placement.type < CNT_TETRIMINOS
+            && placement.rotation >= 0 && placement.rotation < CNT_ROTATIONS;
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  GAME
+/////////////////////////////////////////////
+
+uint32_t tetris_abi_version(void)
+{
+    return TETRISCORE_ABI_VERSION;
+}
+
+
+tetris_core* tetris_create(uint64_t seed, const tetris_config* config)
+{
+    TetrisRules rules = { 1, 0, 0, 0 };
+    RandomizerType randomizer = RANDOMIZER_7_BAG;
+    if (config != nullptr)
+    {
+        if (config->struct_size < CONFIG_SIZE_V1)
+            return nullptr;
+        if (config->start_level < 1 || config->auto_repeat_delay_ms < 0 || config->auto_repeat_speed_ms < 0
+            || config->gravity < 0 || config->randomizer < 0 || config->randomizer >= CNT_RANDOMIZERS)
+            return nullptr;
+        rules.nStartLevel = config->start_level;
+        rules.nDelayAutoRepeatMs = config->auto_repeat_delay_ms;
+        rules.nSpeedAutoRepeatMs = config->auto_repeat_speed_ms;
+        rules.nGravity = config->gravity;
+        randomizer = (RandomizerType)config->randomizer;
+    }
+    // (no exception crosses the C API)
+    return new (nothrow) tetris_core(rules, seed, GetRandomizer(randomizer));
+}
+
+
+void tetris_destroy(tetris_core* game)
+{
+    delete game;
+}
+
+
+void tetris_reset(tetris_core* game, uint64_t seed)
+{
+    game->m_Engine = TetrisEngine(game->m_Rules, seed, game->m_pRandomizer);
+}
+
+
+int32_t tetris_step(tetris_core* game, uint32_t pressed, uint32_t held, int32_t ticks)
+{
+    TetrisEngine& engine = game->m_Engine;
+    TetrisInput input;
+    input.nPressed = (uint8_t)(pressed & ((1 << CNT_ACTIONS) - 1));
+    input.nHeld = (uint8_t)(held & ((1 << CNT_ACTIONS) - 1));
+    int32_t score = engine.GetScore();
+    engine.UpdateGame(input, (ticks > 0) ? ticks : 0);
+    return engine.GetScore() - score;
+}
+
+
+
+/////////////////////////////////////////////
+//  PLACEMENTS
+/////////////////////////////////////////////
+
+int32_t tetris_get_placements(tetris_core* game, int32_t hold, tetris_placement* placements, int32_t max_placements)
+{
+    SpawnPending(game->m_Engine);
+    if (game->m_Engine.IsGameOver())
+        return 0;
+
+    // (HOLD is tried on a copy of the engine: the game does not change)
+    TetrisEngine engine = game->m_Engine;
+    if (hold != 0 && (!PressHold(engine) || engine.IsGameOver()))
+        return 0;
+    int32_t cntMoves = game->m_MoveGen.Generate(engine.GetBoard(), engine.GetCurrentPiece(), game->m_Moves,
+                                                (max_placements < TETRIS_MAX_PLACEMENTS) ? max_placements : TETRIS_MAX_PLACEMENTS);
+    for (int32_t i = 0; i < cntMoves; i++) {
+        memcpy(&placements[i], &game->m_Moves[i].placement, sizeof(tetris_placement));
+    }
+    return cntMoves;
+}
+
+
+int32_t tetris_place(tetris_core* game, int32_t hold, const tetris_placement* placement)
+{
+    TetrisEngine& engine = game->m_Engine;
+    if (engine.IsGameOver() || !IsValid(*placement))
+        return -1;
+
+    // the move to the placement (on a copy of the engine, in case it can't be reached;
+    // the game over of the spawn is kept)
+    TetrisEngine played = engine;
+    SpawnPending(played);
+    if (played.IsGameOver()) {
+        engine = played;
+        return -1;
+    }
+    if (hold != 0 && (!PressHold(played) || played.IsGameOver()))
+        return -1;
+    TetrisMoveGen& moveGen = game->m_MoveGen;
+    int32_t cntMoves = moveGen.Generate(played.GetBoard(), played.GetCurrentPiece(), game->m_Moves, TetrisMoveGen::MAX_MOVES);
+    int32_t moveIdx = TetrisMoveGen::FindMove(ToPlacement(*placement), game->m_Moves, cntMoves);
+    if (moveIdx < 0)
+        return -1;
+
+    // play it as the bots do: through the engine input, then the time of the lines animation runs
+    // (only: the next piece spawns in the next call, before any time runs)
+    int32_t score = engine.GetScore();
+    TetrisBotPlayer::PlayPath(played, game->m_Path, moveGen.GetPath(game->m_Moves[moveIdx], game->m_Path, TetrisMoveGen::CNT_NODES));
+    TetrisBotPlayer::PlayLinesAnimation(played);
+    engine = played;
+    return engine.GetScore() - score;
+}
+
+
+
+/////////////////////////////////////////////
+//  SNAPSHOTS
+/////////////////////////////////////////////
+
+size_t tetris_snapshot_size(void)
+{
+    return SNAPSHOT_SIZE;
+}
+
+
+void tetris_snapshot(const tetris_core* game, void* buffer)
+{
+    SnapshotHeader header = { SNAPSHOT_MAGIC, (uint32_t)SNAPSHOT_SIZE };
+    uint8_t* pBuffer = static_cast<uint8_t*>(buffer);
+    memcpy(pBuffer, &header, sizeof(header));
+    memcpy(pBuffer + sizeof(header), &game->m_Engine.GetState(), sizeof(TetrisEngineState));
+}
+
+
+int32_t tetris_restore(tetris_core* game, const void* buffer, size_t size)
+{
+    const uint8_t* pBuffer = static_cast<const uint8_t*>(buffer);
+    SnapshotHeader header;
+    if (size < SNAPSHOT_SIZE)
+        return -1;
+    memcpy(&header, pBuffer, sizeof(header));
+    if (header.nMagic != SNAPSHOT_MAGIC || header.nSize != SNAPSHOT_SIZE)
+        return -1;
+    // (the buffer of the caller may not be aligned)
+    TetrisEngineState state;
+    memcpy(&state, pBuffer + sizeof(header), sizeof(state));
+    game->m_Engine.RestoreState(state);
+    return 0;
+}
+
+
+uint64_t tetris_state_hash(const tetris_core* game)
+{
+    return game->m_Engine.GetStateHash();
+}
+
+
+
+/////////////////////////////////////////////
+//  GAME STATE
+/////////////////////////////////////////////
+
+void tetris_get_board(const tetris_core* game, int8_t* cells)
+{
+    for (int32_t y = 0; y < TABLE_HEIGHT_TILES; y++) {
+        for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+            cells[y * TABLE_WIDTH_TILES + x] = game->m_Engine.GetBoardTile(x, y);
+        }
+    }
+}
+
+
+void tetris_get_rows(const tetris_core* game, uint16_t* rows)
+{
+    const TetrisBoard& board = game->m_Engine.GetBoard();
+    for (int32_t y = 0; y < TABLE_HEIGHT_TILES; y++) {
+        rows[y] = board.GetRowMask(y);
+    }
+}
+
+
+int32_t tetris_get_current(const tetris_core* game, tetris_placement* placement)
+{
+    const TetrisEngine& engine = game->m_Engine;
+    if (engine.IsSpawnPending() || engine.IsGameOver())
+        return 0;
+    memcpy(placement, &engine.GetCurrentPiece().getPlacement(), sizeof(tetris_placement));
+    return 1;
+}
+
+
+void tetris_get_cells(const tetris_placement* placement, int32_t* x, int32_t* y)
+{
+    if (!IsValid(*placement))
+        return;
+    Tetrimino piece(ToPlacement(*placement));
+    for (int8_t t = 0; t < 4; t++) {
+        x[t] = piece.getX(t);
+        y[t] = piece.getY(t);
+    }
+}
+
+
+int32_t tetris_get_queue(const tetris_core* game, int8_t* types, int32_t max_pieces)
+{
+    int32_t cntPieces = (max_pieces < CNT_NEXT_PIECES) ? max_pieces : CNT_NEXT_PIECES;
+    for (int32_t i = 0; i < cntPieces; i++) {
+        types[i] = game->m_Engine.GetNextPiece(i).getTypeIndex();
+    }
+    return (cntPieces > 0) ? cntPieces : 0;
+}
+
+
+int32_t tetris_get_held(const tetris_core* game)
+{
+    return game->m_Engine.IsPieceHeld() ? game->m_Engine.GetHeldPiece().getTypeIndex() : -1;
+}
+
+
+int32_t tetris_is_hold_allowed(const tetris_core* game)
+{
+    return game->m_Engine.IsHoldAllowed() ? 1 : 0;
+}
+
+
+int32_t tetris_get_score(const tetris_core* game)      { return game->m_Engine.GetScore(); }
+int32_t tetris_get_lines(const tetris_core* game)      { return game->m_Engine.GetLines(); }
+int32_t tetris_get_level(const tetris_core* game)      { return game->m_Engine.GetLevel(); }
+int32_t tetris_is_game_over(const tetris_core* game)   { return game->m_Engine.IsGameOver() ? 1 : 0; }
@@ -0,0 +1,149 @@
+#ifndef TETRISCORE_H
+#define TETRISCORE_H
+
+//=======================
+//  libtetriscore: C API of the simulation core (TetrisEngine, TetrisMoveGen),
+//  for tools and bots written in other languages (ctypes, cffi, FFI, ...).
+//  The library has no dependency on the olcPixelGameEngine, X11 or GL.
+//
+//  A tetris_core is one game; it is used by one thread at a time (different
+//  games can run on different threads). The functions never throw, and
+//  nothing is allocated after tetris_create().
+//  The ABI is stable: functions and fields are only ever added, and
+//  TETRISCORE_ABI_VERSION changes if that is not possible.
+//
+//  Coordinates: x = column (0..9, left to right), y = row (0..19, top to
+//  bottom) of the visible board. Piece types are 0..6, -1 for none.
+//=======================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifdef TETRISCORE_BUILD
+#define TETRISCORE_API __declspec(dllexport)
+#else
+#define TETRISCORE_API __declspec(dllimport)
+#endif
+#else
+#define TETRISCORE_API __attribute__((visibility("default")))
+#endif
+
+#define TETRISCORE_ABI_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct tetris_core tetris_core;
+
+enum
+{
+    TETRIS_BOARD_WIDTH = 10,
+    TETRIS_BOARD_HEIGHT = 20,
+    TETRIS_NEXT_PIECES = 3,
+    // no piece has more placements than this (a buffer of this size never runs short)
+    TETRIS_MAX_PLACEMENTS = 2048
+};
+
+// Action bits, for tetris_step()
+enum
+{
+    TETRIS_MOVE_LEFT = 1 << 0,
+    TETRIS_MOVE_RIGHT = 1 << 1,
+    TETRIS_ROT_LEFT = 1 << 2,
+    TETRIS_ROT_RIGHT = 1 << 3,
+    TETRIS_SOFT_DROP = 1 << 4,
+    TETRIS_HARD_DROP = 1 << 5,
+    TETRIS_HOLD = 1 << 6
+};
+
+// Piece randomizers
+enum
+{
+    TETRIS_RANDOMIZER_7_BAG,
+    TETRIS_RANDOMIZER_14_BAG,
+    TETRIS_RANDOMIZER_TGM_HISTORY,
+    TETRIS_RANDOMIZER_PURE
+};
+
+// Settings of a game (tetris_create() with NULL: level 1, no auto-repeat, gravity of the level, 7-bag).
+// struct_size is sizeof(tetris_config) as the caller was built: the fields added in later versions
+// (after the last one) are only read if they are within it, and take their defaults otherwise.
+typedef struct tetris_config
+{
+    uint32_t struct_size;
+    int32_t start_level;
+    int32_t auto_repeat_delay_ms;
+    int32_t auto_repeat_speed_ms;
+    int32_t gravity;                // fixed gravity, in 1/65536 rows per millisecond (0: gravity of the level)
+    int32_t randomizer;             // TETRIS_RANDOMIZER_xxx
+} tetris_config;
+
+// Where a piece is: its type, rotation (0..3) and offset from the spawn position
+typedef struct tetris_placement
+{
+    int8_t type;
+    int8_t rotation;
+    int8_t x;
+    int8_t y;
+} tetris_placement;
+
+
+TETRISCORE_API uint32_t tetris_abi_version(void);
+
+// A new game (NULL if the config is not valid, or struct_size is too small); the seed draws the pieces
+TETRISCORE_API tetris_core* tetris_create(uint64_t seed, const tetris_config* config);
+TETRISCORE_API void tetris_destroy(tetris_core* game);
+// Starts a new game, with the same config
+TETRISCORE_API void tetris_reset(tetris_core* game, uint64_t seed);
+
+// Runs the game for some time (milliseconds), with the actions pressed at the start of it,
+// and those held down (for the auto-repeat and the soft drop); returns the score gained
+TETRISCORE_API int32_t tetris_step(tetris_core* game, uint32_t pressed, uint32_t held, int32_t ticks);
+
+// The placements where the current piece can lock (or, with hold != 0, the piece which
+// comes out of HOLD), one for each set of cells; returns their count (at most
+// max_placements). The next piece is spawned first, if it is pending.
+TETRISCORE_API int32_t tetris_get_placements(tetris_core* game, int32_t hold,
+                                             tetris_placement* placements, int32_t max_placements);
+// Plays a piece: HOLD first if hold != 0, then the moves to the placement, a hard drop, and the
+// time of the line clear animation (the next piece is left to spawn, without any time running,
+// in the next call); returns the score gained, or -1 if the placement can't be reached (the game
+// is unchanged) or the game is over
+TETRISCORE_API int32_t tetris_place(tetris_core* game, int32_t hold, const tetris_placement* placement);
+
+// Snapshots of the whole game, in buffers of tetris_snapshot_size() bytes (only valid for
+// the same build of the library); tetris_restore() returns 0, or -1 if it is not a snapshot
+TETRISCORE_API size_t tetris_snapshot_size(void);
+TETRISCORE_API void tetris_snapshot(const tetris_core* game, void* buffer);
+TETRISCORE_API int32_t tetris_restore(tetris_core* game, const void* buffer, size_t size);
+// Hash of the position (the board, the current piece, NEXT and HOLD)
+TETRISCORE_API uint64_t tetris_state_hash(const tetris_core* game);
+
+// The locked tiles: cells[TETRIS_BOARD_HEIGHT * TETRIS_BOARD_WIDTH], top row first (piece type, or -1)
+TETRISCORE_API void tetris_get_board(const tetris_core* game, int8_t* cells);
+// The locked tiles as row masks: rows[TETRIS_BOARD_HEIGHT], top row first (bit x = column x)
+TETRISCORE_API void tetris_get_rows(const tetris_core* game, uint16_t* rows);
+// The falling piece: returns 0 if there is none (it is about to spawn, or the game is over)
+TETRISCORE_API int32_t tetris_get_current(const tetris_core* game, tetris_placement* placement);
+// The tiles of a piece: x[4], y[4] (rows above the board are negative)
+TETRISCORE_API void tetris_get_cells(const tetris_placement* placement, int32_t* x, int32_t* y);
+// The NEXT pieces (types): returns their count (at most max_pieces)
+TETRISCORE_API int32_t tetris_get_queue(const tetris_core* game, int8_t* types, int32_t max_pieces);
+// The piece in HOLD, or -1; and whether HOLD can be used by the current piece
+TETRISCORE_API int32_t tetris_get_held(const tetris_core* game);
+TETRISCORE_API int32_t tetris_is_hold_allowed(const tetris_core* game);
+
+TETRISCORE_API int32_t tetris_get_score(const tetris_core* game);
+TETRISCORE_API int32_t tetris_get_lines(const tetris_core* game);
+TETRISCORE_API int32_t tetris_get_level(const tetris_core* game);
+TETRISCORE_API int32_t tetris_is_game_over(const tetris_core* game);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TETRISCORE_H
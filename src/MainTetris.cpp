@@ -1,9 +1,10 @@
 #include "olcPixelGameEngine.h"
-#include "TetrisEngine.h"
+#include "TetrisFrontend.h"
 #include "TetrisConstants.h"
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <cmath>
 
 using namespace std;
@@ -106,7 +107,8 @@ namespace {
         GAME_OVER_MENU,
         GAME_RESUME_COUNTDOWN,
         GAME_HELP_SCREEN,
-        GAME_RUNNING
+        GAME_RUNNING,
+        GAME_REPLAY
     };
 
     // Key names
@@ -134,6 +136,13 @@ namespace {
     // Maximum high score entries
     const int32_t MAX_HIGH_SCORES = 6;
 
+    // Directory of the replays (one file per game)
+    const char* REPLAY_DIRECTORY = "replays";
+
+    // Speeds of the replay viewer (times real time)
+    const int32_t REPLAY_SPEEDS[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+    const int32_t CNT_REPLAY_SPEEDS = (int32_t)(sizeof(REPLAY_SPEEDS) / sizeof(REPLAY_SPEEDS[0]));
+
     // Auto-repeat adjustment values
     const int32_t AUTO_REPEAT_MIN = 10;
     const int32_t AUTO_REPEAT_MAX = 500;
@@ -179,13 +188,14 @@ class TetrisGame : public olc::PixelGameEngine
 {
 private:
     // The Game
-    TetrisEngine* m_pTetris;
+    TetrisFrontend* m_pTetris;
 
     // Settings
     TetrisSettings m_Settings;
 
     // Game State flags
     GameState m_nGameState;
+    bool m_bDemoMode;       // the AI plays the game
 
     // Game Over scores
     int32_t m_nGameOverScore;
@@ -199,17 +209,28 @@ private:
     // High Scores
     HighScore m_HighScores[MAX_HIGH_SCORES];
 
+    // Replay viewer: the replay files, the one shown, and how it plays
+    vector<string> m_ReplayFiles;
+    int32_t m_nReplayIndex;
+    int32_t m_nReplaySpeedIdx;
+    bool m_bReplayPaused;
+
 public:
     TetrisGame()
         : m_pTetris(nullptr)
         , m_Settings()
         , m_nGameState(GameState::GAME_MAIN_MENU)
+        , m_bDemoMode(false)
         , m_nGameOverScore(0)
         , m_nGameOverLevel(0)
         , m_nGameOverLines(0)
         , m_pBackgroundSprite(nullptr)
         , m_pTilesSprite(nullptr)
         , m_HighScores {}
+        , m_ReplayFiles()
+        , m_nReplayIndex(0)
+        , m_nReplaySpeedIdx(0)
+        , m_bReplayPaused(false)
     {}
 
     bool OnUserCreate() override
@@ -307,6 +328,7 @@ public:
 
     bool OnUserDestroy() override
     {
+        EndGame();
         delete m_pTilesSprite;
         delete m_pBackgroundSprite;
         return true;
@@ -357,6 +379,9 @@ public:
         case GameState::GAME_RUNNING:
             UpdateGameIsRunning(fElapsedTime);
             break;
+        case GameState::GAME_REPLAY:
+            UpdateReplayViewer(fElapsedTime);
+            break;
         default:
             // OOPS unknown state
             m_nGameState = GameState::GAME_MAIN_MENU;
@@ -384,10 +409,7 @@ private:
         static bool bExitConfirmation = false;
 
         // clean up any left-over game
-        if (m_pTetris != nullptr) {
-            delete m_pTetris;
-            m_pTetris = nullptr;
-        }
+        EndGame();
 
         // Draw main menu
         DrawString(TABLE_START_X +  9, TABLE_START_Y + 10, "T", DARK_RED, 2);
@@ -404,8 +426,8 @@ private:
         DrawString(TABLE_START_X + 95, TABLE_START_Y + 11, "S", MAGENTA, 2);
         // Draw menu entries
         DrawMenuEntries(TABLE_START_X + 11, TABLE_START_Y + 51,
-                        {"Start game", "Level:", "Options", "How to play", "Exit game"});
-        DrawString(TABLE_START_X + 64, TABLE_START_Y + 65, to_string(m_Settings.nStartLevel), YELLOW);
+                        {"Start game", "Level:", "Options", "How to play", "Demo autoplay", "Watch replays", "Exit game"}, 13);
+        DrawString(TABLE_START_X + 64, TABLE_START_Y + 64, to_string(m_Settings.nStartLevel), YELLOW);
         // Draw high scores
         DisplayHighScores();
 
@@ -425,8 +447,24 @@ private:
         // Check keys
         if (GetKey(Key::S).bPressed) {
             // start game
+            m_bDemoMode = false;
             m_nGameState = GameState::GAME_RESUME_COUNTDOWN;
         }
+        else if (GetKey(Key::D).bPressed) {
+            // start a game played by the AI
+            m_bDemoMode = true;
+            m_nGameState = GameState::GAME_RESUME_COUNTDOWN;
+        }
+        else if (GetKey(Key::W).bPressed) {
+            // replay viewer, from the last game
+            m_ReplayFiles = ListReplayFiles(REPLAY_DIRECTORY);
+            if (!m_ReplayFiles.empty()) {
+                m_nReplayIndex = (int32_t)m_ReplayFiles.size() - 1;
+                m_nReplaySpeedIdx = 0;
+                m_bReplayPaused = false;
+                m_nGameState = GameState::GAME_REPLAY;
+            }
+        }
         else if (GetKey(Key::L).bPressed) {
             // change level
             m_Settings.nStartLevel = (m_Settings.nStartLevel / 5 + 1) * 5;
@@ -754,6 +792,17 @@ private:
     }
 
 
+    // Cleans up the game (if any), keeping its replay
+    void EndGame()
+    {
+        if (m_pTetris == nullptr)
+            return;
+        m_pTetris->SaveReplay(REPLAY_DIRECTORY);
+        delete m_pTetris;
+        m_pTetris = nullptr;
+    }
+
+
     // Game loop for RUNNING GAME
     void UpdateGameIsRunning(float fElapsedTime)
     {
@@ -761,7 +810,7 @@ private:
 
         // init game if not yet initialized
         if (m_pTetris == nullptr) {
-            m_pTetris = new TetrisEngine(this, m_pTilesSprite, m_Settings);
+            m_pTetris = new TetrisFrontend(this, m_pTilesSprite, m_Settings, m_bDemoMode);
         }
 
         // check for pause key OR lost focus
@@ -781,11 +830,10 @@ private:
             m_nGameOverLines = m_pTetris->GetLines();
             m_nGameState = GameState::GAME_OVER_MENU;
             // clean up game
-            delete m_pTetris;
-            m_pTetris = nullptr;
-            // update high scores
+            EndGame();
+            // update high scores (not with the scores of the AI)
             int32_t highScoreIdx = -1;
-            for (int32_t i = 0; i < MAX_HIGH_SCORES; i++) {
+            for (int32_t i = 0; i < MAX_HIGH_SCORES && !m_bDemoMode; i++) {
                 if (m_nGameOverScore >= m_HighScores[i].score) {
                     highScoreIdx = i;
                     break;
@@ -802,6 +850,88 @@ private:
     }
 
 
+    // Game loop for REPLAY VIEWER
+    void UpdateReplayViewer(float fElapsedTime)
+    {
+        // open the replay, if not yet opened
+        if (m_pTetris == nullptr) {
+            m_pTetris = new TetrisFrontend(this, m_pTilesSprite, m_Settings);
+            string path = string(REPLAY_DIRECTORY) + "/" + m_ReplayFiles[m_nReplayIndex];
+            if (!m_pTetris->OpenReplay(path.c_str())) {
+                EndGame();
+                m_nGameState = GameState::GAME_MAIN_MENU;
+                return;
+            }
+        }
+        TetrisReplayPlayer& player = m_pTetris->GetReplayPlayer();
+
+        // check keys
+        int32_t cntReplays = (int32_t)m_ReplayFiles.size();
+        if (GetKey(Key::ESCAPE).bPressed) {
+            m_nGameState = GameState::GAME_MAIN_MENU;
+            return;
+        }
+        else if (GetKey(Key::N).bPressed || GetKey(Key::P).bPressed) {
+            // next / previous replay file
+            int32_t delta = GetKey(Key::N).bPressed ? 1 : (cntReplays - 1);
+            m_nReplayIndex = (m_nReplayIndex + delta) % cntReplays;
+            EndGame();
+            return;
+        }
+        else if (GetKey(Key::SPACE).bPressed) {
+            m_bReplayPaused = !m_bReplayPaused;
+        }
+        else if (GetKey(Key::S).bPressed) {
+            // step one update (paused)
+            m_bReplayPaused = true;
+            player.Step();
+        }
+        else if (GetKey(Key::UP).bPressed && m_nReplaySpeedIdx < CNT_REPLAY_SPEEDS - 1) {
+            m_nReplaySpeedIdx++;
+        }
+        else if (GetKey(Key::DOWN).bPressed && m_nReplaySpeedIdx > 0) {
+            m_nReplaySpeedIdx--;
+        }
+        else if (GetKey(Key::LEFT).bPressed) {
+            player.SeekPiece(max(player.GetPiece() - 1, 0));
+        }
+        else if (GetKey(Key::RIGHT).bPressed) {
+            player.SeekPiece(player.GetPiece() + 1);
+        }
+        else if (GetKey(Key::PGUP).bPressed) {
+            player.SeekPiece(max(player.GetPiece() - 10, 0));
+        }
+        else if (GetKey(Key::PGDN).bPressed) {
+            player.SeekPiece(player.GetPiece() + 10);
+        }
+        else if (GetKey(Key::HOME).bPressed) {
+            player.SeekPiece(0);
+        }
+        else if (GetKey(Key::END).bPressed) {
+            player.SeekPiece(player.GetPieceCount());
+        }
+
+        // play and draw the replay
+        m_pTetris->UpdateReplay(fElapsedTime, m_bReplayPaused ? 0 : REPLAY_SPEEDS[m_nReplaySpeedIdx]);
+        string status = "Piece " + to_string(player.GetPiece()) + "/" + to_string(player.GetPieceCount());
+        status += m_bReplayPaused ? "  PAUSED" : ("  x" + to_string(REPLAY_SPEEDS[m_nReplaySpeedIdx]));
+        DrawString((SCREEN_WIDTH_PIXELS - 8 * (int32_t)status.size()) / 2, 8, status, CYAN);
+        if (player.IsEnd())
+            DrawStringCenter(TABLE_START_Y + 100, "THE END", YELLOW, 2);
+
+        // draw the viewer keys (over the game keys)
+        FillRect(290, 180, 100, 110, BLACK);
+        const char* keys[][2] = {
+            { "Space", "Pause" }, { "S", "Step" }, { "<>", "Piece" }, { "PgUpDn", "10" },
+            { "Up/Dn", "Speed" }, { "Home", "Start" }, { "N/P", "File" }, { "Esc", "Menu" }
+        };
+        for (int32_t i = 0; i < 8; i++) {
+            DrawString(294, 184 + 13 * i, keys[i][0], GREEN);
+            DrawString(350, 184 + 13 * i, keys[i][1], WHITE);
+        }
+    }
+
+
     // Game loop for GAME OVER
     void UpdateGameOver()
     {
@@ -1,45 +1,103 @@
 #ifndef TETRIMINO_H
 #define TETRIMINO_H
 
+#include "TetriminoTables.h"
+
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <type_traits>
+
+
+//=======================
+//  Tetrimino placement: (type, rotation, x, y) packed in 4 bytes
+//  It is trivially copyable and hashable, so it can be stored by the million
+//  (search nodes, transposition tables, replay frames).
+//=======================
+struct TetroPlacement
+{
+    int8_t nType;
+    int8_t nRot;
+    int8_t x, y;        // offsets from the spawn position
 
+    uint32_t pack() const
+    {
+        return (uint32_t)(uint8_t)nType | ((uint32_t)(uint8_t)nRot << 8)
+            | ((uint32_t)(uint8_t)x << 16) | ((uint32_t)(uint8_t)y << 24);
+    }
 
-struct TetroConstData;
+    static TetroPlacement unpack(uint32_t packed)
+    {
+        TetroPlacement p;
+        p.nType = (int8_t)(packed & 0xFF);
+        p.nRot = (int8_t)((packed >> 8) & 0xFF);
+        p.x = (int8_t)((packed >> 16) & 0xFF);
+        p.y = (int8_t)((packed >> 24) & 0xFF);
+        return p;
+    }
 
+    bool operator== (const TetroPlacement& other) const   { return pack() == other.pack(); }
+    bool operator!= (const TetroPlacement& other) const   { return pack() != other.pack(); }
+};
+
+static_assert(sizeof(TetroPlacement) == 4, "TetroPlacement must be packed in 4 bytes");
+static_assert(std::is_trivially_copyable<TetroPlacement>::value, "TetroPlacement must be trivially copyable");
 
+
+namespace std
+{
+    template<> struct hash<TetroPlacement>
+    {
+        size_t operator() (const TetroPlacement& p) const
+        {
+            // multiplicative hash of the packed value
+            return (size_t)(p.pack() * 0x9E3779B1u);
+        }
+    };
+}
+
+
+
+//=======================
+//  Tetrimino: a placement, plus the API to move/rotate it
+//=======================
 class Tetrimino
 {
 public:
     Tetrimino(int8_t typeIdx = 0);
-    Tetrimino(const Tetrimino& other);
-
-    Tetrimino& operator= (const Tetrimino& other);
+    explicit Tetrimino(const TetroPlacement& placement) : m_Placement(placement) {}
 
-    int32_t getX(int8_t tileIdx) const;
-    int32_t getY(int8_t tileIdx) const;
+    int32_t getX(int8_t tileIdx) const  { return m_Placement.x + getShape().xTile[tileIdx & 0x03]; }
+    int32_t getY(int8_t tileIdx) const  { return m_Placement.y + getShape().yTile[tileIdx & 0x03]; }
     void resetPosition();
 
-    void move(int32_t deltaX, int32_t deltaY);
+    void move(int32_t deltaX, int32_t deltaY)
+    {
+        m_Placement.x = (int8_t)(m_Placement.x + deltaX);
+        m_Placement.y = (int8_t)(m_Placement.y + deltaY);
+    }
     void rotateLeft(int8_t wallKickIdx);
     void rotateRight(int8_t wallKickIdx);
 
-    int8_t getTypeIndex() const   { return m_nTypeIdx;  }
-    char   getTypeChar() const    { return m_chType;    }
+    int8_t getTypeIndex() const   { return m_Placement.nType; }
+    static int8_t typeIndexFromChar(char chType);     // -1 if not a Tetrimino letter
+    char   getTypeChar() const    { return TETRO_TABLES.typeChar[m_Placement.nType]; }
 
+    // Precomputed data for the current type + rotation
+    int8_t getRotation() const    { return m_Placement.nRot; }
+    int32_t getXOffset() const    { return m_Placement.x; }
+    int32_t getYOffset() const    { return m_Placement.y; }
+    const TetroShape& getShape() const  { return TETRO_TABLES.shapes[m_Placement.nType][m_Placement.nRot]; }
+
+    const TetroPlacement& getPlacement() const  { return m_Placement; }
 
-private:
-    void copyFrom(const Tetrimino& other);
 
 private:
-    int8_t m_nTypeIdx;
-    char   m_chType;
-    const TetroConstData* m_pData;
-
-    int32_t m_xOfs, m_yOfs;
-    int32_t m_xTileOffset[4];
-    int32_t m_yTileOffset[4];
-    int8_t  m_nRotationPos;
+    TetroPlacement m_Placement;
 };
 
+static_assert(sizeof(Tetrimino) == sizeof(TetroPlacement), "Tetrimino must be as compact as its placement");
+static_assert(std::is_trivially_copyable<Tetrimino>::value, "Tetrimino must be trivially copyable");
+
 
 #endif // TETRIMINO_H
@@ -0,0 +1,197 @@
+#ifndef TETRIMINOTABLES_H
+#define TETRIMINOTABLES_H
+
+#include "TetrisConstants.h"
+
+#include <cstdint>
+
+
+//=======================
+//  Precomputed Tetrimino data
+//  All 7 pieces x 4 rotations are generated at compile time, from the layout
+//  strings and the SRS wall kick data below. A piece is then just its
+//  (type, rotation, x, y) and rotating it only changes the rotation index.
+//=======================
+
+const int32_t CNT_ROTATIONS = 4;
+const int32_t CNT_WALL_KICKS = 5;   // test 0 = no kick, tests 1-4 = SRS kicks
+
+
+// One rotation of one Tetrimino type
+struct TetroShape
+{
+    // tile coordinates, relative to the piece position (start position included)
+    int8_t xTile[4];
+    int8_t yTile[4];
+
+    // bounding box, relative to the piece position
+    int8_t xMin, xMax;
+    int8_t yMin, yMax;
+
+    // occupancy of each bounding box row (bit 0 = column xMin)
+    uint16_t rowMask[4];
+
+    // wall kick offsets, when rotating FROM this rotation
+    int8_t xKickRight[CNT_WALL_KICKS], yKickRight[CNT_WALL_KICKS];
+    int8_t xKickLeft[CNT_WALL_KICKS], yKickLeft[CNT_WALL_KICKS];
+};
+
+
+struct TetroTables
+{
+    char typeChar[CNT_TETRIMINOS];
+    bool canRotate[CNT_TETRIMINOS];
+    TetroShape shapes[CNT_TETRIMINOS][CNT_ROTATIONS];
+};
+
+
+
+namespace TetroTableData
+{
+    constexpr char TYPE_CHARS[] = "OITSZJL";
+
+    constexpr const char* TETRO_STR[CNT_TETRIMINOS] =
+    {
+        ".... .##. .##.",   // O (square)
+        ".... #### ....",   // I (line)
+        ".#.. ###. ....",   // T
+        ".##. ##.. ....",   // S
+        "##.. .##. ....",   // Z
+        "#... ###. ....",   // J
+        "..#. ###. ...."    // L
+    };
+
+    struct TetroConstData {
+        int32_t m_nRotationTransformer;
+        int32_t m_xStartPos, m_yStartPos;
+        int32_t m_RotRightWallKick[32];
+        int32_t m_RotLeftWallKick[32];
+    };
+
+    // static data for 'I' and 'O'
+    constexpr TetroConstData FOUR_DATA = {
+        3, 3, -1,
+        // right wall kick data
+        {
+            -2, 0,   +1, 0,   -2, +1,   +1, -2,
+            -1, 0,   +2, 0,   -1, -2,   +2, +1,
+            +2, 0,   -1, 0,   +2, -1,   -1, +2,
+            +1, 0,   -2, 0,   +1, +2,   -2, -1
+        },
+        // left wall kick data
+        {
+            -1, 0,   +2, 0,   -1, -2,   +2, +1,
+            +2, 0,   -1, 0,   +2, -1,   -1, +2,
+            +1, 0,   -2, 0,   +1, +2,   -2, -1,
+            -2, 0,   +1, 0,   -2, +1,   +1, -2
+        }
+    };
+
+    // static data for J, L, S, T, Z
+    constexpr TetroConstData THREE_DATA = {
+        2, 3, 0,
+        // right wall kick data
+        {
+            -1, 0,   -1, -1,   0, +2,   -1, +2,
+            +1, 0,   +1, +1,   0, -2,   +1, -2,
+            +1, 0,   +1, -1,   0, +2,   +1, +2,
+            -1, 0,   -1, +1,   0, -2,   -1, -2
+        },
+        // left wall kick data
+        {
+            +1, 0,   +1, -1,   0, +2,   +1, +2,
+            +1, 0,   +1, +1,   0, -2,   +1, -2,
+            -1, 0,   -1, -1,   0, +2,   -1, +2,
+            -1, 0,   -1, +1,   0, -2,   -1, -2
+        }
+    };
+
+    /*
+ I Tetrimino Wall Kick Data 	Test 1 	Test 2 	Test 3 	Test 4 	Test 5
+0>>1 	( 0, 0) 	(-2, 0) 	( 1, 0) 	(-2,-1) 	( 1, 2)
+1>>2 	( 0, 0) 	(-1, 0) 	( 2, 0) 	(-1, 2) 	( 2,-1)
+2>>3 	( 0, 0) 	( 2, 0) 	(-1, 0) 	( 2, 1) 	(-1,-2)
+3>>0 	( 0, 0) 	( 1, 0) 	(-2, 0) 	( 1,-2) 	(-2, 1)
+
+0>>3	( 0, 0)	(-1, 0)	( 2, 0)	(-1, 2)	( 2,-1)
+1>>0	( 0, 0)	( 2, 0)	(-1, 0)	( 2, 1)	(-1,-2)
+2>>1	( 0, 0)	( 1, 0)	(-2, 0)	( 1,-2)	(-2, 1)
+3>>2	( 0, 0)	(-2, 0)	( 1, 0)	(-2,-1)	( 1, 2)
+    */
+
+
+    constexpr TetroTables MakeTetroTables()
+    {
+        TetroTables tables = {};
+        for (int32_t type = 0; type < CNT_TETRIMINOS; type++)
+        {
+            char chType = TYPE_CHARS[type];
+            const TetroConstData& data = (chType == 'O' || chType == 'I') ? FOUR_DATA : THREE_DATA;
+            tables.typeChar[type] = chType;
+            tables.canRotate[type] = (chType != 'O');
+
+            // compute the 4 tile coordinates, from the layout string
+            int32_t xTile[4] = {}, yTile[4] = {};
+            int32_t idx = 0, xy = 0;
+            for (const char* ch = TETRO_STR[type]; (*ch) != 0 && idx < 4; ch++)
+            {
+                if (*ch == '#') {
+                    xTile[idx] = xy % 4;
+                    yTile[idx] = xy / 4;
+                    idx++, xy++;
+                }
+                else if (*ch == '.') {
+                    xy++;
+                }
+            }
+
+            for (int32_t rot = 0; rot < CNT_ROTATIONS; rot++)
+            {
+                TetroShape& shape = tables.shapes[type][rot];
+
+                // tiles + bounding box
+                shape.xMin = shape.yMin = 127;
+                shape.xMax = shape.yMax = -128;
+                for (int32_t i = 0; i < 4; i++) {
+                    int8_t x = (int8_t)(data.m_xStartPos + xTile[i]);
+                    int8_t y = (int8_t)(data.m_yStartPos + yTile[i]);
+                    shape.xTile[i] = x;
+                    shape.yTile[i] = y;
+                    shape.xMin = (x < shape.xMin) ? x : shape.xMin;
+                    shape.xMax = (x > shape.xMax) ? x : shape.xMax;
+                    shape.yMin = (y < shape.yMin) ? y : shape.yMin;
+                    shape.yMax = (y > shape.yMax) ? y : shape.yMax;
+                }
+
+                // row masks
+                for (int32_t i = 0; i < 4; i++) {
+                    shape.rowMask[shape.yTile[i] - shape.yMin] |= (uint16_t)(1 << (shape.xTile[i] - shape.xMin));
+                }
+
+                // wall kicks (test 0 is always "no kick")
+                for (int32_t wk = 1; wk < CNT_WALL_KICKS; wk++) {
+                    int32_t k = (rot * 8) + ((wk - 1) * 2);
+                    shape.xKickRight[wk] = (int8_t)data.m_RotRightWallKick[k + 0];
+                    shape.yKickRight[wk] = (int8_t)data.m_RotRightWallKick[k + 1];
+                    shape.xKickLeft[wk] = (int8_t)data.m_RotLeftWallKick[k + 0];
+                    shape.yKickLeft[wk] = (int8_t)data.m_RotLeftWallKick[k + 1];
+                }
+
+                // rotate tiles to the right, for the next rotation
+                for (int32_t i = 0; i < 4; i++) {
+                    int32_t newX = data.m_nRotationTransformer - yTile[i];
+                    int32_t newY = xTile[i];
+                    xTile[i] = newX;
+                    yTile[i] = newY;
+                }
+            }
+        }
+        return tables;
+    }
+}
+
+
+constexpr TetroTables TETRO_TABLES = TetroTableData::MakeTetroTables();
+
+
+#endif // TETRIMINOTABLES_H
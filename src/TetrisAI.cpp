@@ -0,0 +1,220 @@
+#include "TetrisAI.h"
+#include "TetrisBits.h"
+#include "TetrisConstants.h"
+
+#if TETRIS_SSE2
+#include <emmintrin.h>
+#endif
+
+
+/////////////////////////////////////////////
+//  FEATURES
+/////////////////////////////////////////////
+namespace
+{
+    // the row features are computed over 32 rows: the board rows, then full rows (as the floor)
+    const int32_t PADDED_ROWS = 32;
+    static_assert(BOARD_ROWS <= PADDED_ROWS, "the board must fit in the padded rows");
+
+    // a row with both walls: bit 0 = left wall, bits 1..W = the row, bit W+1 = right wall
+    const uint32_t WALLS_MASK = 1u | (1u << (TABLE_WIDTH_TILES + 1));
+    const uint32_t ROW_PAIRS_MASK = (1u << (TABLE_WIDTH_TILES + 1)) - 1;
+
+
+#if TETRIS_SSE2
+    // number of set bits in each 16 bit lane
+    inline __m128i PopCount16(__m128i v)
+    {
+        const __m128i m1 = _mm_set1_epi16(0x5555);
+        const __m128i m2 = _mm_set1_epi16(0x3333);
+        const __m128i m4 = _mm_set1_epi16(0x0F0F);
+        v = _mm_sub_epi16(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+        v = _mm_add_epi16(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+        v = _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 4)), m4);
+        return _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), _mm_set1_epi16(0x1F));
+    }
+
+    // sum of the 16 bit lanes
+    inline int32_t SumLanes16(__m128i v)
+    {
+        __m128i sum = _mm_madd_epi16(v, _mm_set1_epi16(1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    // row transitions, column transitions and holes: 8 rows per vector
+    void ComputeRowFeatures(const uint16_t* pRows, TetrisBoardFeatures& features)
+    {
+        alignas(16) uint16_t rows[PADDED_ROWS];
+        for (int32_t y = 0; y < PADDED_ROWS; y++)
+            rows[y] = (y < BOARD_ROWS) ? pRows[y] : FULL_ROW_MASK;
+
+        const __m128i full = _mm_set1_epi16((short)FULL_ROW_MASK);
+        const __m128i walls = _mm_set1_epi16((short)WALLS_MASK);
+        const __m128i pairs = _mm_set1_epi16((short)ROW_PAIRS_MASK);
+        __m128i rowTrans = _mm_setzero_si128();
+        __m128i colTrans = _mm_setzero_si128();
+        __m128i holes = _mm_setzero_si128();
+        __m128i prevLast = _mm_setzero_si128();     // last row of the previous vector (in lane 7), the ceiling is empty
+        __m128i coverCarry = _mm_setzero_si128();   // OR of all the rows of the previous vectors (in all lanes)
+        for (int32_t i = 0; i < PADDED_ROWS; i += 8)
+        {
+            __m128i v = _mm_load_si128((const __m128i*)(rows + i));
+
+            // along the rows: add the walls, then compare each cell with its right neighbour
+            __m128i w = _mm_or_si128(_mm_slli_epi16(v, 1), walls);
+            rowTrans = _mm_add_epi16(rowTrans, PopCount16(_mm_and_si128(_mm_xor_si128(w, _mm_srli_epi16(w, 1)), pairs)));
+
+            // along the columns: compare each row with the row above it
+            __m128i above = _mm_or_si128(_mm_slli_si128(v, 2), _mm_srli_si128(prevLast, 14));
+            colTrans = _mm_add_epi16(colTrans, PopCount16(_mm_xor_si128(v, above)));
+
+            // holes: empty cells below the OR of all the rows above them
+            __m128i cover = above;
+            cover = _mm_or_si128(cover, _mm_slli_si128(cover, 2));
+            cover = _mm_or_si128(cover, _mm_slli_si128(cover, 4));
+            cover = _mm_or_si128(cover, _mm_slli_si128(cover, 8));
+            cover = _mm_or_si128(cover, coverCarry);
+            holes = _mm_add_epi16(holes, PopCount16(_mm_andnot_si128(v, _mm_and_si128(cover, full))));
+
+            // carry to the next vector
+            __m128i inclusive = _mm_or_si128(cover, v);
+            coverCarry = _mm_shufflehi_epi16(_mm_unpackhi_epi64(inclusive, inclusive), _MM_SHUFFLE(3, 3, 3, 3));
+            coverCarry = _mm_unpackhi_epi64(coverCarry, coverCarry);
+            prevLast = v;
+        }
+        features.nRowTransitions = SumLanes16(rowTrans);
+        features.nColTransitions = SumLanes16(colTrans);
+        features.nHoles = SumLanes16(holes);
+    }
+
+#else
+    // row transitions, column transitions and holes: one row at a time
+    void ComputeRowFeatures(const uint16_t* pRows, TetrisBoardFeatures& features)
+    {
+        features.nRowTransitions = features.nColTransitions = features.nHoles = 0;
+        uint32_t above = 0, cover = 0;
+        for (int32_t y = 0; y < PADDED_ROWS; y++)
+        {
+            uint32_t row = (y < BOARD_ROWS) ? pRows[y] : FULL_ROW_MASK;
+            uint32_t w = (row << 1) | WALLS_MASK;
+            features.nRowTransitions += PopCount((w ^ (w >> 1)) & ROW_PAIRS_MASK);
+            features.nColTransitions += PopCount(row ^ above);
+            features.nHoles += PopCount(~row & cover & FULL_ROW_MASK);
+            cover |= row;
+            above = row;
+        }
+    }
+#endif
+}
+
+
+void TetrisAI::ComputeFeatures(const TetrisBoard& board, TetrisBoardFeatures& features)
+{
+    ComputeRowFeatures(board.GetRows(), features);
+
+    // column heights: the first set bit of each column mask (the floor, if empty)
+    int32_t heights[TABLE_WIDTH_TILES];
+    for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+        heights[x] = BOARD_ROWS - CountTrailingZeros(board.GetColumnMask(x));
+    }
+
+    features.nAggregateHeight = features.nBumpiness = features.nWells = 0;
+    for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++)
+    {
+        features.nAggregateHeight += heights[x];
+        if (x > 0) {
+            int32_t diff = heights[x] - heights[x - 1];
+            features.nBumpiness += (diff >= 0) ? diff : -diff;
+        }
+        // well: both neighbours (or walls) are higher
+        int32_t left = (x > 0) ? heights[x - 1] : BOARD_ROWS;
+        int32_t right = (x < TABLE_WIDTH_TILES - 1) ? heights[x + 1] : BOARD_ROWS;
+        int32_t depth = ((left < right) ? left : right) - heights[x];
+        if (depth > 0)
+            features.nWells += depth * (depth + 1) / 2;
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  HEURISTIC AI
+/////////////////////////////////////////////
+
+TetrisAIWeights TetrisAIWeights::Default()
+{
+    // El-Tetris weights (https://imake.ninja/el-tetris-an-improvement-on-pierre-dellacheries-algorithm/)
+    // for the Dellacherie features; aggregate height and bumpiness are not used by default
+    TetrisAIWeights weights;
+    weights.fLandingHeight = -4.500158825f;
+    weights.fLines = 3.418126810f;
+    weights.fAggregateHeight = 0.0f;
+    weights.fHoles = -7.899265427f;
+    weights.fBumpiness = 0.0f;
+    weights.fWells = -3.385597225f;
+    weights.fRowTransitions = -3.217888287f;
+    weights.fColTransitions = -9.348695305f;
+    return weights;
+}
+
+
+TetrisAI::TetrisAI(const TetrisAIWeights& weights)
+: m_Weights(weights)
+{
+}
+
+
+float TetrisAI::EvaluatePlacement(const TetrisBoard& board, const TetroPlacement& placement, TetrisBoard* pAfter) const
+{
+    TetrisBoard localAfter;
+    TetrisBoard& after = (pAfter != nullptr) ? *pAfter : localAfter;
+    float lockScore = EvaluateLock(board, placement, after);
+    return lockScore + EvaluateBoard(after);
+}
+
+
+float TetrisAI::EvaluateLock(const TetrisBoard& board, const TetroPlacement& placement, TetrisBoard& after) const
+{
+    // lock the piece, as the engine does
+    Tetrimino piece(placement);
+    after = board;
+    after.PlacePiece(piece);
+    int32_t fullLines[TABLE_HEIGHT_TILES];
+    int32_t cntLines = after.FindFullLines(fullLines);
+    after.RemoveLines(fullLines, cntLines);
+
+    // landing height: middle of the piece, from the floor
+    const TetroShape& shape = piece.getShape();
+    float landingHeight = TABLE_HEIGHT_TILES - piece.getYOffset() - (shape.yMin + shape.yMax) * 0.5f;
+    return m_Weights.fLandingHeight * landingHeight + m_Weights.fLines * cntLines;
+}
+
+
+float TetrisAI::EvaluateBoard(const TetrisBoard& board) const
+{
+    TetrisBoardFeatures features;
+    ComputeFeatures(board, features);
+    return m_Weights.fAggregateHeight * features.nAggregateHeight
+         + m_Weights.fHoles * features.nHoles
+         + m_Weights.fBumpiness * features.nBumpiness
+         + m_Weights.fWells * features.nWells
+         + m_Weights.fRowTransitions * features.nRowTransitions
+         + m_Weights.fColTransitions * features.nColTransitions;
+}
+
+
+int32_t TetrisAI::ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves)
+{
+    int32_t bestIdx = 0;
+    float bestScore = 0.0f;
+    for (int32_t i = 0; i < cntMoves; i++)
+    {
+        float score = EvaluatePlacement(engine.GetBoard(), pMoves[i].placement);
+        if (i == 0 || score > bestScore) {
+            bestIdx = i, bestScore = score;
+        }
+    }
+    return bestIdx;
+}
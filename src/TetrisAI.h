@@ -0,0 +1,70 @@
+#ifndef TETRISAI_H
+#define TETRISAI_H
+
+#include "TetrisBoard.h"
+#include "TetrisBot.h"
+#include "Tetrimino.h"
+
+#include <cstdint>
+
+
+//=======================
+//  Board features, for the heuristic evaluation
+//=======================
+struct TetrisBoardFeatures
+{
+    int32_t nAggregateHeight;   // sum of the column heights
+    int32_t nHoles;             // empty cells with an occupied cell above them
+    int32_t nBumpiness;         // sum of the height differences between neighbour columns
+    int32_t nWells;             // sum of the well depths (1 + 2 + ... + depth, for each well)
+    int32_t nRowTransitions;    // occupied <-> empty changes along the rows (walls are occupied)
+    int32_t nColTransitions;    // occupied <-> empty changes along the columns (floor is occupied)
+};
+
+
+// Weight of each feature (the score of a placement is the weighted sum)
+struct TetrisAIWeights
+{
+    float fLandingHeight;
+    float fLines;
+    float fAggregateHeight;
+    float fHoles;
+    float fBumpiness;
+    float fWells;
+    float fRowTransitions;
+    float fColTransitions;
+
+    static TetrisAIWeights Default();
+};
+
+
+
+//=======================
+//  Heuristic AI: one-piece lookahead, each placement scored with the classic
+//  features (Dellacherie / El-Tetris), computed with SSE2 over the row bitboard
+//=======================
+class TetrisAI : public TetrisBot
+{
+public:
+    explicit TetrisAI(const TetrisAIWeights& weights = TetrisAIWeights::Default());
+
+    const char* GetName() const override    { return "Heuristic AI"; }
+    int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) override;
+
+    // Score of locking the piece on the board (the higher, the better);
+    // the board after the lock (full lines removed) is written to pAfter, if given
+    float EvaluatePlacement(const TetrisBoard& board, const TetroPlacement& placement, TetrisBoard* pAfter = nullptr) const;
+    // The two parts of the score: locking the piece (landing height and lines, the board after the lock
+    // is written to 'after'), and the board after the lock (its features, which can be cached by board)
+    float EvaluateLock(const TetrisBoard& board, const TetroPlacement& placement, TetrisBoard& after) const;
+    float EvaluateBoard(const TetrisBoard& board) const;
+
+    static void ComputeFeatures(const TetrisBoard& board, TetrisBoardFeatures& features);
+
+
+private:
+    TetrisAIWeights m_Weights;
+};
+
+
+#endif // TETRISAI_H
@@ -0,0 +1,348 @@
+#include "TetrisBeamSearch.h"
+#include "TetrisZobrist.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+
+namespace
+{
+    // the pieces known in advance: the current piece + the NEXT queue
+    const int32_t SEQUENCE_LENGTH = 1 + CNT_NEXT_PIECES;
+
+    const int64_t NO_DEADLINE = INT64_MAX;
+
+    // hash of a node: its board, HOLD and where it is in the piece sequence
+    uint64_t HashNode(uint64_t boardHash, int8_t nHeld, int8_t nQueue)
+    {
+        uint64_t hash = boardHash ^ TetrisZobrist::Mix((uint64_t)(uint8_t)nQueue);
+        return (nHeld >= 0) ? hash ^ ZOBRIST_KEYS.heldPiece[nHeld] : hash;
+    }
+
+    int64_t NowMicros()
+    {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+
+
+TetrisBeamSearch::TetrisBeamSearch(int32_t beamWidth, TetrisThreadPool* pPool, const TetrisAIWeights& weights)
+: m_pPool(pPool)
+, m_AI(weights)
+, m_Table(TABLE_SIZE_LOG2)
+, m_nBeamWidth(0)
+, m_nCurrentBeam(0)
+, m_nCntNodes(0)
+, m_nNextNode(0)
+, m_bOutOfTime(false)
+, m_bFirstStep(false)
+, m_nDepth(0)
+, m_nDeadline(NO_DEADLINE)
+, m_nSearchedDepth(0)
+, m_nExpandedNodes(0)
+, m_nScoredBoards(0)
+{
+    // one scratch per expanding task: as many tasks as the workers + the calling thread
+    int32_t cntTasks = 1 + ((pPool != nullptr) ? pPool->GetThreadCount() : 0);
+    m_Scratch.resize(cntTasks);
+    SetBeamWidth(beamWidth);
+}
+
+
+void TetrisBeamSearch::SetBeamWidth(int32_t beamWidth)
+{
+    // (the nodes refer to their parent with 16 bits)
+    m_nBeamWidth = min(max(beamWidth, 1), (int32_t)UINT16_MAX);
+    m_Beams[0].resize(m_nBeamWidth);
+    m_Beams[1].resize(m_nBeamWidth);
+    m_Candidates.resize((size_t)m_nBeamWidth * MAX_NODE_CHILDREN);
+    m_CandidateCounts.resize(m_nBeamWidth);
+    m_Selected.resize(m_nBeamWidth);
+}
+
+
+
+/////////////////////////////////////////////
+//  SEARCH
+/////////////////////////////////////////////
+
+bool TetrisBeamSearch::Plan(const TetrisEngine& engine, int64_t budgetMicros, TetrisPlannedMove& move)
+{
+    m_nDeadline = (budgetMicros > 0) ? NowMicros() + budgetMicros : NO_DEADLINE;
+    m_bOutOfTime = false;
+    m_nSearchedDepth = 0;
+    m_nExpandedNodes = 1;
+    m_Table.NewSearch();
+    for (Scratch& scratch : m_Scratch) {
+        scratch.nScoredBoards = 0;
+    }
+
+    // the pieces, in the order they come
+    m_Sequence[0] = engine.GetCurrentPiece().getTypeIndex();
+    for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+        m_Sequence[1 + i] = engine.GetNextPiece(i).getTypeIndex();
+    }
+
+    // root: the board of the engine, with the current piece where it is now
+    m_nCurrentBeam = 0;
+    m_nCntNodes = 1;
+    Node& root = m_Beams[0][0];
+    root.board = engine.GetBoard();
+    root.fScore = 0.0f;
+    root.nHeld = engine.IsPieceHeld() ? engine.GetHeldPiece().getTypeIndex() : -1;
+    root.nQueue = 0;
+    m_nDepth = 0;
+    ExpandNode(root, 0, engine.IsHoldAllowed(), engine.GetCurrentPiece(), m_Scratch[0]);
+
+    bool bFound = false;
+    for (int32_t depth = 1; depth <= MAX_DEPTH; depth++)
+    {
+        int32_t cntSelected = SelectCandidates();
+        if (cntSelected == 0)
+            break;
+
+        // best move of the deepest complete step
+        const Candidate* pBest = &m_Selected[0];
+        for (int32_t i = 1; i < cntSelected; i++) {
+            if (m_Selected[i].fScore > pBest->fScore)
+                pBest = &m_Selected[i];
+        }
+        if (depth == 1) {
+            move.bHold = pBest->bHold;
+            move.placement = pBest->placement;
+        }
+        else {
+            const Node& parent = m_Beams[m_nCurrentBeam][pBest->nParent];
+            move.bHold = parent.bRootHold;
+            move.placement = parent.rootPlacement;
+        }
+        bFound = true;
+        m_nSearchedDepth = depth;
+        if (depth == MAX_DEPTH || NowMicros() >= m_nDeadline)
+            break;
+
+        // next step: the selected candidates become the beam, and are expanded
+        m_bFirstStep = (depth == 1);
+        m_nDepth = depth;
+        m_nCurrentBeam ^= 1;
+        m_nCntNodes = cntSelected;
+        m_nNextNode = 0;
+        if (m_pPool != nullptr)
+        {
+            // (each task pulls nodes until there are none left, so the tasks stay balanced)
+            int32_t cntTasks = min((int32_t)m_Scratch.size(), cntSelected);
+            TetrisTaskGroup group;
+            for (int32_t t = 0; t < cntTasks; t++) {
+                m_pPool->Submit([this, t]() { ExpandNodes(t); }, &group);
+            }
+            m_pPool->Wait(group);
+        }
+        else {
+            ExpandNodes(0);
+        }
+        if (m_bOutOfTime)
+            break;
+        m_nExpandedNodes += cntSelected;
+    }
+
+    m_nScoredBoards = 0;
+    for (const Scratch& scratch : m_Scratch) {
+        m_nScoredBoards += scratch.nScoredBoards;
+    }
+    return bFound;
+}
+
+
+int32_t TetrisBeamSearch::PlanActions(const TetrisEngine& engine, int64_t budgetMicros, TetrisAction* pActions, int32_t maxActions)
+{
+    TetrisPlannedMove move;
+    if (maxActions < 2 || !Plan(engine, budgetMicros, move))
+        return 0;
+
+    // the piece to move (the one coming out of HOLD, or the next one, after HOLD)
+    int32_t cntActions = 0;
+    Tetrimino piece = engine.GetCurrentPiece();
+    if (move.bHold) {
+        piece = Tetrimino(engine.IsPieceHeld() ? engine.GetHeldPiece().getTypeIndex() : engine.GetNextPiece(0).getTypeIndex());
+        pActions[cntActions++] = ACTION_HOLD;
+    }
+
+    Scratch& scratch = m_Scratch[0];
+    int32_t cntMoves = scratch.moveGen.Generate(engine.GetBoard(), piece, scratch.moves, MAX_PIECE_MOVES);
+    for (int32_t i = 0; i < cntMoves; i++)
+    {
+        if (scratch.moves[i].placement == move.placement) {
+            int32_t cntPath = scratch.moveGen.GetPath(scratch.moves[i], pActions + cntActions, maxActions - cntActions);
+            return (cntPath > 0) ? cntActions + cntPath : 0;
+        }
+    }
+    return 0;
+}
+
+
+// Expanding task: builds and expands the nodes of the beam, until there are none left
+void TetrisBeamSearch::ExpandNodes(int32_t taskIdx)
+{
+    Scratch& scratch = m_Scratch[taskIdx];
+    const Node* pParents = m_Beams[m_nCurrentBeam ^ 1].data();
+    for (;;)
+    {
+        int32_t nodeIdx = m_nNextNode++;
+        if (nodeIdx >= m_nCntNodes)
+            break;
+        if (m_nDeadline != NO_DEADLINE && NowMicros() >= m_nDeadline)
+            m_bOutOfTime = true;
+        if (m_bOutOfTime)
+            continue;
+
+        Node& node = m_Beams[m_nCurrentBeam][nodeIdx];
+        BuildNode(m_Selected[nodeIdx], pParents, node);
+        Tetrimino currentPiece((node.nQueue < SEQUENCE_LENGTH) ? m_Sequence[node.nQueue] : 0);
+        ExpandNode(node, nodeIdx, true, currentPiece, scratch);
+    }
+}
+
+
+// Children of a node: the current piece, or the piece swapped with HOLD
+void TetrisBeamSearch::ExpandNode(const Node& node, int32_t nodeIdx, bool bHoldAllowed, const Tetrimino& currentPiece, Scratch& scratch)
+{
+    Candidate* pChildren = &m_Candidates[(size_t)nodeIdx * MAX_NODE_CHILDREN];
+    int32_t cntChildren = 0;
+    if (node.nQueue < SEQUENCE_LENGTH)
+        cntChildren += AddChildren(node, nodeIdx, currentPiece, false, scratch, pChildren);
+
+    if (bHoldAllowed)
+    {
+        // the piece in HOLD comes out, or else the next one
+        int8_t holdType = node.nHeld;
+        if (holdType < 0 && node.nQueue + 1 < SEQUENCE_LENGTH)
+            holdType = m_Sequence[node.nQueue + 1];
+        if (holdType >= 0)
+            cntChildren += AddChildren(node, nodeIdx, Tetrimino(holdType), true, scratch, pChildren + cntChildren);
+    }
+    m_CandidateCounts[nodeIdx] = cntChildren;
+}
+
+
+int32_t TetrisBeamSearch::AddChildren(const Node& node, int32_t nodeIdx, const Tetrimino& piece, bool bHold, Scratch& scratch, Candidate* pChildren)
+{
+    int8_t childHeld, childQueue;
+    FollowPieces(node, bHold, childHeld, childQueue);
+    // (the boards close to the root are the most worth keeping: the next searches start from there)
+    int32_t tableDepth = MAX_DEPTH - m_nDepth;
+
+    int32_t cntMoves = scratch.moveGen.Generate(node.board, piece, scratch.moves, MAX_PIECE_MOVES);
+    for (int32_t i = 0; i < cntMoves; i++)
+    {
+        const TetroPlacement& placement = scratch.moves[i].placement;
+        float lockScore = m_AI.EvaluateLock(node.board, placement, scratch.after);
+        // score the board after the lock, unless it was already
+        uint64_t boardHash = scratch.after.GetHash();
+        float boardScore;
+        int32_t depth;
+        if (!m_Table.Probe(boardHash, boardScore, depth)) {
+            boardScore = m_AI.EvaluateBoard(scratch.after);
+            m_Table.Store(boardHash, boardScore, tableDepth);
+            scratch.nScoredBoards++;
+        }
+
+        Candidate& child = pChildren[i];
+        child.nHash = HashNode(boardHash, childHeld, childQueue);
+        child.fScore = node.fScore + (lockScore + boardScore);
+        child.nParent = (uint16_t)nodeIdx;
+        child.bHold = bHold;
+        child.placement = placement;
+    }
+    return cntMoves;
+}
+
+
+// Node of a selected candidate: locks its piece on the parent board, and follows the pieces
+void TetrisBeamSearch::BuildNode(const Candidate& candidate, const Node* pParents, Node& node) const
+{
+    const Node& parent = pParents[candidate.nParent];
+    m_AI.EvaluateLock(parent.board, candidate.placement, node.board);
+    node.fScore = candidate.fScore;
+    FollowPieces(parent, candidate.bHold, node.nHeld, node.nQueue);
+
+    // the first move on the path to this node
+    if (m_bFirstStep) {
+        node.bRootHold = candidate.bHold;
+        node.rootPlacement = candidate.placement;
+    }
+    else {
+        node.bRootHold = parent.bRootHold;
+        node.rootPlacement = parent.rootPlacement;
+    }
+}
+
+
+// HOLD and the current piece, after a move of the parent node
+void TetrisBeamSearch::FollowPieces(const Node& parent, bool bHold, int8_t& nHeld, int8_t& nQueue) const
+{
+    int32_t queue = parent.nQueue;
+    if (!bHold) {
+        nHeld = parent.nHeld;
+        nQueue = (int8_t)(queue + 1);
+    }
+    else if (parent.nHeld >= 0) {
+        // the current piece went to HOLD (once the queue is over, it is not known)
+        nHeld = (queue < SEQUENCE_LENGTH) ? m_Sequence[queue] : -1;
+        nQueue = (int8_t)min(queue + 1, SEQUENCE_LENGTH);
+    }
+    else {
+        // the current piece went to HOLD, and the next one was played
+        nHeld = m_Sequence[queue];
+        nQueue = (int8_t)(queue + 2);
+    }
+}
+
+
+// Gathers the children of the beam, and selects the best ones (one per position); returns how many
+int32_t TetrisBeamSearch::SelectCandidates()
+{
+    // (gathered in place: the children of a node never move up)
+    int32_t cntCandidates = 0;
+    for (int32_t nodeIdx = 0; nodeIdx < m_nCntNodes; nodeIdx++)
+    {
+        const Candidate* pChildren = &m_Candidates[(size_t)nodeIdx * MAX_NODE_CHILDREN];
+        for (int32_t i = 0; i < m_CandidateCounts[nodeIdx]; i++) {
+            m_Candidates[cntCandidates++] = pChildren[i];
+        }
+    }
+
+    auto IsBetter = [](const Candidate& a, const Candidate& b) { return a.fScore > b.fScore; };
+    // (the same positions next to each other, the best one first: the ties are broken
+    // on the move, so that the result does not depend on the order of the candidates)
+    auto IsSameFirst = [](const Candidate& a, const Candidate& b) {
+        if (a.nHash != b.nHash) return a.nHash < b.nHash;
+        if (a.fScore != b.fScore) return a.fScore > b.fScore;
+        if (a.nParent != b.nParent) return a.nParent < b.nParent;
+        if (a.bHold != b.bHold) return b.bHold;
+        return a.placement.pack() < b.placement.pack();
+    };
+    auto IsSame = [](const Candidate& a, const Candidate& b) { return a.nHash == b.nHash; };
+
+    // the duplicates are dropped among twice the beam width; if too many of them were
+    // duplicates, among all the candidates
+    auto begin = m_Candidates.begin();
+    int32_t cntBest = min(cntCandidates, 2 * m_nBeamWidth);
+    if (cntBest < cntCandidates)
+        nth_element(begin, begin + cntBest, begin + cntCandidates, IsBetter);
+    sort(begin, begin + cntBest, IsSameFirst);
+    int32_t cntUnique = (int32_t)(unique(begin, begin + cntBest, IsSame) - begin);
+    if (cntUnique < m_nBeamWidth && cntBest < cntCandidates) {
+        sort(begin, begin + cntCandidates, IsSameFirst);
+        cntUnique = (int32_t)(unique(begin, begin + cntCandidates, IsSame) - begin);
+    }
+
+    if (cntUnique > m_nBeamWidth) {
+        nth_element(begin, begin + m_nBeamWidth, begin + cntUnique, IsBetter);
+        cntUnique = m_nBeamWidth;
+    }
+    copy(begin, begin + cntUnique, m_Selected.begin());
+    return cntUnique;
+}
@@ -0,0 +1,160 @@
+#ifndef TETRISBEAMSEARCH_H
+#define TETRISBEAMSEARCH_H
+
+#include "TetrisAI.h"
+#include "TetrisBoard.h"
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisMoveGen.h"
+#include "TetrisThreadPool.h"
+#include "TetrisTransTable.h"
+#include "Tetrimino.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+
+//=======================
+//  Beam search planner: looks ahead at the pieces known in advance (the
+//  current piece, the NEXT queue and HOLD). Each step expands the placements
+//  of every node of the beam (playing the current piece, or swapping it with
+//  HOLD), scores them with the heuristic AI, and keeps the best ones.
+//  The same position is often reached through another order of the pieces:
+//  the boards are scored once (the transposition table keeps their score,
+//  from one search to the next), and the beam keeps each position only once.
+//  The nodes of a step are expanded on the thread pool (if any). All the
+//  memory is allocated when the beam width is set: planning does not allocate,
+//  so it can run inside the frame loop.
+//=======================
+class TetrisBeamSearch
+{
+public:
+    // Placements planned: the pieces known in advance (the current piece, the NEXT queue and HOLD)
+    static const int32_t MAX_DEPTH = 2 + CNT_NEXT_PIECES;
+    // Placements kept for each piece (no real board has more)
+    static const int32_t MAX_PIECE_MOVES = 256;
+    // Size of the transposition table (log2 of the entries)
+    static const int32_t TABLE_SIZE_LOG2 = 16;
+
+public:
+    // Without a thread pool, the search runs on the calling thread only
+    TetrisBeamSearch(int32_t beamWidth, TetrisThreadPool* pPool = nullptr,
+                     const TetrisAIWeights& weights = TetrisAIWeights::Default());
+
+    int32_t GetBeamWidth() const    { return m_nBeamWidth; }
+    void SetBeamWidth(int32_t beamWidth);       // (allocates the node arenas)
+
+    // Plans the move of the current piece, searching as deep as the budget allows (0 = no limit);
+    // returns false if the piece cannot be placed
+    bool Plan(const TetrisEngine& engine, int64_t budgetMicros, TetrisPlannedMove& move);
+    // Same, as the actions to play (HOLD first, if planned so, and ending with ACTION_HARD_DROP);
+    // returns the number of actions (0 if the piece cannot be placed, or if they don't fit in maxActions)
+    int32_t PlanActions(const TetrisEngine& engine, int64_t budgetMicros, TetrisAction* pActions, int32_t maxActions);
+
+    // Statistics of the last search
+    int32_t GetSearchedDepth() const    { return m_nSearchedDepth; }     // steps completed within the budget
+    int64_t GetExpandedNodes() const    { return m_nExpandedNodes; }
+    int64_t GetScoredBoards() const     { return m_nScoredBoards; }      // (the others were found in the table)
+
+
+private:
+    // A board of the beam, and the first move which leads to it
+    struct Node
+    {
+        TetrisBoard board;
+        float fScore;                   // sum of the scores of its placements
+        int8_t nHeld;                   // type of the piece in HOLD (-1 if none)
+        int8_t nQueue;                  // index of its current piece in the piece sequence
+        bool bRootHold;
+        TetroPlacement rootPlacement;
+    };
+
+    // A child of a node, until it is selected for the next step of the beam
+    struct Candidate
+    {
+        uint64_t nHash;                 // hash of the node it leads to
+        float fScore;
+        uint16_t nParent;
+        bool bHold;
+        TetroPlacement placement;
+    };
+
+    // Per task memory (the expanding tasks use one each)
+    struct Scratch
+    {
+        TetrisMoveGen moveGen;
+        TetrisMove moves[MAX_PIECE_MOVES];
+        TetrisBoard after;
+        int64_t nScoredBoards;
+    };
+
+    static const int32_t MAX_NODE_CHILDREN = 2 * MAX_PIECE_MOVES;
+
+    void ExpandNodes(int32_t taskIdx);
+    void ExpandNode(const Node& node, int32_t nodeIdx, bool bHoldAllowed, const Tetrimino& currentPiece, Scratch& scratch);
+    int32_t AddChildren(const Node& node, int32_t nodeIdx, const Tetrimino& piece, bool bHold, Scratch& scratch, Candidate* pChildren);
+    void BuildNode(const Candidate& candidate, const Node* pParents, Node& node) const;
+    void FollowPieces(const Node& parent, bool bHold, int8_t& nHeld, int8_t& nQueue) const;
+    int32_t SelectCandidates();
+
+private:
+    TetrisThreadPool* m_pPool;
+    TetrisAI m_AI;
+    TetrisTransTable m_Table;
+    int32_t m_nBeamWidth;
+
+    // node arenas: the current and the next beam, the children of each node of the current beam,
+    // and the children selected for the next beam
+    std::vector<Node> m_Beams[2];
+    std::vector<Candidate> m_Candidates;
+    std::vector<int32_t> m_CandidateCounts;
+    std::vector<Candidate> m_Selected;
+    std::vector<Scratch> m_Scratch;
+
+    // the search in progress
+    int8_t m_Sequence[1 + CNT_NEXT_PIECES];
+    int32_t m_nCurrentBeam;
+    int32_t m_nCntNodes;
+    std::atomic<int32_t> m_nNextNode;
+    std::atomic<bool> m_bOutOfTime;
+    bool m_bFirstStep;                  // the beam is built from the root
+    int32_t m_nDepth;                   // step being expanded
+    int64_t m_nDeadline;
+
+    int32_t m_nSearchedDepth;
+    int64_t m_nExpandedNodes;
+    int64_t m_nScoredBoards;
+};
+
+
+
+//=======================
+//  Bot playing the moves planned by a beam search
+//=======================
+class TetrisBeamBot : public TetrisBot
+{
+public:
+    TetrisBeamBot(int32_t beamWidth, int64_t budgetMicros, TetrisThreadPool* pPool = nullptr)
+        : m_Search(beamWidth, pPool), m_nBudgetMicros(budgetMicros)
+    {}
+
+    const char* GetName() const override    { return "Beam search"; }
+    bool PlanMove(const TetrisEngine& engine, TetrisPlannedMove& move) override
+    {
+        return m_Search.Plan(engine, m_nBudgetMicros, move);
+    }
+    int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) override
+    {
+        return m_AI.ChooseMove(engine, pMoves, cntMoves);
+    }
+
+private:
+    TetrisBeamSearch m_Search;
+    TetrisAI m_AI;
+    int64_t m_nBudgetMicros;
+};
+
+
+#endif // TETRISBEAMSEARCH_H
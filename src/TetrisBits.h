@@ -0,0 +1,68 @@
+#ifndef TETRISBITS_H
+#define TETRISBITS_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// SSE2 is available on every x86-64 CPU (and on x86 when enabled by the compiler flags);
+// build with -DTETRIS_SSE2=0 to use the portable code
+#ifndef TETRIS_SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TETRIS_SSE2 1
+#else
+#define TETRIS_SSE2 0
+#endif
+#endif
+
+// SSE4.1 and AVX2 are used only when the compiler targets them (e.g. -msse4.1, -mavx2, /arch:AVX2)
+#ifndef TETRIS_SSE41
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define TETRIS_SSE41 1
+#else
+#define TETRIS_SSE41 0
+#endif
+#endif
+
+#ifndef TETRIS_AVX2
+#if defined(__AVX2__)
+#define TETRIS_AVX2 1
+#else
+#define TETRIS_AVX2 0
+#endif
+#endif
+
+
+//=======================
+//  Bit manipulation helpers (for the bitboards)
+//=======================
+
+// Index of the lowest set bit (value must NOT be 0)
+inline int32_t CountTrailingZeros(uint32_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, value);
+    return (int32_t)idx;
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+
+// Number of set bits
+inline int32_t PopCount(uint32_t value)
+{
+#if defined(_MSC_VER)
+    value = value - ((value >> 1) & 0x55555555u);
+    value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+    return (int32_t)((((value + (value >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#else
+    return __builtin_popcount(value);
+#endif
+}
+
+
+#endif // TETRISBITS_H
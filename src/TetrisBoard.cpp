@@ -0,0 +1,183 @@
+#include "TetrisBoard.h"
+#include "TetrisBits.h"
+#include "TetrisZobrist.h"
+
+#include <cstring>
+
+
+TetrisBoard::TetrisBoard()
+{
+    Clear();
+}
+
+
+void TetrisBoard::Clear()
+{
+    memset(m_Rows, 0, sizeof(m_Rows));
+    for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+        m_Cols[x] = FLOOR_MASK;
+    }
+    memset(m_Colors, EMPTY_CELL, sizeof(m_Colors));
+    m_nHash = 0;
+}
+
+
+int8_t TetrisBoard::GetTile(int32_t tileX, int32_t tileY) const
+{
+    if (!IsInside(tileX, tileY)) {
+        return OUTSIDE_CELL;
+    }
+    int idx = (tileY + EXTRA_HEIGHT_TILES) * TABLE_WIDTH_TILES + tileX;
+    return m_Colors[idx];
+}
+
+
+void TetrisBoard::SetTile(int32_t tileX, int32_t tileY, int8_t colorIndex)
+{
+    if (IsInside(tileX, tileY)) {
+        int row = tileY + EXTRA_HEIGHT_TILES;
+        uint16_t mask = (uint16_t)(1 << tileX);
+        uint32_t colMask = (uint32_t)1 << row;
+        // the hash changes only if the tile gets occupied or emptied
+        if (((m_Rows[row] & mask) != 0) != (colorIndex >= 0))
+            m_nHash ^= ZOBRIST_KEYS.cells[row][tileX];
+        m_Rows[row] = (colorIndex >= 0) ? (m_Rows[row] | mask) : (m_Rows[row] & ~mask);
+        m_Cols[tileX] = (colorIndex >= 0) ? (m_Cols[tileX] | colMask) : (m_Cols[tileX] & ~colMask);
+        m_Colors[row * TABLE_WIDTH_TILES + tileX] = colorIndex;
+    }
+}
+
+
+// Tiles outside of the board are considered occupied (walls, floor and ceiling)
+bool TetrisBoard::IsOccupied(int32_t tileX, int32_t tileY) const
+{
+    if (!IsInside(tileX, tileY)) {
+        return true;
+    }
+    return ((m_Rows[tileY + EXTRA_HEIGHT_TILES] >> tileX) & 0x01) != 0;
+}
+
+
+int32_t TetrisBoard::GetTopRow() const
+{
+    // the first set bit of each column is its highest tile (or the floor)
+    int32_t topRow = BOARD_ROWS;
+    for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++)
+    {
+        int32_t row = CountTrailingZeros(m_Cols[x]);
+        topRow = (row < topRow) ? row : topRow;
+    }
+    return topRow - EXTRA_HEIGHT_TILES;
+}
+
+
+int32_t TetrisBoard::GetDropDistance(const Tetrimino& tetro) const
+{
+    // for each tile: distance to the first occupied row below it, in its column
+    int32_t dropDistance = BOARD_ROWS;
+    for (int i = 0; i < 4; i++)
+    {
+        int32_t row = tetro.getY(i) + EXTRA_HEIGHT_TILES;
+        uint32_t below = m_Cols[tetro.getX(i)] >> (row + 1);
+        int32_t distance = CountTrailingZeros(below);
+        dropDistance = (distance < dropDistance) ? distance : dropDistance;
+    }
+    return dropDistance;
+}
+
+
+void TetrisBoard::PlacePiece(const Tetrimino& tetro)
+{
+    for (int i = 0; i < 4; i++) {
+        SetTile(tetro.getX(i), tetro.getY(i), tetro.getTypeIndex());
+    }
+}
+
+
+int32_t TetrisBoard::RotatePiece(Tetrimino& tetro, bool bRight) const
+{
+    // backup piece
+    Tetrimino backup = tetro;
+    // try all wall kicks
+    for (int8_t wk = 0; wk < CNT_WALL_KICKS; wk++) {
+        if (bRight)
+            tetro.rotateRight(wk);
+        else
+            tetro.rotateLeft(wk);
+        if (!DoesPieceCollide(tetro)) {
+            return wk;
+        }
+        // failed => restore backup
+        tetro = backup;
+    }
+    // all wall kicks have failed
+    return -1;
+}
+
+
+bool TetrisBoard::IsTSpinPosition(const Tetrimino& tetro) const
+{
+    if (tetro.getTypeChar() != 'T')
+        return false;
+    // check if 3 of 4 corners are full
+    int32_t cntOccupiedCorners = 0;
+    int32_t xCenter = tetro.getX(2);
+    int32_t yCenter = tetro.getY(2);
+    for (int32_t i = 0; i <= 3; i++) {
+        int32_t xDelta = ((i & 0x01) == 0) ? -1 : +1;
+        int32_t yDelta = ((i & 0x02) == 0) ? -1 : +1;
+        if (IsOccupied(xCenter + xDelta, yCenter + yDelta)) {
+            cntOccupiedCorners++;
+        }
+    }
+    return (cntOccupiedCorners >= 3);
+}
+
+
+int32_t TetrisBoard::FindFullLines(int32_t* pLines) const
+{
+    int32_t cntLines = 0;
+    for (int32_t y = 0; y < TABLE_HEIGHT_TILES; y++)
+    {
+        if (IsFullLine(y)) {
+            pLines[cntLines++] = y;
+        }
+    }
+    return cntLines;
+}
+
+
+// Remove the given lines (which must be sorted top to bottom), by shifting down everything above them
+void TetrisBoard::RemoveLines(const int32_t* pLines, int32_t cntLines)
+{
+    for (int32_t i = 0; i < cntLines; i++)
+    {
+        int32_t row = pLines[i] + EXTRA_HEIGHT_TILES;
+        memmove(m_Rows + 1, m_Rows, row * sizeof(m_Rows[0]));
+        memmove(m_Colors + TABLE_WIDTH_TILES, m_Colors, row * TABLE_WIDTH_TILES);
+        m_Rows[0] = 0;
+        memset(m_Colors, EMPTY_CELL, TABLE_WIDTH_TILES);
+        // same for the columns: shift down the rows above
+        uint32_t above = ((uint32_t)1 << row) - 1;
+        uint32_t below = ~((above << 1) | 1);
+        for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+            m_Cols[x] = ((m_Cols[x] & above) << 1) | (m_Cols[x] & below);
+        }
+    }
+    // (every tile above the lines has moved: hash again)
+    if (cntLines > 0)
+        m_nHash = ComputeHash();
+}
+
+
+uint64_t TetrisBoard::ComputeHash() const
+{
+    uint64_t hash = 0;
+    for (int32_t row = 0; row < BOARD_ROWS; row++)
+    {
+        for (uint32_t bits = m_Rows[row]; bits != 0; bits &= bits - 1) {
+            hash ^= ZOBRIST_KEYS.cells[row][CountTrailingZeros(bits)];
+        }
+    }
+    return hash;
+}
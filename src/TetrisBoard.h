@@ -0,0 +1,104 @@
+#ifndef TETRISBOARD_H
+#define TETRISBOARD_H
+
+#include "TetrisConstants.h"
+#include "Tetrimino.h"
+
+#include <cstdint>
+
+
+//=======================
+//  Tetris Board
+//  - occupancy bitboard: one row mask per row (bit X set => tile X is occupied)
+//  - column masks: the same occupancy, one mask per column (bit N set => row N is
+//    occupied, row 0 = top hidden row); the floor is an extra, always set row
+//  - color plane: the Tetrimino type of each tile (used only for drawing)
+//  - Zobrist hash of the occupancy, kept up to date as tiles are set and lines removed
+//  Rows include the EXTRA_HEIGHT_TILES hidden rows, above the visible table.
+//=======================
+class TetrisBoard
+{
+public:
+    // constants for cell contents
+    static const int8_t EMPTY_CELL = -1;
+    static const int8_t OUTSIDE_CELL = 99;
+
+public:
+    TetrisBoard();
+
+    void Clear();
+
+    int8_t GetTile(int32_t tileX, int32_t tileY) const;
+    void SetTile(int32_t tileX, int32_t tileY, int8_t colorIndex);
+    bool IsOccupied(int32_t tileX, int32_t tileY) const;
+
+    uint16_t GetRowMask(int32_t tileY) const    { return m_Rows[tileY + EXTRA_HEIGHT_TILES]; }
+    bool IsFullLine(int32_t tileY) const        { return GetRowMask(tileY) == FULL_ROW_MASK; }
+    bool IsEmptyLine(int32_t tileY) const       { return GetRowMask(tileY) == 0; }
+
+    // Raw bitboards: all BOARD_ROWS row masks (hidden rows first), and the column masks
+    const uint16_t* GetRows() const                 { return m_Rows; }
+    uint32_t GetColumnMask(int32_t tileX) const     { return m_Cols[tileX]; }
+
+    // Zobrist hash of the occupied tiles (two boards with the same tiles have the same hash)
+    uint64_t GetHash() const                        { return m_nHash; }
+
+    // Highest occupied row (TABLE_HEIGHT_TILES if the board is empty)
+    int32_t GetTopRow() const;
+
+    bool DoesPieceCollide(const Tetrimino& tetro) const;
+    // How many rows the (non-colliding) piece can fall, before it rests on something
+    int32_t GetDropDistance(const Tetrimino& tetro) const;
+    void PlacePiece(const Tetrimino& tetro);
+
+    // SRS rotation: tries the wall kicks in order; returns the kick used, or -1 (piece unchanged)
+    int32_t RotatePiece(Tetrimino& tetro, bool bRight) const;
+    // T-Spin: a 'T' with at least 3 of the 4 corners around its center occupied
+    bool IsTSpinPosition(const Tetrimino& tetro) const;
+
+    // Full lines: FindFullLines() fills the list (top to bottom) and returns the count
+    int32_t FindFullLines(int32_t* pLines) const;
+    void RemoveLines(const int32_t* pLines, int32_t cntLines);
+
+
+private:
+    static bool IsInside(int32_t tileX, int32_t tileY)
+    {
+        return tileX >= 0 && tileX < TABLE_WIDTH_TILES
+            && tileY >= (-EXTRA_HEIGHT_TILES) && tileY < TABLE_HEIGHT_TILES;
+    }
+
+    uint64_t ComputeHash() const;
+
+private:
+    uint16_t m_Rows[BOARD_ROWS];
+    uint32_t m_Cols[TABLE_WIDTH_TILES];
+    int8_t m_Colors[BOARD_SIZE];
+    uint64_t m_nHash;
+};
+
+
+// (inline: it is called for every move, rotation and wall kick)
+inline bool TetrisBoard::DoesPieceCollide(const Tetrimino& tetro) const
+{
+    const TetroShape& shape = tetro.getShape();
+    int32_t left = tetro.getXOffset() + shape.xMin;
+    int32_t top = tetro.getYOffset() + shape.yMin;
+    // left/right edge, bottom edge and top (hidden rows) collision check
+    if (left < 0 || tetro.getXOffset() + shape.xMax >= TABLE_WIDTH_TILES
+        || top < (-EXTRA_HEIGHT_TILES) || tetro.getYOffset() + shape.yMax >= TABLE_HEIGHT_TILES)
+        return true;
+    // board contents collision check: one AND per piece row
+    const uint16_t* pRows = m_Rows + top + EXTRA_HEIGHT_TILES;
+    int32_t height = shape.yMax - shape.yMin + 1;
+    for (int32_t i = 0; i < height; i++)
+    {
+        if ((pRows[i] & (shape.rowMask[i] << left)) != 0)
+            return true;
+    }
+    // if we got here, we found no collision
+    return false;
+}
+
+
+#endif // TETRISBOARD_H
@@ -0,0 +1,256 @@
+#include "TetrisBot.h"
+#include "TetrisBoard.h"
+#include "TetrisConstants.h"
+
+#include <utility>
+
+
+/////////////////////////////////////////////
+//  GREEDY BOT
+/////////////////////////////////////////////
+
+int32_t TetrisGreedyBot::ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves)
+{
+    int32_t bestIdx = 0, bestScore = INT32_MIN, cntBest = 0;
+    for (int32_t i = 0; i < cntMoves; i++)
+    {
+        Tetrimino piece(pMoves[i].placement);
+        TetrisBoard after = engine.GetBoard();
+        after.PlacePiece(piece);
+        int32_t fullLines[TABLE_HEIGHT_TILES];
+        int32_t cntLines = after.FindFullLines(fullLines);
+        int32_t score = (piece.getYOffset() + piece.getShape().yMin) * 4 + cntLines * 8;
+        if (score > bestScore) {
+            bestIdx = i, bestScore = score, cntBest = 1;
+        }
+        else if (score == bestScore && m_Rng.NextBelow(++cntBest) == 0) {
+            bestIdx = i;
+        }
+    }
+    return bestIdx;
+}
+
+
+
+/////////////////////////////////////////////
+//  BOT PLAYER
+/////////////////////////////////////////////
+namespace
+{
+    // The actions raise the piece: a rotation kicks it up (from where the piece is, along the path)
+    bool IsKickingUp(const TetrisBoard& board, Tetrimino piece, const TetrisAction* pPath, int32_t cntActions)
+    {
+        for (int32_t i = 0; i < cntActions; i++)
+        {
+            int32_t y = piece.getYOffset();
+            switch (pPath[i])
+            {
+            case ACTION_MOVE_LEFT:      piece.move(-1, 0);                  break;
+            case ACTION_MOVE_RIGHT:     piece.move(+1, 0);                  break;
+            case ACTION_ROT_LEFT:       board.RotatePiece(piece, false);    break;
+            case ACTION_ROT_RIGHT:      board.RotatePiece(piece, true);     break;
+            case ACTION_SOFT_DROP:      piece.move(0, +1);                  break;
+            default:                                                        break;
+            }
+            if (piece.getYOffset() < y)
+                return true;
+        }
+        return false;
+    }
+}
+
+
+bool TetrisBotPlayer::PlayPiece(TetrisEngine& engine, TetrisBot& bot)
+{
+    // spawn the next piece (the time does not run while the bot moves it)
+    TetrisInput noInput;
+    engine.UpdateGame(noInput, 0);
+    if (engine.IsGameOver())
+        return false;
+
+    // the move planned by the bot (after HOLD, if planned so), or chosen among the moves of the piece
+    TetrisPlannedMove planned;
+    bool bPlanned = bot.PlanMove(engine, planned);
+    if (bPlanned && planned.bHold && engine.IsHoldAllowed()) {
+        TetrisInput input;
+        input.Set(ACTION_HOLD, true, false);
+        engine.UpdateGame(input, 0);
+    }
+    int32_t cntMoves = m_MoveGen.Generate(engine.GetBoard(), engine.GetCurrentPiece(), m_Moves, TetrisMoveGen::MAX_MOVES);
+    if (cntMoves == 0)
+        return false;
+    // (the move generator reports each placement once, with any rotation)
+    int32_t moveIdx = bPlanned ? TetrisMoveGen::FindMove(planned.placement, m_Moves, cntMoves) : -1;
+    if (moveIdx < 0)
+        moveIdx = bot.ChooseMove(engine, m_Moves, cntMoves);
+    PlayPath(engine, m_Path, m_MoveGen.GetPath(m_Moves[moveIdx], m_Path, TetrisMoveGen::CNT_NODES));
+    return true;
+}
+
+
+void TetrisBotPlayer::PlayPath(TetrisEngine& engine, const TetrisAction* pPath, int32_t cntActions)
+{
+    for (int32_t i = 0; i < cntActions; i++) {
+        TetrisInput input;
+        input.Set(pPath[i], true, false);
+        engine.UpdateGame(input, 0);
+    }
+}
+
+
+int32_t TetrisBotPlayer::PlayLinesAnimation(TetrisEngine& engine)
+{
+    // (no more: once the lines are removed, a step would spawn the next piece, and let it fall)
+    TetrisInput noInput;
+    int32_t nTicks = 0;
+    while (engine.IsDroppingLines() && !engine.IsGameOver()) {
+        engine.UpdateGame(noInput, FRAME_TICKS);
+        nTicks += FRAME_TICKS;
+    }
+    return nTicks;
+}
+
+
+TetrisGameResult TetrisBotPlayer::PlayGame(TetrisEngine& engine, TetrisBot& bot, int32_t maxPieces)
+{
+    TetrisGameResult result = {};
+    while (result.nPieces < maxPieces && PlayPiece(engine, bot))
+    {
+        result.nPieces++;
+        result.nTicks += PlayLinesAnimation(engine);
+    }
+
+    result.nScore = engine.GetScore();
+    result.nLines = engine.GetLines();
+    result.nLevel = engine.GetLevel();
+    return result;
+}
+
+
+TetrisInput TetrisBotPlayer::NextInput(const TetrisEngine& engine, TetrisBot& bot)
+{
+    // nothing to move (the engine spawns the next piece, or animates the lines)
+    TetrisInput input;
+    if (engine.IsGameOver() || engine.IsSpawnPending() || engine.IsDroppingLines()) {
+        m_bHasTarget = false;
+        m_nPathLen = 0;
+        m_bOffPath = false;
+        m_nPieceFrames = 0;
+        return input;
+    }
+
+    // (a safeguard, which should never be needed: the paths off the first one do not kick the
+    // piece up, so it keeps falling to where it locks; counted, so that a corpus can be checked)
+    if (++m_nPieceFrames > MAX_PIECE_FRAMES) {
+        m_bHasTarget = false;
+        m_nPathLen = 0;
+        m_nForcedDrops++;
+        input.Set(ACTION_HARD_DROP, true, false);
+        return input;
+    }
+
+    // still on the path? (gravity may have dropped the piece, instead of the soft drops)
+    const Tetrimino& piece = engine.GetCurrentPiece();
+    const TetroPlacement& current = piece.getPlacement();
+    if (m_nPathIdx < m_nPathLen)
+    {
+        bool bOnPath = (current.nType == m_Expected.nType && current.nRot == m_Expected.nRot && current.x == m_Expected.x);
+        while (bOnPath && current.y > m_Expected.y && m_Path[m_nPathIdx] == ACTION_SOFT_DROP) {
+            m_nPathIdx++;
+            m_Expected.y++;
+        }
+        if (!bOnPath || current.y > m_Expected.y) {
+            m_nPathLen = 0;
+            m_bOffPath = true;
+        }
+    }
+
+    if (m_nPathIdx >= m_nPathLen)
+    {
+        // new piece: the bot may plan its move (pressing HOLD first, this frame)
+        TetrisPlannedMove planned;
+        if (!m_bHasTarget && bot.PlanMove(engine, planned)) {
+            m_Target = planned.placement;
+            m_bHasTarget = true;
+            if (planned.bHold && engine.IsHoldAllowed()) {
+                input.Set(ACTION_HOLD, true, false);
+                return input;
+            }
+        }
+
+        // path from where the piece is now, to the target (or to a new move, if it can't be reached)
+        m_bGravityDrop = ((int64_t)engine.GetGravity() * FRAME_TICKS >= GRAVITY_ONE);
+        int32_t cntMoves = m_MoveGen.Generate(engine.GetBoard(), piece, m_Moves, TetrisMoveGen::MAX_MOVES, m_bGravityDrop);
+        if (cntMoves == 0)
+            return input;
+        int32_t moveIdx = m_bHasTarget ? TetrisMoveGen::FindMove(m_Target, m_Moves, cntMoves) : -1;
+        // off its path, the piece only takes the paths which do not kick it up: else each kick up
+        // (which resets the lock delay) would let the gravity pull it off the path again, forever
+        if (m_bOffPath)
+        {
+            if (moveIdx >= 0 && IsKickingUp(engine.GetBoard(), piece, m_Path,
+                                            m_MoveGen.GetPath(m_Moves[moveIdx], m_Path, TetrisMoveGen::CNT_NODES)))
+                moveIdx = -1;
+            if (moveIdx < 0)
+                cntMoves = KeepMovesNotKickingUp(engine.GetBoard(), piece, cntMoves);
+        }
+        if (moveIdx < 0) {
+            moveIdx = bot.ChooseMove(engine, m_Moves, cntMoves);
+            m_Target = m_Moves[moveIdx].placement;
+            m_bHasTarget = true;
+        }
+        m_nPathLen = m_MoveGen.GetPath(m_Moves[moveIdx], m_Path, TetrisMoveGen::CNT_NODES);
+        if (m_nPathLen == 0)
+            return input;
+        // the piece moves and rotates first, while it is in free air (and falls meanwhile):
+        // the path starts below the first soft drops (with gravity, the piece must first land)
+        m_nPathIdx = m_MoveGen.GetStartDrop();
+        m_Expected = current;
+        m_Expected.y = (int8_t)(m_Expected.y + m_nPathIdx);
+        m_nFreeAirY = m_bGravityDrop ? -BOARD_ROWS : m_Expected.y;
+    }
+
+    // higher than the path: catch up with soft drops, unless the path is still in free air
+    TetrisAction action = m_Path[m_nPathIdx];
+    if (current.y < m_Expected.y && (action == ACTION_SOFT_DROP || m_Expected.y > m_nFreeAirY)) {
+        input.Set(ACTION_SOFT_DROP, true, false);
+        return input;
+    }
+
+    // next action, and where it brings the piece on the path
+    m_nPathIdx++;
+    input.Set(action, true, false);
+    Tetrimino next(m_Expected);
+    switch (action)
+    {
+    case ACTION_MOVE_LEFT:      next.move(-1, 0);                               break;
+    case ACTION_MOVE_RIGHT:     next.move(+1, 0);                               break;
+    case ACTION_ROT_LEFT:       engine.GetBoard().RotatePiece(next, false);     break;
+    case ACTION_ROT_RIGHT:      engine.GetBoard().RotatePiece(next, true);      break;
+    case ACTION_SOFT_DROP:      next.move(0, +1);                               break;
+    default:
+        // the piece locks
+        m_bHasTarget = false;
+        m_nPathLen = 0;
+        break;
+    }
+    if (m_bGravityDrop)
+        next.move(0, engine.GetBoard().GetDropDistance(next));
+    m_Expected = next.getPlacement();
+    return input;
+}
+
+
+int32_t TetrisBotPlayer::KeepMovesNotKickingUp(const TetrisBoard& board, const Tetrimino& piece, int32_t cntMoves)
+{
+    // (the kept moves keep their order; if all of them kick up, they are all kept)
+    int32_t cntKept = 0;
+    for (int32_t i = 0; i < cntMoves; i++)
+    {
+        int32_t cntActions = m_MoveGen.GetPath(m_Moves[i], m_Path, TetrisMoveGen::CNT_NODES);
+        if (!IsKickingUp(board, piece, m_Path, cntActions))
+            std::swap(m_Moves[cntKept++], m_Moves[i]);
+    }
+    return (cntKept > 0) ? cntKept : cntMoves;
+}
+
@@ -0,0 +1,129 @@
+#ifndef TETRISBOT_H
+#define TETRISBOT_H
+
+#include "TetrisEngine.h"
+#include "TetrisMoveGen.h"
+#include "TetrisRandom.h"
+
+#include <cstdint>
+
+
+//=======================
+//  A move planned by a bot: where the piece locks, after an optional HOLD
+//=======================
+struct TetrisPlannedMove
+{
+    bool bHold;                 // HOLD first (the placement is then for the piece which comes out)
+    TetroPlacement placement;
+};
+
+
+
+//=======================
+//  Bot interface: chooses where each piece locks, among the moves found by
+//  the move generator. A bot instance is used by one thread at a time.
+//=======================
+class TetrisBot
+{
+public:
+    virtual ~TetrisBot() {}
+
+    virtual const char* GetName() const = 0;
+    virtual void NewGame(uint64_t seed)     {}
+
+    // Returns the index of the chosen move
+    virtual int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) = 0;
+
+    // Bots which look ahead (NEXT pieces, HOLD) plan the move themselves;
+    // returns false to let ChooseMove() choose among the moves of the current piece
+    virtual bool PlanMove(const TetrisEngine& engine, TetrisPlannedMove& move)  { return false; }
+};
+
+
+
+//=======================
+//  Greedy bot: lowest placement, then most lines (ties broken at random)
+//=======================
+class TetrisGreedyBot : public TetrisBot
+{
+public:
+    const char* GetName() const override    { return "Greedy"; }
+    void NewGame(uint64_t seed) override    { m_Rng.Seed(seed); }
+
+    int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) override;
+
+private:
+    TetrisRng m_Rng;
+};
+
+
+
+//=======================
+//  Bot player: plays games with a bot, through the engine input
+//  (so the engine rules apply exactly as for a human player)
+//=======================
+struct TetrisGameResult
+{
+    int32_t nScore;
+    int32_t nLines;
+    int32_t nLevel;
+    int32_t nPieces;
+    int64_t nTicks;         // game time (of the lines animations: the pieces move without the time running)
+};
+
+
+class TetrisBotPlayer
+{
+public:
+    // Game time of each step of the lines animation, and of each frame of real-time play (60 FPS)
+    static const int32_t FRAME_TICKS = 16;
+    // Real-time play (a safeguard): a piece still moving after this many frames is hard-dropped where it is
+    static const int32_t MAX_PIECE_FRAMES = 5 * TICKS_PER_SECOND / FRAME_TICKS;
+
+public:
+    TetrisBotPlayer() : m_bHasTarget(false), m_nPathIdx(0), m_nPathLen(0), m_bGravityDrop(false), m_bOffPath(false),
+                        m_nPieceFrames(0), m_nForcedDrops(0) {}
+
+    // Spawns the next piece, then feeds the actions of the chosen move (returns false on game over)
+    bool PlayPiece(TetrisEngine& engine, TetrisBot& bot);
+    // Feeds the actions of a path (of TetrisMoveGen) to the engine, with no time running
+    static void PlayPath(TetrisEngine& engine, const TetrisAction* pPath, int32_t cntActions);
+    // Runs the lines animation of the last lock, if any (the next piece is left to spawn in the next
+    // PlayPiece(), before any time runs): returns the game time it took
+    static int32_t PlayLinesAnimation(TetrisEngine& engine);
+    // Plays until game over, or until maxPieces were locked
+    TetrisGameResult PlayGame(TetrisEngine& engine, TetrisBot& bot, int32_t maxPieces);
+
+    // Real-time play (e.g. a demo, while the time runs): the input of the next frame, one action
+    // per frame (of FRAME_TICKS) along the path to the chosen move (the path is searched again if
+    // gravity pulls the piece off it, without kicking the piece up, and a new move is chosen if it
+    // becomes unreachable)
+    TetrisInput NextInput(const TetrisEngine& engine, TetrisBot& bot);
+    // Pieces of the real-time play hard-dropped by the MAX_PIECE_FRAMES safeguard (none expected)
+    int64_t GetForcedDropCount() const      { return m_nForcedDrops; }
+
+private:
+    // Puts first the moves (of the last Generate() call) whose path does not kick the piece up,
+    // and returns their count (all the moves, if there are none)
+    int32_t KeepMovesNotKickingUp(const TetrisBoard& board, const Tetrimino& piece, int32_t cntMoves);
+
+private:
+    // real-time play: the target move, and the path to it
+    bool m_bHasTarget;
+    TetroPlacement m_Target;
+    int32_t m_nPathIdx;
+    int32_t m_nPathLen;
+    TetroPlacement m_Expected;      // where the path brings the piece, before its next action
+    int32_t m_nFreeAirY;            // the piece may be higher than the path, while the path is above this row
+    bool m_bGravityDrop;            // the gravity drops the piece after each action (1 row per frame, or more)
+    bool m_bOffPath;                // the current piece left a path: the next ones do not kick it up
+    int32_t m_nPieceFrames;         // frames played with the current piece
+    int64_t m_nForcedDrops;
+
+    TetrisMoveGen m_MoveGen;
+    TetrisMove m_Moves[TetrisMoveGen::MAX_MOVES];
+    TetrisAction m_Path[TetrisMoveGen::CNT_NODES];
+};
+
+
+#endif // TETRISBOT_H
@@ -2,6 +2,7 @@
 #define TETRIS_CONSTANTS_H
 
 #include <cstddef>
+#include <cstdint>
 
 const int32_t CNT_TETRIMINOS = 7;
 const int32_t CNT_NEXT_PIECES = 3;
@@ -15,7 +16,10 @@ const int32_t TILE_PIXELS = 12;
 const int32_t TABLE_WIDTH_TILES = 10;
 const int32_t TABLE_HEIGHT_TILES = 20;
 const int32_t EXTRA_HEIGHT_TILES = 6;
-const size_t BOARD_SIZE = TABLE_WIDTH_TILES * (TABLE_HEIGHT_TILES + EXTRA_HEIGHT_TILES);
+const int32_t BOARD_ROWS = TABLE_HEIGHT_TILES + EXTRA_HEIGHT_TILES;
+const size_t BOARD_SIZE = TABLE_WIDTH_TILES * BOARD_ROWS;
+const uint16_t FULL_ROW_MASK = (uint16_t)((1 << TABLE_WIDTH_TILES) - 1);
+const uint32_t FLOOR_MASK = (uint32_t)1 << BOARD_ROWS;
 
 const int32_t TABLE_WIDTH_PIXELS = TABLE_WIDTH_TILES * TILE_PIXELS;
 const int32_t TABLE_HEIGHT_PIXELS = TABLE_HEIGHT_TILES * TILE_PIXELS;
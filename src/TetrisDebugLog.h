@@ -0,0 +1,66 @@
+#ifndef TETRISDEBUGLOG_H
+#define TETRISDEBUGLOG_H
+
+#include <cstdint>
+#include <string>
+
+
+/////////////////////////////////////////////
+//  DEBUG Logging
+//  (set TETRIS_DEBUG_LOG to 1 to enable it)
+/////////////////////////////////////////////
+#ifndef TETRIS_DEBUG_LOG
+#define TETRIS_DEBUG_LOG 0
+#endif
+
+namespace TetrisDebugLog
+{
+    const int32_t NO_NUMBER = 0x7FFF7FFF;
+    const int32_t CNT_LOG_LINES = 14;
+
+#if TETRIS_DEBUG_LOG
+    inline std::string* Lines() {
+        static std::string logLines[CNT_LOG_LINES];
+        return logLines;
+    }
+
+    inline uint32_t& LineCounter() {
+        static uint32_t lineCounter = 0;
+        return lineCounter;
+    }
+#endif
+}
+
+
+#if TETRIS_DEBUG_LOG
+
+inline void debuglogReset()
+{
+    std::string* logLines = TetrisDebugLog::Lines();
+    for (int i = 0; i < TetrisDebugLog::CNT_LOG_LINES; i++) {
+        logLines[i] = "";
+    }
+}
+
+inline void debuglogAppend(const char* strToLog, int32_t val = TetrisDebugLog::NO_NUMBER)
+{
+    std::string* logLines = TetrisDebugLog::Lines();
+    int lastIdx = TetrisDebugLog::CNT_LOG_LINES - 1;
+    for (int i = 0; i < lastIdx; i++) {
+        logLines[i] = logLines[i + 1];
+    }
+    uint32_t lineCounter = ++TetrisDebugLog::LineCounter();
+
+    std::string strval = (val == TetrisDebugLog::NO_NUMBER) ? "" : std::to_string(val);
+    logLines[lastIdx] = std::to_string(lineCounter) + std::string("> ") + std::string(strToLog) + strval;
+}
+
+#else
+
+inline void debuglogReset() {}
+inline void debuglogAppend(const char* strToLog, int32_t val = 0) {}
+
+#endif
+
+
+#endif // TETRISDEBUGLOG_H
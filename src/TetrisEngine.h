@@ -1,100 +1,114 @@
 #ifndef TETRISENGINE_H
 #define TETRISENGINE_H
 
-#include "olcPixelGameEngine.h"
+#include "TetrisBoard.h"
 #include "TetrisConstants.h"
+#include "TetrisRandom.h"
 #include "Tetrimino.h"
 
 #include <cstdint>
+#include <type_traits>
+
+
+// The simulation advances in integer ticks (1 tick = 1 millisecond),
+// so that it is deterministic and independent of the frame rate
+const int32_t TICKS_PER_SECOND = 1000;
+
+// A single piece can complete up to 4 lines
+const int32_t MAX_LINES_PER_LOCK = 4;
+
+// Gravity (fall speed) is in 16.16 fixed point rows per tick
+const int32_t GRAVITY_ONE = 1 << 16;                // 1 row per tick
+const int32_t GRAVITY_20G = 20 * GRAVITY_ONE;       // the piece falls to the bottom instantly
+
 
 
 //=======================
-// Game Settings
+// Game Rules
+// (the settings which affect the simulation)
 //=======================
-struct TetrisSettings
+struct TetrisRules
 {
     int32_t nStartLevel;
-    olc::Key keyMoveLeft;
-    olc::Key keyMoveRight;
-    olc::Key keyRotLeft;
-    olc::Key keyRotRight;
-    olc::Key keySoftDrop;
-    olc::Key keyHardDrop;
-    olc::Key keyHold;
-    bool bShowGrid;
-    bool bShowGhost;
 
     // Key auto-repeat timings (in milliseconds)
     int32_t nDelayAutoRepeatMs;
     int32_t nSpeedAutoRepeatMs;
 
-    // Sound volumes (as percentage, 0-100)
-    int32_t nMusicVolume;
-    int32_t nFxVolume;
+    // Fixed gravity (in GRAVITY_ONE units), or 0 to use the gravity of the current level
+    int32_t nGravity;
 };
 
 
 
 //=======================
-//  Tetris Game Engine
+// Input Actions
 //=======================
-class TetrisEngine
+enum TetrisAction
 {
-public:
-    TetrisEngine(olc::PixelGameEngine* pPGE, olc::Sprite* pTilesSprite, const TetrisSettings& m_Settings);
-
-    void UpdateGame(float fElapsedTime);
-
-    bool IsGameOver() const     { return m_bGameOver; }
-    int32_t GetScore() const    { return m_nScore;    }
-    int32_t GetLevel() const    { return m_nLevel;    }
-    int32_t GetLines() const    { return m_nLines;    }
-
-
-private:
-    void RandomNextPiece();
-    bool PerformMove(int32_t deltaX, int32_t deltaY);
-    bool PerformRotateLeft();
-    bool PerformRotateRight();
-    bool CheckKeyWithAutoRepeat(olc::Key key, float fElapsedTime);
-    void LockCurrentPiece();
-    bool DoesPieceCollide(const Tetrimino& tetro);
-    bool CurrentPieceCollides()     { return DoesPieceCollide(m_CurrentPiece); }
-
-    void DrawGameScreen(float fElapsedTime, int32_t fadeLevel);
-    void DrawDroppedLines(float fElapsedTime);
-    void DrawBoardContents(int32_t fadeLevel = FADE_OUT_STEPS);
+    ACTION_MOVE_LEFT,
+    ACTION_MOVE_RIGHT,
+    ACTION_ROT_LEFT,
+    ACTION_ROT_RIGHT,
+    ACTION_SOFT_DROP,
+    ACTION_HARD_DROP,
+    ACTION_HOLD,
+    CNT_ACTIONS
+};
 
-    void DrawTetroTile(int screenX, int screenY, int8_t colorIndex, int32_t fadeLevel = FADE_OUT_STEPS);
-    void DrawTetriminoOnBoard(const Tetrimino& tetro, int32_t fadeLevel = FADE_OUT_STEPS);
-    void DrawTetriminoAnywhere(const Tetrimino& tetro, int screenX, int screenY);
 
-    int8_t GetBoardTile(int32_t tileX, int32_t tileY);
-    void SetBoardTile(int32_t tileX, int32_t tileY, int8_t colorIndex);
+// The state of all action "buttons", for one update
+struct TetrisInput
+{
+    uint8_t nPressed;   // bit mask of actions which were pressed just now
+    uint8_t nHeld;      // bit mask of actions which are being held down
+
+    TetrisInput()
+        : nPressed(0), nHeld(0)
+    {}
+
+    void Set(TetrisAction action, bool bPressed, bool bHeld)
+    {
+        uint8_t mask = (uint8_t)(1 << action);
+        nPressed = bPressed ? (nPressed | mask) : (nPressed & ~mask);
+        nHeld = bHeld ? (nHeld | mask) : (nHeld & ~mask);
+    }
+
+    bool IsPressed(TetrisAction action) const   { return ((nPressed >> action) & 0x01) != 0; }
+    bool IsHeld(TetrisAction action) const      { return ((nHeld >> action) & 0x01) != 0;    }
+};
 
-    void CheckForTSpinAfterRotate();
 
 
-private:
-    olc::PixelGameEngine* m_pPGE;
-    olc::Sprite* m_pTilesSprite;
-    const TetrisSettings& m_Settings;
+//=======================
+//  Tetris Engine State
+//  All the data of a running game, as plain data: it can be saved and
+//  restored with a memcpy (e.g. for searching moves or for rollback).
+//=======================
+struct TetrisEngineState
+{
+    TetrisRules m_Rules;
 
     bool m_bGameOver;
     bool m_bSpawnNextPiece;
 
     // The board
-    int8_t m_Board[BOARD_SIZE];
+    TetrisBoard m_Board;
 
     // Current Scores
     int32_t m_nScore;
     int32_t m_nLevel;
     int32_t m_nLines;
+    int32_t m_nPieces;      // pieces spawned so far
 
-    // Timing (fall speed)
-    float m_fFallDuration;
-    float m_fCurrentTime;
-    float m_fMovingLockTime;
+    // Fall speed: gravity of the current level + the fraction of a row fallen so far
+    int32_t m_nGravity;
+    int64_t m_nGravityAccum;
+
+    // Timing, in ticks
+    int32_t m_nCurrentTime;
+    int32_t m_nMovingLockTime;
+    bool m_bPieceResting;
 
     // Current + next Tetriminos
     Tetrimino m_CurrentPiece;
@@ -105,22 +119,109 @@ private:
     bool m_bIsPieceHeld;       // set to TRUE if HOLD area holds something
     bool m_bAllowedToHold;     // set to FALSE if HOLD was used during current piece
 
-    // Random Bag - https://tetris.fandom.com/wiki/Random_Generator
-    uint8_t m_RandomBag[CNT_TETRIMINOS];
-    int32_t m_nRandomBagIndex;
+    // State of the piece randomizer, seeded per engine
+    RandomizerState m_RandomState;
 
     // Auto-repeat support for LEFT, RIGHT and SOFT-DROP
-    float m_fAutoRepeatCountdown;
+    int32_t m_nAutoRepeatCountdown;
 
     // Helper variable for T-Spin checking
     bool m_PerformedTSpin;
 
     // Messages for: lines removed, T-Spin, Next Level
     int32_t m_AnimationFlags;
-    float m_fAnimationTimer;
+    int32_t m_nAnimationTimer;
 
     // List of lines that are in being dropped (for animation)
-    std::vector<int32_t> m_LinesBeingDropped;
+    int32_t m_LinesBeingDropped[MAX_LINES_PER_LOCK];
+    int32_t m_nCntLinesBeingDropped;
+};
+
+static_assert(std::is_trivially_copyable<TetrisEngineState>::value, "TetrisEngineState must be copyable with memcpy");
+
+
+
+//=======================
+//  Tetris Game Engine
+//  (the simulation only - it does not draw anything and does not read any keys)
+//=======================
+class TetrisEngine : private TetrisEngineState
+{
+public:
+    // Flags for the messages to be shown after a lock
+    enum {
+        ANIM_LINES_MASK = 0x07,
+        ANIM_TSPIN      = 0x08,
+        ANIM_FULL_CLEAR = 0x10,
+    };
+
+public:
+    TetrisEngine(const TetrisRules& rules, uint64_t nSeed, const TetrisRandomizer* pRandomizer = nullptr);
+
+    void UpdateGame(const TetrisInput& input, int32_t nTicks);
+    void SetRules(const TetrisRules& rules)     { m_Rules = rules; }
+
+    // Snapshot of the whole game (the randomizer is not part of it: it is stateless)
+    const TetrisEngineState& GetState() const   { return *this; }
+    void SaveState(TetrisEngineState& state) const;
+    void RestoreState(const TetrisEngineState& state);
+    // Zobrist hash of the position: the board, the current piece (and where it is), the NEXT queue
+    // and HOLD; a cheap identity of the game state (e.g. to detect that a replay has desynced)
+    uint64_t GetStateHash() const;
+
+    bool IsGameOver() const     { return m_bGameOver; }
+    int32_t GetScore() const    { return m_nScore;    }
+    int32_t GetLevel() const    { return m_nLevel;    }
+    int32_t GetLines() const    { return m_nLines;    }
+    int32_t GetPieceCount() const   { return m_nPieces; }
+
+    // Read-only access to the game state (e.g. for drawing it)
+    int8_t GetBoardTile(int32_t tileX, int32_t tileY) const;
+    const TetrisBoard& GetBoard() const                 { return m_Board;            }
+    const Tetrimino& GetCurrentPiece() const            { return m_CurrentPiece;     }
+    const Tetrimino& GetNextPiece(int32_t idx) const    { return m_NextPieces[idx];  }
+    const Tetrimino& GetHeldPiece() const               { return m_HeldPiece;        }
+    bool IsPieceHeld() const                            { return m_bIsPieceHeld;     }
+    bool IsHoldAllowed() const                          { return m_bAllowedToHold;   }
+    // Gravity in use (rows per tick, as 16.16 fixed point)
+    int32_t GetGravity() const      { return (m_Rules.nGravity > 0) ? m_Rules.nGravity : m_nGravity; }
+    bool IsSpawnPending() const                         { return m_bSpawnNextPiece;  }
+    const TetrisRandomizer* GetPieceRandomizer() const  { return m_pRandomizer;      }
+    Tetrimino GetGhostPiece() const;
+
+    // Lock state: how close the resting piece is to being locked (0..1)
+    bool IsPieceResting() const                         { return m_bPieceResting;    }
+    float GetLockProgress() const;
+
+    // Full lines animation: progress (0..1) of the lines being dropped
+    bool IsDroppingLines() const                        { return m_nCntLinesBeingDropped > 0; }
+    bool IsLineBeingDropped(int32_t tileY) const;
+    float GetLineDropProgress() const;
+
+    // Messages for: lines removed, T-Spin, Full Clear
+    int32_t GetAnimationFlags() const                   { return m_AnimationFlags;   }
+    int32_t GetAnimationTimer() const                   { return m_nAnimationTimer;  }
+
+
+private:
+    void RandomNextPiece();
+    bool PerformMove(int32_t deltaX, int32_t deltaY);
+    bool PerformRotateLeft();
+    bool PerformRotateRight();
+    bool CheckKeyWithAutoRepeat(const TetrisInput& input, TetrisAction action, int32_t nTicks);
+    void LockCurrentPiece();
+    void UpdateDroppedLines(int32_t nTicks);
+    void UpdateAnimationTimer(int32_t nTicks);
+    void UpdateGravity();
+    bool DoesPieceCollide(const Tetrimino& tetro) const;
+    bool CurrentPieceCollides() const   { return DoesPieceCollide(m_CurrentPiece); }
+
+    void CheckForTSpinAfterRotate();
+
+
+private:
+    // Piece randomizer (7-bag by default)
+    const TetrisRandomizer* m_pRandomizer;
 };
 
 
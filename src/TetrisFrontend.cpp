@@ -0,0 +1,360 @@
+#include "TetrisFrontend.h"
+#include "TetrisDebugLog.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+using namespace olc;
+
+
+
+/////////////////////////////////////////////
+//  DEBUG Logging (drawing)
+/////////////////////////////////////////////
+namespace
+{
+#if TETRIS_DEBUG_LOG
+    const int32_t LOG_X = 270;
+    const int32_t LOG_Y = 170;
+
+    bool displayDebugLog = false;
+
+    void debuglogDraw(PixelGameEngine* pPGE)
+    {
+        if (pPGE->GetKey(Key::TAB).bPressed) {
+            displayDebugLog = (!displayDebugLog);
+        }
+        if (!displayDebugLog) return;
+
+        const string* logLines = TetrisDebugLog::Lines();
+        uint32_t lineCounter = TetrisDebugLog::LineCounter();
+        pPGE->FillRect(LOG_X, LOG_Y, SCREEN_WIDTH_PIXELS - LOG_X, SCREEN_HEIGHT_PIXELS - LOG_Y, BLACK);
+        pPGE->DrawRect(LOG_X, LOG_Y, SCREEN_WIDTH_PIXELS - LOG_X, SCREEN_HEIGHT_PIXELS - LOG_Y, CYAN);
+        int y = LOG_Y + 2;
+        for (uint32_t i = 0; i < TetrisDebugLog::CNT_LOG_LINES; i++) {
+            const Pixel& color = ((i % 2) == (lineCounter % 2)) ? WHITE : YELLOW;
+            pPGE->DrawString(LOG_X + 2, y, logLines[i], color);
+            y += 9;
+        }
+    }
+
+#else
+    void debuglogDraw(PixelGameEngine* pPGE) {}
+
+#endif
+}
+
+
+
+/////////////////////////////////////////////
+//  GAME SETTINGS
+/////////////////////////////////////////////
+
+TetrisRules TetrisSettings::GetRules() const
+{
+    TetrisRules rules;
+    rules.nStartLevel = nStartLevel;
+    rules.nDelayAutoRepeatMs = nDelayAutoRepeatMs;
+    rules.nSpeedAutoRepeatMs = nSpeedAutoRepeatMs;
+    rules.nGravity = 0;
+    return rules;
+}
+
+
+
+/////////////////////////////////////////////
+//  TETRIS GAME FRONTEND
+/////////////////////////////////////////////
+namespace
+{
+    // Demo AI: beam search on the frame thread, within a quarter of a frame
+    const int32_t DEMO_BEAM_WIDTH = 32;
+    const int64_t DEMO_PLAN_MICROS = 4000;
+
+    // Simulation step (one frame, at 60 FPS)
+    const int32_t STEP_TICKS = TetrisBotPlayer::FRAME_TICKS;
+
+    bool MakeDirectory(const char* pPath)
+    {
+#ifdef _WIN32
+        return _mkdir(pPath) == 0 || errno == EEXIST;
+#else
+        return mkdir(pPath, 0755) == 0 || errno == EEXIST;
+#endif
+    }
+}
+
+
+TetrisFrontend::TetrisFrontend(PixelGameEngine* pPGE, Sprite* pTilesSprite, const TetrisSettings& settings, bool bAutoPlay)
+: m_pPGE(pPGE)
+, m_pTilesSprite(pTilesSprite)
+, m_Settings(settings)
+, m_nSeed((uint64_t) chrono::high_resolution_clock::now().time_since_epoch().count())
+, m_Engine(settings.GetRules(), m_nSeed)
+, m_fTickRemainder(0.0f)
+, m_PendingInput()
+, m_bReplay(false)
+, m_bAutoPlay(bAutoPlay)
+, m_AI(DEMO_BEAM_WIDTH, DEMO_PLAN_MICROS)
+{
+    m_Replay.Start(settings.GetRules(), m_nSeed);
+}
+
+
+// Game loop for RUNNING GAME
+void TetrisFrontend::UpdateGame(float fElapsedTime)
+{
+    // settings may have been changed from the options menu, during the game
+    TetrisRules rules = m_Settings.GetRules();
+    m_Engine.SetRules(rules);
+    m_Replay.RecordRules(rules);
+
+    // run the simulation, converting the frame time into whole steps
+    // (the keys are read once per frame: they are pressed in the first step)
+    m_fTickRemainder += fElapsedTime * TICKS_PER_SECOND;
+    if (!m_bAutoPlay) {
+        TetrisInput input = ReadInput();
+        m_PendingInput.nPressed |= input.nPressed;
+        m_PendingInput.nHeld = input.nHeld;
+    }
+    while (m_fTickRemainder >= (float) STEP_TICKS && !m_Engine.IsGameOver())
+    {
+        m_fTickRemainder -= (float) STEP_TICKS;
+        TetrisInput input = m_bAutoPlay ? m_AutoPlayer.NextInput(m_Engine, m_AI) : m_PendingInput;
+        m_PendingInput.nPressed = 0;
+        m_Replay.Record(input, STEP_TICKS);
+        m_Engine.UpdateGame(input, STEP_TICKS);
+        m_Replay.RecordKeyframe(m_Engine);
+    }
+    if (m_Engine.IsGameOver()) return;
+
+    DrawScreen();
+}
+
+
+void TetrisFrontend::DrawScreen()
+{
+    if (m_Engine.IsDroppingLines()) {
+        // animate fading lines
+        int32_t fadeLevel = (int32_t) ((1.0f - m_Engine.GetLineDropProgress()) * FADE_OUT_STEPS);
+        DrawBoardContents(fadeLevel);
+    }
+    else {
+        DrawGameScreen();
+    }
+}
+
+
+bool TetrisFrontend::SaveReplay(const char* pDirectory)
+{
+    if (m_bReplay)
+        return false;
+    m_Replay.Finish(m_Engine);
+    char path[256];
+    snprintf(path, sizeof(path), "%s/tetris_%016llx.trp", pDirectory, (unsigned long long) m_nSeed);
+    return MakeDirectory(pDirectory) && m_Replay.Save(path);
+}
+
+
+bool TetrisFrontend::OpenReplay(const char* pPath)
+{
+    if (!m_ReplayPlayer.Load(pPath))
+        return false;
+    m_bReplay = true;
+    m_bAutoPlay = false;
+    m_Engine = m_ReplayPlayer.GetEngine();
+    m_fTickRemainder = 0.0f;
+    return true;
+}
+
+
+// Game loop for a REPLAY
+void TetrisFrontend::UpdateReplay(float fElapsedTime, int32_t nSpeed)
+{
+    // (the whole ticks of the frame time, at this speed)
+    m_fTickRemainder += fElapsedTime * TICKS_PER_SECOND * (float) nSpeed;
+    int64_t nTicks = (int64_t) m_fTickRemainder;
+    m_fTickRemainder -= (float) nTicks;
+    m_ReplayPlayer.Play(nTicks);
+    m_Engine = m_ReplayPlayer.GetEngine();
+
+    DrawScreen();
+}
+
+
+TetrisInput TetrisFrontend::ReadInput() const
+{
+    TetrisInput input;
+    auto ReadKey = [&](TetrisAction action, Key key) {
+        HWButton button = m_pPGE->GetKey(key);
+        input.Set(action, button.bPressed, button.bHeld);
+    };
+
+    ReadKey(ACTION_MOVE_LEFT, m_Settings.keyMoveLeft);
+    ReadKey(ACTION_MOVE_RIGHT, m_Settings.keyMoveRight);
+    ReadKey(ACTION_ROT_LEFT, m_Settings.keyRotLeft);
+    ReadKey(ACTION_ROT_RIGHT, m_Settings.keyRotRight);
+    ReadKey(ACTION_SOFT_DROP, m_Settings.keySoftDrop);
+    ReadKey(ACTION_HARD_DROP, m_Settings.keyHardDrop);
+    ReadKey(ACTION_HOLD, m_Settings.keyHold);
+    return input;
+}
+
+
+void TetrisFrontend::DrawGameScreen()
+{
+    DrawBoardContents();
+
+    // Draw current piece (unless it was just locked)
+    if (!m_Engine.IsSpawnPending())
+    {
+        const Tetrimino& currentPiece = m_Engine.GetCurrentPiece();
+
+        // Draw ghost piece
+        if (m_Settings.bShowGhost)
+        {
+            Tetrimino ghostPiece = m_Engine.GetGhostPiece();
+            // draw only if the ghost Y position is different from the current piece
+            if (ghostPiece.getY(0) != currentPiece.getY(0))
+            {
+                DrawTetriminoOnBoard(ghostPiece, 0);
+            }
+        }
+
+        // Calculate fade level if piece could lock
+        int32_t fadeLevel = FADE_OUT_STEPS;
+        if (m_Engine.IsPieceResting()) {
+            float f = 1.0f - m_Engine.GetLockProgress();
+            fadeLevel = 1 + (int32_t)(f * FADE_OUT_STEPS);
+        }
+        DrawTetriminoOnBoard(currentPiece, fadeLevel);
+    }
+
+    // Draw Score, Level, Lines
+    m_pPGE->DrawString(28, 202, to_string(m_Engine.GetScore()), WHITE);
+    m_pPGE->DrawString(28, 232, to_string(m_Engine.GetLevel()), WHITE);
+    m_pPGE->DrawString(28, 262, to_string(m_Engine.GetLines()), WHITE);
+    if (m_bAutoPlay)
+        m_pPGE->DrawString(28, 284, "DEMO", YELLOW);
+    else if (m_bReplay)
+        m_pPGE->DrawString(28, 284, "REPLAY", YELLOW);
+
+    // Draw HOLD Tetrimino
+    if (m_Engine.IsPieceHeld())
+        DrawTetriminoAnywhere(m_Engine.GetHeldPiece(), 2, 58);
+
+    // Draw NEXT Tetriminos
+    for (int i = 0; i < CNT_NEXT_PIECES; i++) {
+        DrawTetriminoAnywhere(m_Engine.GetNextPiece(i), 285, (2 * TILE_PIXELS + 8) * i + 52);
+    }
+
+    // TODO Draw special animations
+    int32_t animationFlags = m_Engine.GetAnimationFlags();
+    if (animationFlags > 0) {
+        // build string
+        string msg;
+        msg.reserve(256);
+        int lines = (animationFlags & TetrisEngine::ANIM_LINES_MASK);
+        if (lines > 0) {
+            msg.append(to_string(lines));
+            msg.append(" Lines");
+        }
+        if ((animationFlags & TetrisEngine::ANIM_TSPIN) != 0) {
+            msg.append(" Tspin");
+        }
+        if ((animationFlags & TetrisEngine::ANIM_FULL_CLEAR) != 0) {
+            msg.append(" FullCLr");
+        }
+        // draw string
+        int k = (m_Engine.GetAnimationTimer() * 3 / TICKS_PER_SECOND) & 0x01;
+        m_pPGE->FillRect(130, 282, 140, 12, VERY_DARK_GREY);
+        m_pPGE->DrawString(134, 284, msg, (k == 0) ? CYAN : GREEN);
+    }
+
+    // Draw LOG
+    debuglogDraw(m_pPGE);
+}
+
+
+void TetrisFrontend::DrawBoardContents(int32_t fadeLevel)
+{
+    // Draw board contents
+    for (int32_t y = 0; y < TABLE_HEIGHT_TILES; y++)
+    {
+        // check for fade level
+        int32_t lineFadeLevel = FADE_OUT_STEPS;
+        if (fadeLevel != FADE_OUT_STEPS)
+        {
+            bool fadeLine = m_Engine.IsLineBeingDropped(y);
+            lineFadeLevel = fadeLine ? fadeLevel : FADE_OUT_STEPS;
+        }
+        for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++)
+        {
+            int32_t screenX = TABLE_START_X + x * TILE_PIXELS;
+            int32_t screenY = TABLE_START_Y + y * TILE_PIXELS;
+            int8_t colIdx = m_Engine.GetBoardTile(x, y);
+            DrawTetroTile(screenX, screenY, colIdx, lineFadeLevel);
+        }
+    }
+}
+
+
+// Draw a Tetrimino tile
+void TetrisFrontend::DrawTetroTile(int screenX, int screenY, int8_t colorIndex, int32_t fadeLevel)
+{
+    int32_t ox = 0, oy = 0;
+    if (colorIndex < 0)
+    {
+        // draw empty grid cell
+        oy = (m_Settings.bShowGrid ? 1 : 0);
+    }
+    else
+    {
+        // draw colorful tile
+        ox = 1 + (colorIndex % CNT_TETRIMINOS);
+        oy = max(fadeLevel, 0);
+        // if fade too large => empty cell instead
+        if (oy > FADE_OUT_STEPS) {
+            ox = 0, oy = (m_Settings.bShowGrid ? 1 : 0);
+        }
+    }
+
+    m_pPGE->DrawPartialSprite(screenX, screenY, m_pTilesSprite,
+                               ox * TILE_PIXELS, oy * TILE_PIXELS,
+                               TILE_PIXELS, TILE_PIXELS, 1);
+}
+
+
+void TetrisFrontend::DrawTetriminoOnBoard(const Tetrimino& tetro, int32_t fadeLevel)
+{
+    for (int i = 0; i < 4; i++) {
+        // draw each tile ONLY if it fits on the board
+        int tileX = tetro.getX(i);
+        int tileY = tetro.getY(i);
+        if (tileX >= 0 && tileX < TABLE_WIDTH_TILES && tileY >= 0 && tileY < TABLE_HEIGHT_TILES) {
+            int32_t startX = TABLE_START_X + tileX * TILE_PIXELS;
+            int32_t startY = TABLE_START_Y + tileY * TILE_PIXELS;
+            DrawTetroTile(startX, startY, tetro.getTypeIndex(), fadeLevel);
+        }
+    }
+}
+
+
+void TetrisFrontend::DrawTetriminoAnywhere(const Tetrimino& tetro, int screenX, int screenY)
+{
+    // adjust vertical offset for I tetro in NEXT and HOLD (so that it looks good)
+    int32_t offsY = (tetro.getTypeChar() == 'I') ? (TILE_PIXELS / 2) : 0;
+    for (int i = 0; i < 4; i++) {
+        int32_t startX = screenX + tetro.getX(i) * TILE_PIXELS;
+        int32_t startY = screenY + tetro.getY(i) * TILE_PIXELS + offsY;
+        DrawTetroTile(startX, startY, tetro.getTypeIndex());
+    }
+}
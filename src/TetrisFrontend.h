@@ -0,0 +1,115 @@
+#ifndef TETRISFRONTEND_H
+#define TETRISFRONTEND_H
+
+#include "olcPixelGameEngine.h"
+#include "TetrisBeamSearch.h"
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisReplay.h"
+
+#include <cstdint>
+
+
+//=======================
+// Game Settings
+//=======================
+struct TetrisSettings
+{
+    int32_t nStartLevel;
+    olc::Key keyMoveLeft;
+    olc::Key keyMoveRight;
+    olc::Key keyRotLeft;
+    olc::Key keyRotRight;
+    olc::Key keySoftDrop;
+    olc::Key keyHardDrop;
+    olc::Key keyHold;
+    bool bShowGrid;
+    bool bShowGhost;
+
+    // Key auto-repeat timings (in milliseconds)
+    int32_t nDelayAutoRepeatMs;
+    int32_t nSpeedAutoRepeatMs;
+
+    // Sound volumes (as percentage, 0-100)
+    int32_t nMusicVolume;
+    int32_t nFxVolume;
+
+    TetrisRules GetRules() const;
+};
+
+
+
+//=======================
+//  Tetris Game Frontend
+//  (reads the keys, or lets the AI play, runs the TetrisEngine and draws its state;
+//  or shows a replay instead)
+//=======================
+class TetrisFrontend
+{
+public:
+    TetrisFrontend(olc::PixelGameEngine* pPGE, olc::Sprite* pTilesSprite, const TetrisSettings& settings, bool bAutoPlay = false);
+
+    void UpdateGame(float fElapsedTime);
+
+    bool IsGameOver() const     { return m_Engine.IsGameOver(); }
+    int32_t GetScore() const    { return m_Engine.GetScore();   }
+    int32_t GetLevel() const    { return m_Engine.GetLevel();   }
+    int32_t GetLines() const    { return m_Engine.GetLines();   }
+    bool IsAutoPlay() const     { return m_bAutoPlay;           }
+    bool IsReplay() const       { return m_bReplay;             }
+
+    const TetrisEngine& GetEngine() const   { return m_Engine; }
+
+    // Writes the replay of the game (so far) to a new file in this directory
+    bool SaveReplay(const char* pDirectory);
+
+    // Shows a replay file instead of playing (false if it can't be read)
+    bool OpenReplay(const char* pPath);
+    // Plays the replay at this speed (1 = real time, 0 = paused), and draws it
+    void UpdateReplay(float fElapsedTime, int32_t nSpeed);
+    TetrisReplayPlayer& GetReplayPlayer()   { return m_ReplayPlayer; }
+
+
+private:
+    TetrisInput ReadInput() const;
+
+    void DrawScreen();
+    void DrawGameScreen();
+    void DrawBoardContents(int32_t fadeLevel = FADE_OUT_STEPS);
+
+    void DrawTetroTile(int screenX, int screenY, int8_t colorIndex, int32_t fadeLevel = FADE_OUT_STEPS);
+    void DrawTetriminoOnBoard(const Tetrimino& tetro, int32_t fadeLevel = FADE_OUT_STEPS);
+    void DrawTetriminoAnywhere(const Tetrimino& tetro, int screenX, int screenY);
+
+
+private:
+    olc::PixelGameEngine* m_pPGE;
+    olc::Sprite* m_pTilesSprite;
+    const TetrisSettings& m_Settings;
+
+    // The Game
+    uint64_t m_nSeed;
+    TetrisEngine m_Engine;
+
+    // The simulation runs in steps of fixed time (so that the replay of their inputs is exact,
+    // and small): the frame time which was not yet consumed as a whole step, and the keys
+    // pressed during frames which did not run any step
+    float m_fTickRemainder;
+    TetrisInput m_PendingInput;
+
+    // Replay of the game (every step)
+    TetrisReplayRecorder m_Replay;
+
+    // Replay viewer: the engine is a copy of the player's
+    bool m_bReplay;
+    TetrisReplayPlayer m_ReplayPlayer;
+
+    // Demo: the AI plays instead of the keys (planning each piece within the frame)
+    bool m_bAutoPlay;
+    TetrisBeamBot m_AI;
+    TetrisBotPlayer m_AutoPlayer;
+};
+
+
+#endif // TETRISFRONTEND_H
@@ -0,0 +1,381 @@
+#include "TetrisMCTS.h"
+#include "TetrisZobrist.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+
+namespace
+{
+    const int64_t NO_DEADLINE = INT64_MAX;
+    const int32_t NO_ROLLOUT_LIMIT = INT32_MAX;
+    // without any limit, the search stops after this many rollouts
+    const int32_t DEFAULT_ROLLOUTS = 1000;
+
+    // the values are summed in fixed point (atomic adds)
+    const float VALUE_SCALE = 256.0f;
+    // score of each placement a simulation misses, after a game over (worse than any real placement)
+    const float GAME_OVER_SCORE = -2000.0f;
+
+    // PUCT: weight of the priors (the values are normalized to 0..1 among the children)
+    const float EXPLORATION = 1.5f;
+    // priors: softmax of the heuristic scores of the moves, at this temperature
+    const float PRIOR_TEMPERATURE = 20.0f;
+    // a leaf is expanded once it has been visited this many times (the first visits only roll out)
+    const int32_t EXPAND_VISITS = 1;
+
+    int64_t NowMicros()
+    {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+
+
+TetrisMCTS::TetrisMCTS(TetrisThreadPool* pPool, int32_t maxNodes, int32_t rolloutPieces, const TetrisAIWeights& weights)
+: m_pPool(pPool)
+, m_AI(weights)
+, m_nMaxNodes(max(maxNodes, 1 + 2 * MAX_PIECE_MOVES))
+, m_nHorizon(SEQUENCE_LENGTH + max(rolloutPieces, 0))
+, m_pNodes(new Node[m_nMaxNodes])
+, m_nCntNodes(0)
+, m_pRandomizer(nullptr)
+, m_nSeed(0)
+, m_nNextRollout(0)
+, m_nMaxRollouts(0)
+, m_nDeadline(NO_DEADLINE)
+, m_nRollouts(0)
+, m_nElapsedMicros(0)
+{
+    // one scratch per simulating task: as many tasks as the workers + the calling thread
+    int32_t cntTasks = 1 + ((pPool != nullptr) ? pPool->GetThreadCount() : 0);
+    m_Scratch.resize(cntTasks);
+}
+
+
+double TetrisMCTS::GetRolloutsPerSecond() const
+{
+    return (m_nElapsedMicros > 0) ? m_nRollouts * 1e6 / m_nElapsedMicros : 0.0;
+}
+
+
+
+/////////////////////////////////////////////
+//  SEARCH
+/////////////////////////////////////////////
+
+bool TetrisMCTS::Plan(const TetrisEngine& engine, int64_t budgetMicros, int32_t maxRollouts, TetrisPlannedMove& move)
+{
+    int64_t startTime = NowMicros();
+    m_nDeadline = (budgetMicros > 0) ? startTime + budgetMicros : NO_DEADLINE;
+    m_nMaxRollouts = (maxRollouts > 0) ? maxRollouts : (budgetMicros > 0) ? NO_ROLLOUT_LIMIT : DEFAULT_ROLLOUTS;
+
+    // the pieces, in the order they come
+    m_Sequence[0] = engine.GetCurrentPiece().getTypeIndex();
+    for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+        m_Sequence[1 + i] = engine.GetNextPiece(i).getTypeIndex();
+    }
+    // the pieces after them: sampled from the randomizer, from where the engine is
+    m_pRandomizer = engine.GetPieceRandomizer();
+    m_Root.random = engine.GetState().m_RandomState;
+    m_nSeed = engine.GetStateHash();
+
+    m_Root.board = engine.GetBoard();
+    m_Root.nHeld = engine.IsPieceHeld() ? engine.GetHeldPiece().getTypeIndex() : -1;
+    m_Root.nQueue = 0;
+    m_Root.nPlaced = 0;
+
+    // root: expanded right away
+    m_nCntNodes = 1;
+    Node& root = m_pNodes[0];
+    ResetNode(root);
+    if (!Expand(root, m_Root, engine.IsHoldAllowed(), m_Scratch[0]) || root.nCntChildren == 0) {
+        m_nRollouts = m_nElapsedMicros = 0;
+        return false;
+    }
+
+    m_nNextRollout = 0;
+    for (Scratch& scratch : m_Scratch) {
+        scratch.nRollouts = 0;
+    }
+    if (m_pPool != nullptr)
+    {
+        // (each task runs simulations until the budget is over)
+        TetrisTaskGroup group;
+        for (int32_t t = 0; t < (int32_t)m_Scratch.size(); t++) {
+            m_pPool->Submit([this, t]() { RunSimulations(t); }, &group);
+        }
+        m_pPool->Wait(group);
+    }
+    else {
+        RunSimulations(0);
+    }
+    m_nRollouts = 0;
+    for (const Scratch& scratch : m_Scratch) {
+        m_nRollouts += scratch.nRollouts;
+    }
+    m_nElapsedMicros = NowMicros() - startTime;
+
+    // the most visited move (the most valuable one, among equals)
+    const Node* pBest = nullptr;
+    for (int32_t i = 0; i < root.nCntChildren; i++)
+    {
+        const Node& child = m_pNodes[root.nFirstChild + i];
+        if (pBest == nullptr || child.nVisits > pBest->nVisits
+            || (child.nVisits == pBest->nVisits && child.nValueSum > pBest->nValueSum))
+            pBest = &child;
+    }
+    move.bHold = pBest->bHold;
+    move.placement = pBest->placement;
+    return true;
+}
+
+
+// Simulating task: runs simulations, until the budget is over
+void TetrisMCTS::RunSimulations(int32_t taskIdx)
+{
+    Scratch& scratch = m_Scratch[taskIdx];
+    for (;;)
+    {
+        int32_t rolloutIdx = m_nNextRollout++;
+        if (rolloutIdx >= m_nMaxRollouts)
+            break;
+        if (m_nDeadline != NO_DEADLINE && NowMicros() >= m_nDeadline) {
+            m_nNextRollout = m_nMaxRollouts;
+            break;
+        }
+        Simulate(scratch, TetrisZobrist::Mix(m_nSeed + (uint64_t)rolloutIdx));
+        scratch.nRollouts++;
+    }
+}
+
+
+// One simulation: walks down the tree, expands the leaf, rolls out, and updates the statistics of the path
+void TetrisMCTS::Simulate(Scratch& scratch, uint64_t seed)
+{
+    SimState state = m_Root;
+    int32_t cntPath = 0;
+    float value = 0.0f;
+
+    // walk down, along the best children
+    Node* pNode = &m_pNodes[0];
+    bool bGameOver = false;
+    for (;;)
+    {
+        if (pNode->nState.load(memory_order_acquire) != NODE_EXPANDED)
+        {
+            // a leaf: expanded if it was visited before (and if its piece is known)
+            if (pNode->nVisits < EXPAND_VISITS || state.nQueue >= SEQUENCE_LENGTH)
+                break;
+            int32_t expected = NODE_LEAF;
+            if (!pNode->nState.compare_exchange_strong(expected, NODE_EXPANDING))
+                break;
+            if (!Expand(*pNode, state, true, scratch))
+                break;
+        }
+        if (pNode->nCntChildren == 0) {
+            bGameOver = true;
+            break;
+        }
+
+        int32_t childIdx = pNode->nFirstChild + SelectChild(*pNode);
+        Node& child = m_pNodes[childIdx];
+        child.nVirtualLoss++;
+        scratch.path[cntPath++] = childIdx;
+        m_AI.EvaluateLock(state.board, child.placement, scratch.after);
+        state.board = scratch.after;
+        FollowPieces(state, child.bHold);
+        value += child.fReward;
+        pNode = &child;
+    }
+
+    // roll out, up to the horizon (or game over)
+    if (!bGameOver) {
+        m_pRandomizer->Resample(state.random, seed);
+        value += Rollout(state, scratch);
+    }
+    else {
+        value += GAME_OVER_SCORE * (m_nHorizon - state.nPlaced);
+    }
+
+    // update the path: each node gets the value of the simulation from its move on
+    m_pNodes[0].nVisits++;
+    for (int32_t i = 0; i < cntPath; i++)
+    {
+        Node& node = m_pNodes[scratch.path[i]];
+        node.nValueSum += (int64_t)(value * VALUE_SCALE);
+        node.nVisits++;
+        node.nVirtualLoss--;
+        value -= node.fReward;
+    }
+}
+
+
+// PUCT: the value of the child (normalized among the children, and counting the virtual losses
+// as the worst value) + the exploration bonus given by its prior
+int32_t TetrisMCTS::SelectChild(const Node& node) const
+{
+    const Node* pChildren = &m_pNodes[node.nFirstChild];
+    float minValue = FLT_MAX, maxValue = -FLT_MAX;
+    for (int32_t i = 0; i < node.nCntChildren; i++)
+    {
+        int32_t visits = pChildren[i].nVisits.load(memory_order_relaxed);
+        if (visits > 0) {
+            float value = pChildren[i].nValueSum.load(memory_order_relaxed) / (VALUE_SCALE * visits);
+            minValue = min(minValue, value);
+            maxValue = max(maxValue, value);
+        }
+    }
+    float valueRange = (maxValue > minValue) ? maxValue - minValue : 1.0f;
+    float sqrtParent = sqrtf((float)(node.nVisits + node.nVirtualLoss + 1));
+
+    int32_t bestIdx = 0;
+    float bestScore = -FLT_MAX;
+    for (int32_t i = 0; i < node.nCntChildren; i++)
+    {
+        const Node& child = pChildren[i];
+        int32_t visits = child.nVisits.load(memory_order_relaxed);
+        int32_t cntVisits = visits + child.nVirtualLoss.load(memory_order_relaxed);
+        float score = EXPLORATION * child.fPrior * sqrtParent / (1 + cntVisits);
+        if (visits > 0) {
+            float value = child.nValueSum.load(memory_order_relaxed) / (VALUE_SCALE * visits);
+            score += min(max((value - minValue) / valueRange, 0.0f), 1.0f) * visits / cntVisits;
+        }
+        if (score > bestScore) {
+            bestIdx = i, bestScore = score;
+        }
+    }
+    return bestIdx;
+}
+
+
+// Creates the children of a node: the moves of its current piece, or of the piece swapped with HOLD;
+// returns false if the arena is full (the node stays a leaf)
+bool TetrisMCTS::Expand(Node& node, const SimState& state, bool bHoldAllowed, Scratch& scratch)
+{
+    // (room for the worst case, taken back afterwards if possible)
+    const int32_t maxChildren = 2 * MAX_PIECE_MOVES;
+    int32_t first = (m_nCntNodes.load(memory_order_relaxed) <= m_nMaxNodes - maxChildren) ? m_nCntNodes.fetch_add(maxChildren) : m_nMaxNodes;
+    if (first > m_nMaxNodes - maxChildren) {
+        m_nCntNodes = m_nMaxNodes;
+        node.nState.store(NODE_LEAF, memory_order_release);
+        return false;
+    }
+
+    Node* pChildren = &m_pNodes[first];
+    int32_t cntChildren = 0;
+    if (state.nQueue < SEQUENCE_LENGTH)
+        cntChildren += AddChildren(state, Tetrimino(m_Sequence[state.nQueue]), false, scratch, pChildren, maxChildren);
+    if (bHoldAllowed)
+    {
+        // the piece in HOLD comes out, or else the next one
+        int8_t holdType = state.nHeld;
+        if (holdType < 0 && state.nQueue + 1 < SEQUENCE_LENGTH)
+            holdType = m_Sequence[state.nQueue + 1];
+        if (holdType >= 0)
+            cntChildren += AddChildren(state, Tetrimino(holdType), true, scratch, pChildren + cntChildren, maxChildren - cntChildren);
+    }
+
+    // priors: softmax of the scores
+    float maxReward = -FLT_MAX, sum = 0.0f;
+    for (int32_t i = 0; i < cntChildren; i++) {
+        maxReward = max(maxReward, pChildren[i].fReward);
+    }
+    for (int32_t i = 0; i < cntChildren; i++) {
+        pChildren[i].fPrior = expf((pChildren[i].fReward - maxReward) / PRIOR_TEMPERATURE);
+        sum += pChildren[i].fPrior;
+    }
+    for (int32_t i = 0; i < cntChildren; i++) {
+        pChildren[i].fPrior /= sum;
+    }
+
+    // give back the unused nodes, if no other node was allocated meanwhile
+    int32_t expected = first + maxChildren;
+    m_nCntNodes.compare_exchange_strong(expected, first + cntChildren);
+
+    node.nFirstChild = first;
+    node.nCntChildren = cntChildren;
+    node.nState.store(NODE_EXPANDED, memory_order_release);
+    return true;
+}
+
+
+int32_t TetrisMCTS::AddChildren(const SimState& state, const Tetrimino& piece, bool bHold, Scratch& scratch, Node* pChildren, int32_t maxChildren)
+{
+    int32_t cntMoves = scratch.moveGen.Generate(state.board, piece, scratch.moves, min(maxChildren, (int32_t)MAX_PIECE_MOVES));
+    for (int32_t i = 0; i < cntMoves; i++)
+    {
+        Node& child = pChildren[i];
+        ResetNode(child);
+        child.fReward = m_AI.EvaluatePlacement(state.board, scratch.moves[i].placement);
+        child.bHold = bHold;
+        child.placement = scratch.moves[i].placement;
+    }
+    return cntMoves;
+}
+
+
+// Greedy play of the pieces, up to the horizon: the known pieces, then the sampled ones; returns the sum of the scores
+float TetrisMCTS::Rollout(SimState& state, Scratch& scratch) const
+{
+    float value = 0.0f;
+    while (state.nPlaced < m_nHorizon)
+    {
+        int8_t type = (state.nQueue < SEQUENCE_LENGTH) ? m_Sequence[state.nQueue] : m_pRandomizer->Next(state.random);
+        int32_t cntMoves = scratch.moveGen.Generate(state.board, Tetrimino(type), scratch.moves, MAX_PIECE_MOVES);
+        if (cntMoves == 0)
+            return value + GAME_OVER_SCORE * (m_nHorizon - state.nPlaced);
+
+        int32_t bestIdx = 0;
+        float bestScore = 0.0f;
+        for (int32_t i = 0; i < cntMoves; i++)
+        {
+            float score = m_AI.EvaluatePlacement(state.board, scratch.moves[i].placement);
+            if (i == 0 || score > bestScore) {
+                bestIdx = i, bestScore = score;
+            }
+        }
+        m_AI.EvaluateLock(state.board, scratch.moves[bestIdx].placement, scratch.after);
+        state.board = scratch.after;
+        state.nQueue = (int8_t)min(state.nQueue + 1, (int32_t)SEQUENCE_LENGTH);
+        state.nPlaced++;
+        value += bestScore;
+    }
+    return value;
+}
+
+
+// HOLD and the current piece, after a move
+void TetrisMCTS::FollowPieces(SimState& state, bool bHold) const
+{
+    int32_t queue = state.nQueue;
+    if (!bHold) {
+        state.nQueue = (int8_t)(queue + 1);
+    }
+    else if (state.nHeld >= 0) {
+        // the current piece went to HOLD (once the queue is over, it is not known)
+        state.nHeld = (queue < SEQUENCE_LENGTH) ? m_Sequence[queue] : -1;
+        state.nQueue = (int8_t)min(queue + 1, (int32_t)SEQUENCE_LENGTH);
+    }
+    else {
+        // the current piece went to HOLD, and the next one was played
+        state.nHeld = m_Sequence[queue];
+        state.nQueue = (int8_t)(queue + 2);
+    }
+    state.nPlaced++;
+}
+
+
+void TetrisMCTS::ResetNode(Node& node) const
+{
+    node.nVisits.store(0, memory_order_relaxed);
+    node.nVirtualLoss.store(0, memory_order_relaxed);
+    node.nValueSum.store(0, memory_order_relaxed);
+    node.nState.store(NODE_LEAF, memory_order_relaxed);
+    node.nFirstChild = 0;
+    node.nCntChildren = 0;
+}
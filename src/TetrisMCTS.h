@@ -0,0 +1,167 @@
+#ifndef TETRISMCTS_H
+#define TETRISMCTS_H
+
+#include "TetrisAI.h"
+#include "TetrisBoard.h"
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisMoveGen.h"
+#include "TetrisRandom.h"
+#include "TetrisThreadPool.h"
+#include "Tetrimino.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+//=======================
+//  Monte Carlo tree search planner
+//  The tree holds the moves of the pieces known in advance (the current piece,
+//  the NEXT queue and HOLD). Each simulation walks down the tree (PUCT, with
+//  the heuristic scores of the moves as priors), expands the leaf it reaches,
+//  then plays a rollout: the pieces that follow are sampled from the
+//  randomizer (keeping what a player can know, e.g. the pieces left in the
+//  bag) and played by the greedy heuristic AI. The value of a simulation is
+//  the sum of the heuristic scores of its placements, over a fixed horizon.
+//  The simulations run in parallel on the thread pool, on the same tree: the
+//  statistics of the nodes are atomic, and a "virtual loss" on the nodes being
+//  walked down steers the other threads to other moves. The nodes come from a
+//  fixed arena (once it is full, the tree stops growing): no allocation.
+//=======================
+class TetrisMCTS
+{
+public:
+    // Pieces known in advance (the current piece + the NEXT queue)
+    static const int32_t SEQUENCE_LENGTH = 1 + CNT_NEXT_PIECES;
+    // Placements kept for each piece (no real board has more)
+    static const int32_t MAX_PIECE_MOVES = 256;
+
+    static const int32_t DEFAULT_MAX_NODES = 1 << 18;
+    static const int32_t DEFAULT_ROLLOUT_PIECES = 4;     // played after the known pieces
+
+public:
+    // Without a thread pool, the simulations run on the calling thread only
+    TetrisMCTS(TetrisThreadPool* pPool = nullptr, int32_t maxNodes = DEFAULT_MAX_NODES,
+               int32_t rolloutPieces = DEFAULT_ROLLOUT_PIECES,
+               const TetrisAIWeights& weights = TetrisAIWeights::Default());
+
+    // Plans the move of the current piece, running simulations until the time budget
+    // or the number of rollouts is reached (0 = no limit, but not both);
+    // returns false if the piece cannot be placed
+    bool Plan(const TetrisEngine& engine, int64_t budgetMicros, int32_t maxRollouts, TetrisPlannedMove& move);
+
+    // Statistics of the last search
+    int64_t GetRollouts() const         { return m_nRollouts; }
+    int64_t GetElapsedMicros() const    { return m_nElapsedMicros; }
+    double GetRolloutsPerSecond() const;
+    int32_t GetTreeNodes() const        { return std::min(m_nCntNodes.load(), m_nMaxNodes); }
+
+
+private:
+    enum { NODE_LEAF, NODE_EXPANDING, NODE_EXPANDED };
+
+    // A move of the tree (the root has none), and the statistics of the simulations through it
+    struct Node
+    {
+        std::atomic<int32_t> nVisits;
+        std::atomic<int32_t> nVirtualLoss;      // simulations walking through it right now
+        std::atomic<int64_t> nValueSum;         // (fixed point, VALUE_SCALE)
+        std::atomic<int32_t> nState;
+        int32_t nFirstChild;                    // (valid once expanded)
+        int32_t nCntChildren;
+        float fReward;                          // heuristic score of the move
+        float fPrior;
+        bool bHold;
+        TetroPlacement placement;
+    };
+
+    // The state of a simulation (plain data: it is cloned for every rollout)
+    struct SimState
+    {
+        TetrisBoard board;
+        RandomizerState random;
+        int8_t nHeld;                           // type of the piece in HOLD (-1 if none)
+        int8_t nQueue;                          // index of the current piece in the known pieces
+        int8_t nPlaced;                         // pieces placed so far
+    };
+
+    // Per task memory (the simulating tasks use one each)
+    struct Scratch
+    {
+        TetrisMoveGen moveGen;
+        TetrisMove moves[MAX_PIECE_MOVES];
+        TetrisBoard after;
+        int32_t path[2 * SEQUENCE_LENGTH + 1];
+        int64_t nRollouts;
+    };
+
+    void RunSimulations(int32_t taskIdx);
+    void Simulate(Scratch& scratch, uint64_t seed);
+    int32_t SelectChild(const Node& node) const;
+    bool Expand(Node& node, const SimState& state, bool bHoldAllowed, Scratch& scratch);
+    float Rollout(SimState& state, Scratch& scratch) const;
+    void FollowPieces(SimState& state, bool bHold) const;
+    int32_t AddChildren(const SimState& state, const Tetrimino& piece, bool bHold, Scratch& scratch, Node* pChildren, int32_t maxChildren);
+    void ResetNode(Node& node) const;
+
+private:
+    TetrisThreadPool* m_pPool;
+    TetrisAI m_AI;
+    int32_t m_nMaxNodes;
+    int32_t m_nHorizon;                         // pieces placed by each simulation
+
+    std::unique_ptr<Node[]> m_pNodes;
+    std::atomic<int32_t> m_nCntNodes;
+    std::vector<Scratch> m_Scratch;
+
+    // the search in progress
+    SimState m_Root;
+    int8_t m_Sequence[SEQUENCE_LENGTH];
+    const TetrisRandomizer* m_pRandomizer;
+    uint64_t m_nSeed;
+    std::atomic<int32_t> m_nNextRollout;
+    int32_t m_nMaxRollouts;
+    int64_t m_nDeadline;
+
+    int64_t m_nRollouts;
+    int64_t m_nElapsedMicros;
+};
+
+
+
+//=======================
+//  Bot playing the moves planned by a Monte Carlo tree search
+//=======================
+class TetrisMCTSBot : public TetrisBot
+{
+public:
+    TetrisMCTSBot(int64_t budgetMicros, int32_t maxRollouts, TetrisThreadPool* pPool = nullptr,
+                  int32_t maxNodes = TetrisMCTS::DEFAULT_MAX_NODES)
+        : m_Search(pPool, maxNodes), m_nBudgetMicros(budgetMicros), m_nMaxRollouts(maxRollouts)
+    {}
+
+    const char* GetName() const override    { return "MCTS"; }
+    bool PlanMove(const TetrisEngine& engine, TetrisPlannedMove& move) override
+    {
+        return m_Search.Plan(engine, m_nBudgetMicros, m_nMaxRollouts, move);
+    }
+    int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) override
+    {
+        return m_AI.ChooseMove(engine, pMoves, cntMoves);
+    }
+
+    const TetrisMCTS& GetSearch() const     { return m_Search; }
+
+private:
+    TetrisMCTS m_Search;
+    TetrisAI m_AI;
+    int64_t m_nBudgetMicros;
+    int32_t m_nMaxRollouts;
+};
+
+
+#endif // TETRISMCTS_H
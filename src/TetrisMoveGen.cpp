@@ -0,0 +1,196 @@
+#include "TetrisMoveGen.h"
+
+#include <cstring>
+
+
+namespace
+{
+    // Both pieces cover the same cells (in any order)
+    bool IsSameCells(const Tetrimino& a, const Tetrimino& b)
+    {
+        for (int8_t i = 0; i < 4; i++)
+        {
+            bool bFound = false;
+            for (int8_t j = 0; j < 4 && !bFound; j++)
+                bFound = (a.getX(i) == b.getX(j) && a.getY(i) == b.getY(j));
+            if (!bFound)
+                return false;
+        }
+        return true;
+    }
+}
+
+
+// Lowest tile of a piece type, in any rotation (relative to its position)
+int32_t TetrisMoveGen::MaxYTile(int8_t nType)
+{
+    int32_t maxY = 0;
+    for (int32_t rot = 0; rot < CNT_ROTATIONS; rot++) {
+        int32_t y = TETRO_TABLES.shapes[nType][rot].yMax;
+        maxY = (y > maxY) ? y : maxY;
+    }
+    return maxY;
+}
+
+
+// Key of the cells covered by a piece (+ the T-Spin flag), to find duplicate placements:
+// the top row of the piece, then the occupancy of each of its rows
+uint64_t TetrisMoveGen::CellsKey(const Tetrimino& piece, bool bTSpin)
+{
+    const TetroShape& shape = piece.getShape();
+    int32_t left = piece.getXOffset() + shape.xMin;
+    int32_t top = piece.getYOffset() + shape.yMin + EXTRA_HEIGHT_TILES;
+    uint64_t key = (uint64_t)top | ((bTSpin ? 1ull : 0ull) << 7);
+    for (int32_t i = 0; i < 4; i++) {
+        key |= (uint64_t)(shape.rowMask[i] << left) << (8 + i * TABLE_WIDTH_TILES);
+    }
+    return key;
+}
+
+
+// Adds the piece state to the queue (unless it was already visited)
+bool TetrisMoveGen::Visit(const Tetrimino& piece, bool bTSpin, uint16_t parent, TetrisAction action)
+{
+    if (IsVisited(piece, bTSpin))
+        return false;
+    uint16_t node = NodeIndex(piece.getPlacement(), bTSpin);
+    m_Visited[node >> 6] |= 1ull << (node & 63);
+    m_NodeParent[node] = parent;
+    m_NodeAction[node] = (uint8_t)action;
+    m_Queue[m_nQueueEnd++] = node;
+    return true;
+}
+
+
+// Adds the piece state reached by an action, after the gravity drop
+bool TetrisMoveGen::VisitAfterAction(const TetrisBoard& board, Tetrimino& piece, bool bTSpin, uint16_t parent, TetrisAction action)
+{
+    if (m_bGravityDrop) {
+        int32_t dropDistance = board.GetDropDistance(piece);
+        if (dropDistance > 0) {
+            // (falling cancels a T-Spin, as in the engine)
+            piece.move(0, dropDistance);
+            bTSpin = false;
+        }
+    }
+    return Visit(piece, bTSpin, parent, action);
+}
+
+
+int32_t TetrisMoveGen::Generate(const TetrisBoard& board, const Tetrimino& piece, TetrisMove* pMoves, int32_t maxMoves,
+                                bool bGravityDrop)
+{
+    maxMoves = (maxMoves < MAX_MOVES) ? maxMoves : MAX_MOVES;
+    memset(m_Visited, 0, sizeof(m_Visited));
+    m_nQueueEnd = 0;
+    m_nPieceType = piece.getTypeIndex();
+    m_bGravityDrop = bGravityDrop;
+    if (board.DoesPieceCollide(piece))
+        return 0;
+
+    // Above the stack every rotation and column can be reached, so the search can start
+    // from the lowest row where the piece (even rotated and kicked) is still above it
+    // (with gravity, the piece starts on the stack)
+    Tetrimino start = piece;
+    if (bGravityDrop) {
+        m_nStartDrop = board.GetDropDistance(start);
+    }
+    else {
+        int32_t pieceBottom = start.getYOffset() + MaxYTile(m_nPieceType) + MAX_KICK_DOWN;
+        m_nStartDrop = (board.GetTopRow() - 1) - pieceBottom;
+        m_nStartDrop = (m_nStartDrop > 0) ? m_nStartDrop : 0;
+    }
+    start.move(0, m_nStartDrop);
+
+    // start from the current position
+    Visit(start, false, 0, CNT_ACTIONS);
+    m_nStartNode = m_Queue[0];
+    bool bCanRotate = TETRO_TABLES.canRotate[m_nPieceType];
+    bool bCanTSpin = (TETRO_TABLES.typeChar[m_nPieceType] == 'T');
+
+    int32_t cntMoves = 0;
+    uint64_t moveKeys[MAX_MOVES];
+    for (int32_t queueIdx = 0; queueIdx < m_nQueueEnd; queueIdx++)
+    {
+        uint16_t node = m_Queue[queueIdx];
+        Tetrimino current(NodePlacement(node));
+        bool bTSpin = (node >> 11) != 0;
+
+        // moves left and right (checking for collision only if not yet visited)
+        Tetrimino next = current;
+        next.move(-1, 0);
+        if (!IsVisited(next, false) && !board.DoesPieceCollide(next))
+            VisitAfterAction(board, next, false, node, ACTION_MOVE_LEFT);
+        next = current;
+        next.move(+1, 0);
+        if (!IsVisited(next, false) && !board.DoesPieceCollide(next))
+            VisitAfterAction(board, next, false, node, ACTION_MOVE_RIGHT);
+
+        // rotations (with wall kicks)
+        if (bCanRotate)
+        {
+            next = current;
+            if (board.RotatePiece(next, false) >= 0)
+                VisitAfterAction(board, next, bCanTSpin && board.IsTSpinPosition(next), node, ACTION_ROT_LEFT);
+            next = current;
+            if (board.RotatePiece(next, true) >= 0)
+                VisitAfterAction(board, next, bCanTSpin && board.IsTSpinPosition(next), node, ACTION_ROT_RIGHT);
+        }
+
+        // soft drop (or lock, if resting on something), last: among the shortest paths,
+        // the ones moving first and dropping last are found (as a player moves a piece)
+        next = current;
+        next.move(0, 1);
+        if (board.DoesPieceCollide(next))
+        {
+            // lock here: keep it, unless the same cells were already found
+            uint64_t key = CellsKey(current, bTSpin);
+            int32_t i = 0;
+            while (i < cntMoves && moveKeys[i] != key)
+                i++;
+            if (i == cntMoves && cntMoves < maxMoves) {
+                moveKeys[cntMoves] = key;
+                pMoves[cntMoves].placement = current.getPlacement();
+                pMoves[cntMoves].bTSpin = bTSpin;
+                pMoves[cntMoves].nNode = node;
+                cntMoves++;
+            }
+        }
+        else {
+            Visit(next, false, node, ACTION_SOFT_DROP);
+        }
+    }
+    return cntMoves;
+}
+
+
+int32_t TetrisMoveGen::GetPath(const TetrisMove& move, TetrisAction* pActions, int32_t maxActions) const
+{
+    // count the actions (walking back to the start)
+    int32_t cntActions = m_nStartDrop + 1;
+    for (uint16_t node = move.nNode; node != m_nStartNode; node = m_NodeParent[node])
+        cntActions++;
+    if (cntActions > maxActions)
+        return 0;
+
+    // fill them from the end
+    int32_t idx = cntActions - 1;
+    pActions[idx] = ACTION_HARD_DROP;
+    for (uint16_t node = move.nNode; node != m_nStartNode; node = m_NodeParent[node])
+        pActions[--idx] = (TetrisAction)m_NodeAction[node];
+    // the piece was dropped to the search start
+    while (idx > 0)
+        pActions[--idx] = ACTION_SOFT_DROP;
+    return cntActions;
+}
+
+
+int32_t TetrisMoveGen::FindMove(const TetroPlacement& placement, const TetrisMove* pMoves, int32_t cntMoves)
+{
+    Tetrimino piece(placement);
+    for (int32_t i = 0; i < cntMoves; i++) {
+        if (IsSameCells(piece, Tetrimino(pMoves[i].placement)))
+            return i;
+    }
+    return -1;
+}
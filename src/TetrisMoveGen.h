@@ -0,0 +1,103 @@
+#ifndef TETRISMOVEGEN_H
+#define TETRISMOVEGEN_H
+
+#include "TetrisBoard.h"
+#include "TetrisEngine.h"
+#include "Tetrimino.h"
+
+#include <cstdint>
+
+
+//=======================
+//  A final placement of a piece (where it locks), as found by TetrisMoveGen
+//=======================
+struct TetrisMove
+{
+    TetroPlacement placement;
+    bool bTSpin;            // the last action was a rotation which made a T-Spin
+    uint16_t nNode;         // search node of the placement (to rebuild its path)
+};
+
+
+
+//=======================
+//  Move generator: finds every distinct lock placement of a piece, reachable
+//  from its current position with moves, SRS rotations (with wall kicks) and
+//  soft drops. Gravity is ignored (as if the player was infinitely fast), or
+//  else every action is followed by a drop to the stack (as at 20G).
+//  It is a BFS over the (rotation, x, y, T-Spin) piece states, so each path is
+//  as short as possible. Placements covering the same cells are reported once.
+//=======================
+class TetrisMoveGen
+{
+public:
+    // Piece states: 4 rotations x 32 rows x 16 columns, with or without T-Spin
+    static const int32_t CNT_NODES = 2 * CNT_ROTATIONS * 32 * 16;
+    // No more placements than this can be found
+    static const int32_t MAX_MOVES = CNT_NODES / 2;
+
+public:
+    // Returns the number of moves written to pMoves (no more than maxMoves)
+    int32_t Generate(const TetrisBoard& board, const Tetrimino& piece, TetrisMove* pMoves, int32_t maxMoves,
+                     bool bGravityDrop = false);
+
+    // Actions which bring the piece from its start position to the move (of the last Generate() call),
+    // ending with ACTION_HARD_DROP. Each ACTION_SOFT_DROP moves the piece one row down.
+    // Returns the number of actions (which is 0 if they don't fit in maxActions)
+    int32_t GetPath(const TetrisMove& move, TetrisAction* pActions, int32_t maxActions) const;
+    // Index of the move covering the same cells as the placement (in any rotation), or -1
+    static int32_t FindMove(const TetroPlacement& placement, const TetrisMove* pMoves, int32_t cntMoves);
+    // Rows the piece is dropped (by the first soft drops of every path) before the search starts:
+    // above this, the piece is in free air (every rotation and column can be reached)
+    int32_t GetStartDrop() const    { return m_nStartDrop; }
+
+
+private:
+    static uint16_t NodeIndex(const TetroPlacement& p, bool bTSpin)
+    {
+        return (uint16_t)(((bTSpin ? 1 : 0) << 11) | (p.nRot << 9) | ((p.y + NODE_Y_OFFSET) << 4) | (p.x + NODE_X_OFFSET));
+    }
+    TetroPlacement NodePlacement(uint16_t node) const
+    {
+        TetroPlacement p;
+        p.nType = m_nPieceType;
+        p.nRot = (int8_t)((node >> 9) & 0x03);
+        p.y = (int8_t)(((node >> 4) & 0x1F) - NODE_Y_OFFSET);
+        p.x = (int8_t)((node & 0x0F) - NODE_X_OFFSET);
+        return p;
+    }
+    static int32_t MaxYTile(int8_t nType);
+    static uint64_t CellsKey(const Tetrimino& piece, bool bTSpin);
+
+    bool IsVisited(const Tetrimino& piece, bool bTSpin) const
+    {
+        // (also valid for a piece moved one column out of the board: the ranges have room for it)
+        uint16_t node = NodeIndex(piece.getPlacement(), bTSpin);
+        return (m_Visited[node >> 6] >> (node & 63)) & 0x01;
+    }
+
+    bool Visit(const Tetrimino& piece, bool bTSpin, uint16_t parent, TetrisAction action);
+    // Same, after the gravity drop (if enabled)
+    bool VisitAfterAction(const TetrisBoard& board, Tetrimino& piece, bool bTSpin, uint16_t parent, TetrisAction action);
+
+private:
+    // offsets from the spawn position, mapped to the node index ranges
+    // (any non-colliding piece has -5 <= x <= 5 and -7 <= y <= 19)
+    static const int32_t NODE_X_OFFSET = 8;
+    static const int32_t NODE_Y_OFFSET = 8;
+    // wall kicks move a piece by up to 2 rows
+    static const int32_t MAX_KICK_DOWN = 2;
+
+    int8_t m_nPieceType;
+    uint64_t m_Visited[CNT_NODES / 64];
+    uint16_t m_NodeParent[CNT_NODES];
+    uint8_t m_NodeAction[CNT_NODES];
+    uint16_t m_Queue[CNT_NODES];
+    int32_t m_nQueueEnd;
+    uint16_t m_nStartNode;
+    int32_t m_nStartDrop;       // rows dropped before the search start
+    bool m_bGravityDrop;        // every action is followed by a drop to the stack
+};
+
+
+#endif // TETRISMOVEGEN_H
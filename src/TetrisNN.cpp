@@ -0,0 +1,329 @@
+#include "TetrisNN.h"
+#include "TetrisBits.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if TETRIS_AVX2
+#include <immintrin.h>
+#elif TETRIS_SSE41
+#include <smmintrin.h>
+#elif TETRIS_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+/////////////////////////////////////////////
+//  KERNELS
+/////////////////////////////////////////////
+namespace
+{
+    // The input widths are multiples of 32 bytes; the products of an 8 bit activation (0..127)
+    // and an int8 weight (-127..127) are summed by pairs in 16 bits without saturating,
+    // then in 32 bits.
+
+#if TETRIS_AVX2
+    inline __m256i MulAddBytes(__m256i in, __m256i weights)
+    {
+        return _mm256_madd_epi16(_mm256_maddubs_epi16(in, weights), _mm256_set1_epi16(1));
+    }
+
+    // Dot products of the input with 4 rows of weights
+    void DotRows4(const uint8_t* pIn, const int8_t* pWeights, int32_t cntInputs, int32_t* pOut)
+    {
+        const int8_t* pW0 = pWeights;
+        const int8_t* pW1 = pW0 + cntInputs;
+        const int8_t* pW2 = pW1 + cntInputs;
+        const int8_t* pW3 = pW2 + cntInputs;
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int32_t i = 0; i < cntInputs; i += 32)
+        {
+            __m256i in = _mm256_loadu_si256((const __m256i*)(pIn + i));
+            acc0 = _mm256_add_epi32(acc0, MulAddBytes(in, _mm256_loadu_si256((const __m256i*)(pW0 + i))));
+            acc1 = _mm256_add_epi32(acc1, MulAddBytes(in, _mm256_loadu_si256((const __m256i*)(pW1 + i))));
+            acc2 = _mm256_add_epi32(acc2, MulAddBytes(in, _mm256_loadu_si256((const __m256i*)(pW2 + i))));
+            acc3 = _mm256_add_epi32(acc3, MulAddBytes(in, _mm256_loadu_si256((const __m256i*)(pW3 + i))));
+        }
+        // (lane i of each half: the partial sum of row i)
+        __m256i sums = _mm256_hadd_epi32(_mm256_hadd_epi32(acc0, acc1), _mm256_hadd_epi32(acc2, acc3));
+        __m128i result = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        _mm_storeu_si128((__m128i*)pOut, result);
+    }
+
+#elif TETRIS_SSE41
+    inline __m128i MulAddBytes(__m128i in, __m128i weights)
+    {
+        return _mm_madd_epi16(_mm_maddubs_epi16(in, weights), _mm_set1_epi16(1));
+    }
+
+    void DotRows4(const uint8_t* pIn, const int8_t* pWeights, int32_t cntInputs, int32_t* pOut)
+    {
+        const int8_t* pW0 = pWeights;
+        const int8_t* pW1 = pW0 + cntInputs;
+        const int8_t* pW2 = pW1 + cntInputs;
+        const int8_t* pW3 = pW2 + cntInputs;
+        __m128i acc0 = _mm_setzero_si128(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int32_t i = 0; i < cntInputs; i += 16)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i*)(pIn + i));
+            acc0 = _mm_add_epi32(acc0, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW0 + i))));
+            acc1 = _mm_add_epi32(acc1, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW1 + i))));
+            acc2 = _mm_add_epi32(acc2, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW2 + i))));
+            acc3 = _mm_add_epi32(acc3, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW3 + i))));
+        }
+        __m128i sums = _mm_hadd_epi32(_mm_hadd_epi32(acc0, acc1), _mm_hadd_epi32(acc2, acc3));
+        _mm_storeu_si128((__m128i*)pOut, sums);
+    }
+
+#elif TETRIS_SSE2
+    // (no unsigned x signed byte multiply: both are widened to 16 bits)
+    inline __m128i MulAddBytes(__m128i in, __m128i weights)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sign = _mm_cmpgt_epi8(zero, weights);
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(in, zero), _mm_unpacklo_epi8(weights, sign));
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(in, zero), _mm_unpackhi_epi8(weights, sign));
+        return _mm_add_epi32(lo, hi);
+    }
+
+    inline int32_t SumLanes(__m128i v)
+    {
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(v);
+    }
+
+    void DotRows4(const uint8_t* pIn, const int8_t* pWeights, int32_t cntInputs, int32_t* pOut)
+    {
+        const int8_t* pW0 = pWeights;
+        const int8_t* pW1 = pW0 + cntInputs;
+        const int8_t* pW2 = pW1 + cntInputs;
+        const int8_t* pW3 = pW2 + cntInputs;
+        __m128i acc0 = _mm_setzero_si128(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int32_t i = 0; i < cntInputs; i += 16)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i*)(pIn + i));
+            acc0 = _mm_add_epi32(acc0, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW0 + i))));
+            acc1 = _mm_add_epi32(acc1, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW1 + i))));
+            acc2 = _mm_add_epi32(acc2, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW2 + i))));
+            acc3 = _mm_add_epi32(acc3, MulAddBytes(in, _mm_loadu_si128((const __m128i*)(pW3 + i))));
+        }
+        pOut[0] = SumLanes(acc0);
+        pOut[1] = SumLanes(acc1);
+        pOut[2] = SumLanes(acc2);
+        pOut[3] = SumLanes(acc3);
+    }
+
+#else
+    void DotRows4(const uint8_t* pIn, const int8_t* pWeights, int32_t cntInputs, int32_t* pOut)
+    {
+        for (int32_t r = 0; r < 4; r++)
+        {
+            const int8_t* pRow = pWeights + r * cntInputs;
+            int32_t sum = 0;
+            for (int32_t i = 0; i < cntInputs; i++) {
+                sum += pIn[i] * pRow[i];
+            }
+            pOut[r] = sum;
+        }
+    }
+#endif
+
+
+    // Hidden layer, for a block of inputs: each group of 4 rows of weights is used for the whole block
+    void ForwardHidden(const uint8_t* pIn, int32_t cntBlock, int32_t cntInputs, int32_t cntOutputs,
+                       const int8_t* pWeights, const int32_t* pBiases, int32_t shift, uint8_t* pOut)
+    {
+        for (int32_t o = 0; o < cntOutputs; o += 4)
+        {
+            const int8_t* pRows = pWeights + (size_t)o * cntInputs;
+            for (int32_t b = 0; b < cntBlock; b++)
+            {
+                int32_t sums[4];
+                DotRows4(pIn + b * cntInputs, pRows, cntInputs, sums);
+                for (int32_t r = 0; r < 4; r++)
+                {
+                    int32_t value = (sums[r] + pBiases[o + r]) >> shift;
+                    pOut[b * cntOutputs + o + r] = (uint8_t)min(max(value, 0), 127);
+                }
+            }
+        }
+    }
+
+
+    int32_t Dot(const uint8_t* pIn, const int8_t* pWeights, int32_t cntInputs)
+    {
+        int32_t sum = 0;
+        for (int32_t i = 0; i < cntInputs; i++) {
+            sum += pIn[i] * pWeights[i];
+        }
+        return sum;
+    }
+
+
+    template<typename T>
+    bool ReadValues(ifstream& file, T* pValues, size_t count)
+    {
+        file.read(reinterpret_cast<char*>(pValues), count * sizeof(T));
+        return file.good();
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  NETWORK
+/////////////////////////////////////////////
+
+TetrisNNEval::TetrisNNEval()
+: m_fOutputScale(0.0f)
+{
+    Unload();
+}
+
+
+void TetrisNNEval::Unload()
+{
+    for (Layer& layer : m_Layers) {
+        layer.nInputs = layer.nOutputs = layer.nShift = 0;
+        layer.biases.clear();
+        layer.weights.clear();
+    }
+    m_fOutputScale = 0.0f;
+}
+
+
+bool TetrisNNEval::Load(const char* pFileName)
+{
+    Unload();
+    ifstream file(pFileName, ifstream::binary);
+    if (!file.is_open())
+        return false;
+
+    char magic[4];
+    uint32_t sizes[3];
+    float outputScale;
+    if (!ReadValues(file, magic, 4) || memcmp(magic, "TNN1", 4) != 0
+        || !ReadValues(file, sizes, 3) || !ReadValues(file, &outputScale, 1))
+        return false;
+    if (sizes[0] != (uint32_t)INPUT_SIZE)
+        return false;
+    for (int32_t i = 1; i <= 2; i++) {
+        if (sizes[i] == 0 || sizes[i] > (uint32_t)MAX_HIDDEN || sizes[i] % 32 != 0)
+            return false;
+    }
+
+    for (int32_t l = 0; l < CNT_LAYERS; l++)
+    {
+        Layer& layer = m_Layers[l];
+        layer.nInputs = (int32_t)sizes[l];
+        layer.nOutputs = (l + 1 < CNT_LAYERS) ? (int32_t)sizes[l + 1] : 1;
+        uint32_t shift = 0;
+        if (l + 1 < CNT_LAYERS && (!ReadValues(file, &shift, 1) || shift > 31)) {
+            Unload();
+            return false;
+        }
+        layer.nShift = (int32_t)shift;
+        layer.biases.resize(layer.nOutputs);
+        layer.weights.resize((size_t)layer.nOutputs * layer.nInputs);
+        if (!ReadValues(file, layer.biases.data(), layer.biases.size())
+            || !ReadValues(file, layer.weights.data(), layer.weights.size())) {
+            Unload();
+            return false;
+        }
+    }
+    m_fOutputScale = outputScale;
+    return true;
+}
+
+
+void TetrisNNEval::EncodeInput(const TetrisBoard& board, const int8_t* pNextPieces, int8_t heldPiece, uint8_t* pInput)
+{
+    memset(pInput, 0, INPUT_SIZE);
+    for (int32_t y = 0; y < TABLE_HEIGHT_TILES; y++)
+    {
+        uint16_t row = board.GetRowMask(y);
+        for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+            pInput[y * TABLE_WIDTH_TILES + x] = (uint8_t)((row >> x) & 0x01);
+        }
+    }
+    for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+        if (pNextPieces[i] >= 0)
+            pInput[INPUT_PIECES + i * CNT_TETRIMINOS + pNextPieces[i]] = 1;
+    }
+    pInput[INPUT_HOLD + 1 + heldPiece] = 1;
+    for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++)
+    {
+        uint32_t column = board.GetColumnMask(x) & (FLOOR_MASK - 1);
+        int32_t height = (column != 0) ? BOARD_ROWS - CountTrailingZeros(column) : 0;
+        pInput[INPUT_HEIGHTS + x] = (uint8_t)height;
+        pInput[INPUT_HOLES + x] = (uint8_t)(height - PopCount(column));
+    }
+}
+
+
+void TetrisNNEval::Evaluate(const uint8_t* pInputs, int32_t cntInputs, float* pValues) const
+{
+    alignas(32) uint8_t hidden1[BLOCK_INPUTS * MAX_HIDDEN];
+    alignas(32) uint8_t hidden2[BLOCK_INPUTS * MAX_HIDDEN];
+    const Layer& layer1 = m_Layers[0];
+    const Layer& layer2 = m_Layers[1];
+    const Layer& output = m_Layers[2];
+
+    for (int32_t first = 0; first < cntInputs; first += BLOCK_INPUTS)
+    {
+        int32_t cntBlock = min((int32_t)BLOCK_INPUTS, cntInputs - first);
+        ForwardHidden(pInputs + (size_t)first * INPUT_SIZE, cntBlock, layer1.nInputs, layer1.nOutputs,
+                      layer1.weights.data(), layer1.biases.data(), layer1.nShift, hidden1);
+        ForwardHidden(hidden1, cntBlock, layer2.nInputs, layer2.nOutputs,
+                      layer2.weights.data(), layer2.biases.data(), layer2.nShift, hidden2);
+        for (int32_t b = 0; b < cntBlock; b++)
+        {
+            int32_t sum = Dot(hidden2 + b * output.nInputs, output.weights.data(), output.nInputs) + output.biases[0];
+            pValues[first + b] = sum * m_fOutputScale;
+        }
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  BOT
+/////////////////////////////////////////////
+
+int32_t TetrisNNBot::ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves)
+{
+    if (!m_Eval.IsLoaded())
+        return m_AI.ChooseMove(engine, pMoves, cntMoves);
+
+    if ((int32_t)m_Scores.size() < cntMoves) {
+        m_Inputs.resize((size_t)cntMoves * TetrisNNEval::INPUT_SIZE);
+        m_Scores.resize(cntMoves);
+        m_Values.resize(cntMoves);
+    }
+
+    // after the lock: the NEXT pieces come, HOLD is unchanged
+    int8_t nextPieces[CNT_NEXT_PIECES];
+    for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+        nextPieces[i] = engine.GetNextPiece(i).getTypeIndex();
+    }
+    int8_t heldPiece = engine.IsPieceHeld() ? engine.GetHeldPiece().getTypeIndex() : -1;
+
+    TetrisBoard after;
+    for (int32_t i = 0; i < cntMoves; i++)
+    {
+        m_Scores[i] = m_AI.EvaluatePlacement(engine.GetBoard(), pMoves[i].placement, &after);
+        TetrisNNEval::EncodeInput(after, nextPieces, heldPiece, &m_Inputs[(size_t)i * TetrisNNEval::INPUT_SIZE]);
+    }
+    m_Eval.Evaluate(m_Inputs.data(), cntMoves, m_Values.data());
+
+    int32_t bestIdx = 0;
+    for (int32_t i = 1; i < cntMoves; i++) {
+        if (m_Scores[i] + m_Values[i] > m_Scores[bestIdx] + m_Values[bestIdx])
+            bestIdx = i;
+    }
+    return bestIdx;
+}
@@ -0,0 +1,106 @@
+#ifndef TETRISNN_H
+#define TETRISNN_H
+
+#include "TetrisAI.h"
+#include "TetrisBoard.h"
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+
+#include <cstdint>
+#include <vector>
+
+
+//=======================
+//  Neural network value function (optional, learned): a small MLP over the
+//  visible board (10x20 occupancy, and the height and holes of each column),
+//  the pieces to come and HOLD (one-hot), with int8 weights and 8 bit activations (clipped ReLU, 0..127).
+//  The inputs are evaluated in batches: each layer runs over a block of
+//  inputs at a time, as a small int8 GEMM (AVX2, SSE4.1, SSE2 or portable
+//  kernel, chosen at compile time).
+//
+//  Weights file (little endian):
+//    char[4] "TNN1", uint32 nInputs (= INPUT_SIZE), uint32 nHidden1, uint32 nHidden2, float fOutputScale
+//    hidden layer 1, hidden layer 2: uint32 nShift, int32 biases[nOutputs], int8 weights[nOutputs][nInputs]
+//    output layer: int32 bias, int8 weights[nHidden2]
+//  hidden layers: out = clamp((weights . in + bias) >> nShift, 0, 127)
+//  output: (weights . in + bias) * fOutputScale
+//  (the hidden sizes are multiples of 32, up to MAX_HIDDEN)
+//=======================
+class TetrisNNEval
+{
+public:
+    static const int32_t INPUT_SIZE = 256;      // (249 features, padded for the kernels)
+    static const int32_t MAX_HIDDEN = 256;
+
+    // input layout: occupancy (1 byte per visible tile), the pieces to come, HOLD (or none),
+    // then the height of each column and its holes (empty tiles below the top)
+    static const int32_t INPUT_PIECES = TABLE_WIDTH_TILES * TABLE_HEIGHT_TILES;
+    static const int32_t INPUT_HOLD = INPUT_PIECES + CNT_NEXT_PIECES * CNT_TETRIMINOS;
+    static const int32_t INPUT_HEIGHTS = INPUT_HOLD + 1 + CNT_TETRIMINOS;
+    static const int32_t INPUT_HOLES = INPUT_HEIGHTS + TABLE_WIDTH_TILES;
+    static const int32_t INPUT_FEATURES = INPUT_HOLES + TABLE_WIDTH_TILES;
+
+public:
+    TetrisNNEval();
+
+    // Returns false if the file cannot be read or is not a valid network (the network is then unloaded)
+    bool Load(const char* pFileName);
+    bool IsLoaded() const   { return m_Layers[0].nOutputs > 0; }
+
+    // Input of a board (e.g. after a lock), with the pieces to come (CNT_NEXT_PIECES of them,
+    // the first one plays next) and the piece in HOLD (-1 if none)
+    static void EncodeInput(const TetrisBoard& board, const int8_t* pNextPieces, int8_t heldPiece, uint8_t* pInput);
+
+    // Values of a batch of inputs (INPUT_SIZE bytes each); the network must be loaded
+    void Evaluate(const uint8_t* pInputs, int32_t cntInputs, float* pValues) const;
+
+
+private:
+    struct Layer
+    {
+        int32_t nInputs;
+        int32_t nOutputs;
+        int32_t nShift;
+        std::vector<int32_t> biases;
+        std::vector<int8_t> weights;    // one row of nInputs per output
+    };
+
+    static const int32_t CNT_LAYERS = 3;
+    // inputs per batch block (the activations of a block stay in the L1 cache)
+    static const int32_t BLOCK_INPUTS = 16;
+
+    void Unload();
+
+private:
+    Layer m_Layers[CNT_LAYERS];
+    float m_fOutputScale;
+};
+
+
+
+//=======================
+//  Bot choosing the move with the best heuristic score + learned value of
+//  the board after it (the network gets the candidate boards of the piece
+//  in one batch); plays as the heuristic AI if no network is loaded
+//=======================
+class TetrisNNBot : public TetrisBot
+{
+public:
+    explicit TetrisNNBot(const TetrisNNEval& eval, const TetrisAIWeights& weights = TetrisAIWeights::Default())
+        : m_Eval(eval), m_AI(weights)
+    {}
+
+    const char* GetName() const override    { return "Neural net"; }
+    int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) override;
+
+private:
+    const TetrisNNEval& m_Eval;
+    TetrisAI m_AI;
+    // (grown to the largest batch, then reused)
+    std::vector<uint8_t> m_Inputs;
+    std::vector<float> m_Scores;
+    std::vector<float> m_Values;
+};
+
+
+#endif // TETRISNN_H
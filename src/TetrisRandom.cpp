@@ -0,0 +1,246 @@
+#include "TetrisRandom.h"
+
+#include <cstring>
+
+
+/////////////////////////////////////////////
+//  PRNG - xoshiro128** (http://prng.di.unimi.it/)
+/////////////////////////////////////////////
+namespace
+{
+    inline uint32_t rotl(uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    uint64_t splitmix64(uint64_t& x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+}
+
+
+void TetrisRng::Seed(uint64_t seed)
+{
+    // expand the seed with SplitMix64, so that similar seeds give unrelated streams
+    uint64_t a = splitmix64(seed);
+    uint64_t b = splitmix64(seed);
+    s[0] = (uint32_t)a;
+    s[1] = (uint32_t)(a >> 32);
+    s[2] = (uint32_t)b;
+    s[3] = (uint32_t)(b >> 32);
+    // the all-zero state is invalid
+    if ((s[0] | s[1] | s[2] | s[3]) == 0)
+        s[0] = 1;
+}
+
+
+uint32_t TetrisRng::Next()
+{
+    uint32_t result = rotl(s[1] * 5, 7) * 9;
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return result;
+}
+
+
+
+/////////////////////////////////////////////
+//  RANDOMIZER - common code
+/////////////////////////////////////////////
+
+void TetrisRandomizer::Reset(RandomizerState& state, uint64_t seed) const
+{
+    memset(&state, 0, sizeof(state));
+    state.rng.Seed(seed);
+    state.nBagIndex = MAX_BAG_SIZE;     // to trigger a refill of the bag
+    state.bFirstPiece = true;
+}
+
+
+void TetrisRandomizer::Resample(RandomizerState& state, uint64_t seed) const
+{
+    state.rng.Seed(seed);
+}
+
+
+void TetrisRandomizer::Generate(RandomizerState& state, int8_t* pPieces, size_t cntPieces) const
+{
+    for (size_t i = 0; i < cntPieces; i++) {
+        pPieces[i] = Next(state);
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  RANDOMIZERS
+/////////////////////////////////////////////
+namespace
+{
+    // N-bag: each bag holds N/7 copies of every piece, shuffled
+    class BagRandomizer : public TetrisRandomizer
+    {
+    public:
+        BagRandomizer(const char* name, uint8_t bagSize)
+            : m_pName(name), m_nBagSize(bagSize)
+        {}
+
+        const char* GetName() const override    { return m_pName; }
+
+        int8_t Next(RandomizerState& state) const override
+        {
+            if (state.nBagIndex >= m_nBagSize)
+                RefillBag(state);
+            return (int8_t)state.bag[state.nBagIndex++];
+        }
+
+        void Generate(RandomizerState& state, int8_t* pPieces, size_t cntPieces) const override
+        {
+            while (cntPieces > 0)
+            {
+                if (state.nBagIndex >= m_nBagSize)
+                    RefillBag(state);
+                // copy as much of the bag as possible, in one go
+                size_t cnt = m_nBagSize - state.nBagIndex;
+                cnt = (cnt < cntPieces) ? cnt : cntPieces;
+                memcpy(pPieces, state.bag + state.nBagIndex, cnt);
+                state.nBagIndex += (uint8_t)cnt;
+                pPieces += cnt;
+                cntPieces -= cnt;
+            }
+        }
+
+        void Resample(RandomizerState& state, uint64_t seed) const override
+        {
+            // the pieces left in the bag are known, not their order
+            state.rng.Seed(seed);
+            if (state.nBagIndex < m_nBagSize)
+                Shuffle(state, state.nBagIndex, m_nBagSize);
+        }
+
+    private:
+        void RefillBag(RandomizerState& state) const
+        {
+            for (uint8_t i = 0; i < m_nBagSize; i++) {
+                state.bag[i] = i % CNT_TETRIMINOS;
+            }
+            Shuffle(state, 0, m_nBagSize);
+            state.nBagIndex = 0;
+        }
+
+        // Fisher-Yates shuffle of bag[first, last)
+        static void Shuffle(RandomizerState& state, uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = last - 1; i > first; i--)
+            {
+                uint32_t j = first + state.rng.NextBelow(i - first + 1);
+                uint8_t tmp = state.bag[i];
+                state.bag[i] = state.bag[j];
+                state.bag[j] = tmp;
+            }
+        }
+
+    private:
+        const char* m_pName;
+        uint8_t m_nBagSize;
+    };
+
+
+    // TGM: pick a random piece, re-rolling (a few times) if it is in the last 4 pieces
+    class HistoryRandomizer : public TetrisRandomizer
+    {
+    public:
+        const char* GetName() const override    { return "TGM history-4"; }
+
+        void Reset(RandomizerState& state, uint64_t seed) const override
+        {
+            TetrisRandomizer::Reset(state, seed);
+            // history starts as Z, S, S, Z
+            state.history[0] = state.history[3] = PIECE_Z;
+            state.history[1] = state.history[2] = PIECE_S;
+        }
+
+        int8_t Next(RandomizerState& state) const override
+        {
+            uint8_t piece = 0;
+            if (state.bFirstPiece)
+            {
+                // the first piece is never S, Z or O (re-rolled for as long as it takes, whatever MAX_ROLLS;
+                // the other pieces are never in the starting history)
+                do {
+                    piece = (uint8_t)state.rng.NextBelow(CNT_TETRIMINOS);
+                } while (piece == PIECE_S || piece == PIECE_Z || piece == PIECE_O);
+                state.bFirstPiece = false;
+            }
+            else
+            {
+                for (int32_t roll = 0; roll < MAX_ROLLS; roll++)
+                {
+                    piece = (uint8_t)state.rng.NextBelow(CNT_TETRIMINOS);
+                    if (!IsInHistory(state, piece))
+                        break;
+                }
+            }
+            // push piece into history
+            for (int32_t i = HISTORY_SIZE - 1; i > 0; i--) {
+                state.history[i] = state.history[i - 1];
+            }
+            state.history[0] = piece;
+            return (int8_t)piece;
+        }
+
+    private:
+        // type indices, as in Tetrimino: "OITSZJL"
+        enum { PIECE_O = 0, PIECE_S = 3, PIECE_Z = 4 };
+        static const int32_t MAX_ROLLS = 6;
+
+        static bool IsInHistory(const RandomizerState& state, uint8_t piece)
+        {
+            for (int32_t i = 0; i < HISTORY_SIZE; i++) {
+                if (state.history[i] == piece)
+                    return true;
+            }
+            return false;
+        }
+    };
+
+
+    // memoryless: each piece is independent of the previous ones
+    class PureRandomizer : public TetrisRandomizer
+    {
+    public:
+        const char* GetName() const override    { return "Pure random"; }
+
+        int8_t Next(RandomizerState& state) const override
+        {
+            return (int8_t)state.rng.NextBelow(CNT_TETRIMINOS);
+        }
+    };
+
+
+    const BagRandomizer RANDOMIZER_7_BAG_IMPL("7-bag", CNT_TETRIMINOS);
+    const BagRandomizer RANDOMIZER_14_BAG_IMPL("14-bag", 2 * CNT_TETRIMINOS);
+    const HistoryRandomizer RANDOMIZER_TGM_HISTORY_IMPL;
+    const PureRandomizer RANDOMIZER_PURE_IMPL;
+}
+
+
+const TetrisRandomizer* GetRandomizer(RandomizerType type)
+{
+    switch (type)
+    {
+    case RANDOMIZER_14_BAG:         return &RANDOMIZER_14_BAG_IMPL;
+    case RANDOMIZER_TGM_HISTORY:    return &RANDOMIZER_TGM_HISTORY_IMPL;
+    case RANDOMIZER_PURE:           return &RANDOMIZER_PURE_IMPL;
+    default:                        return &RANDOMIZER_7_BAG_IMPL;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef TETRISRANDOM_H
+#define TETRISRANDOM_H
+
+#include "TetrisConstants.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+//=======================
+//  Fast, seedable PRNG (xoshiro128**)
+//  Each engine owns one, so there is no shared state between engines/threads.
+//=======================
+struct TetrisRng
+{
+    uint32_t s[4];
+
+    void Seed(uint64_t seed);
+    uint32_t Next();
+    // uniform random number in [0, range)
+    uint32_t NextBelow(uint32_t range)   { return (uint32_t)(((uint64_t)Next() * range) >> 32); }
+};
+
+
+
+//=======================
+//  Randomizer state - plain data, so it can be copied along with the engine
+//=======================
+const int32_t MAX_BAG_SIZE = 2 * CNT_TETRIMINOS;
+const int32_t HISTORY_SIZE = 4;
+
+struct RandomizerState
+{
+    TetrisRng rng;
+    uint8_t bag[MAX_BAG_SIZE];
+    uint8_t nBagIndex;
+    uint8_t history[HISTORY_SIZE];
+    bool bFirstPiece;
+};
+
+
+
+//=======================
+//  Randomizer interface
+//  The randomizers are stateless: all their state lives in a RandomizerState.
+//=======================
+class TetrisRandomizer
+{
+public:
+    virtual ~TetrisRandomizer() {}
+
+    virtual const char* GetName() const = 0;
+    virtual void Reset(RandomizerState& state, uint64_t seed) const;
+    virtual int8_t Next(RandomizerState& state) const = 0;
+    // Keeps what a player can know of the state (e.g. the pieces left in the bag, the history),
+    // and draws the rest again from the seed: the pieces which follow are a sample of what may come
+    virtual void Resample(RandomizerState& state, uint64_t seed) const;
+
+    // bulk generation of long piece sequences
+    virtual void Generate(RandomizerState& state, int8_t* pPieces, size_t cntPieces) const;
+};
+
+
+enum RandomizerType
+{
+    RANDOMIZER_7_BAG,           // https://tetris.fandom.com/wiki/Random_Generator
+    RANDOMIZER_14_BAG,          // two 7-bags, shuffled together
+    RANDOMIZER_TGM_HISTORY,     // https://tetris.fandom.com/wiki/TGM_randomizer
+    RANDOMIZER_PURE,            // memoryless
+    CNT_RANDOMIZERS
+};
+
+const TetrisRandomizer* GetRandomizer(RandomizerType type);
+
+
+#endif // TETRISRANDOM_H
@@ -0,0 +1,911 @@
+#include "TetrisReplay.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace std;
+
+
+namespace
+{
+    const char REPLAY_MAGIC[4] = { 'T', 'R', 'P', 'L' };
+    const char* REPLAY_EXTENSION = ".trp";
+    // records (the low bits of the tags: 3 bits, 2 in version 1)
+    enum { RECORD_INPUT, RECORD_TICKS, RECORD_RULES, RECORD_END, RECORD_KEYFRAME, RECORD_REPEAT };
+    const uint32_t CNT_KIND_BITS = 3;
+    const uint32_t CNT_KIND_BITS_V1 = 2;
+
+    // (for the player, until a replay is opened)
+    const TetrisRules DEFAULT_RULES = { 1, 0, 0, 0 };
+
+    bool IsSameRules(const TetrisRules& a, const TetrisRules& b)
+    {
+        return a.nStartLevel == b.nStartLevel && a.nDelayAutoRepeatMs == b.nDelayAutoRepeatMs
+            && a.nSpeedAutoRepeatMs == b.nSpeedAutoRepeatMs && a.nGravity == b.nGravity;
+    }
+
+    void AppendRules(vector<uint8_t>& out, const TetrisRules& rules)
+    {
+        AppendVarint(out, ZigzagEncode(rules.nStartLevel));
+        AppendVarint(out, ZigzagEncode(rules.nDelayAutoRepeatMs));
+        AppendVarint(out, ZigzagEncode(rules.nSpeedAutoRepeatMs));
+        AppendVarint(out, ZigzagEncode(rules.nGravity));
+    }
+
+    uint64_t PackInput(const TetrisInput& input)
+    {
+        return (uint64_t)input.nPressed | ((uint64_t)input.nHeld << CNT_ACTIONS);
+    }
+
+    bool UnpackInput(uint64_t packed, TetrisInput& input)
+    {
+        if (packed >> (2 * CNT_ACTIONS) != 0)
+            return false;
+        const uint64_t mask = (1 << CNT_ACTIONS) - 1;
+        input.nPressed = (uint8_t)(packed & mask);
+        input.nHeld = (uint8_t)((packed >> CNT_ACTIONS) & mask);
+        return true;
+    }
+
+
+    // keyframes: the flags byte
+    enum {
+        KEYFRAME_GAME_OVER      = 0x01,
+        KEYFRAME_SPAWN_PENDING  = 0x02,
+        KEYFRAME_RESTING        = 0x04,
+        KEYFRAME_HELD           = 0x08,
+        KEYFRAME_HOLD_ALLOWED   = 0x10,
+        KEYFRAME_TSPIN          = 0x20,
+        KEYFRAME_FIRST_PIECE    = 0x40,
+    };
+    const int32_t CNT_COLOR_BITS = 3;
+    const int32_t MAX_ANIMATION_FLAGS = 0x1F;
+
+    // Pieces of the randomizer, 4 bits each (low bits first)
+    void AppendNibbles(vector<uint8_t>& out, const uint8_t* pValues, int32_t count)
+    {
+        for (int32_t i = 0; i < count; i += 2) {
+            uint8_t high = (i + 1 < count) ? pValues[i + 1] : 0;
+            out.push_back((uint8_t)((pValues[i] & 0x0F) | (high << 4)));
+        }
+    }
+
+    // Writes the state (without the rules: they are those of the replay)
+    void AppendKeyframe(vector<uint8_t>& out, const TetrisEngineState& state)
+    {
+        const RandomizerState& random = state.m_RandomState;
+        out.push_back((uint8_t)((state.m_bGameOver ? KEYFRAME_GAME_OVER : 0)
+                              | (state.m_bSpawnNextPiece ? KEYFRAME_SPAWN_PENDING : 0)
+                              | (state.m_bPieceResting ? KEYFRAME_RESTING : 0)
+                              | (state.m_bIsPieceHeld ? KEYFRAME_HELD : 0)
+                              | (state.m_bAllowedToHold ? KEYFRAME_HOLD_ALLOWED : 0)
+                              | (state.m_PerformedTSpin ? KEYFRAME_TSPIN : 0)
+                              | (random.bFirstPiece ? KEYFRAME_FIRST_PIECE : 0)));
+        AppendVarint(out, (uint64_t)state.m_nScore);
+        AppendVarint(out, (uint64_t)state.m_nLines);
+        AppendVarint(out, (uint64_t)state.m_nLevel);
+        AppendVarint(out, (uint64_t)state.m_nPieces);
+        AppendVarint(out, (uint64_t)state.m_nGravity);
+        AppendVarint(out, ZigzagEncode(state.m_nGravityAccum));
+        AppendVarint(out, ZigzagEncode(state.m_nCurrentTime));
+        AppendVarint(out, ZigzagEncode(state.m_nMovingLockTime));
+        AppendVarint(out, ZigzagEncode(state.m_nAutoRepeatCountdown));
+        AppendVarint(out, (uint64_t)state.m_AnimationFlags);
+        AppendVarint(out, (uint64_t)state.m_nAnimationTimer);
+
+        // pieces (the NEXT and HOLD pieces are where a new piece is: only their types)
+        const TetroPlacement& current = state.m_CurrentPiece.getPlacement();
+        out.push_back((uint8_t)current.nType);
+        out.push_back((uint8_t)current.nRot);
+        out.push_back((uint8_t)current.x);
+        out.push_back((uint8_t)current.y);
+        for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+            out.push_back((uint8_t)state.m_NextPieces[i].getTypeIndex());
+        }
+        out.push_back((uint8_t)state.m_HeldPiece.getTypeIndex());
+
+        // randomizer
+        for (int32_t i = 0; i < 4; i++) {
+            for (int32_t b = 0; b < 4; b++) {
+                out.push_back((uint8_t)(random.rng.s[i] >> (8 * b)));
+            }
+        }
+        AppendNibbles(out, random.bag, MAX_BAG_SIZE);
+        AppendNibbles(out, random.history, HISTORY_SIZE);
+        out.push_back(random.nBagIndex);
+
+        AppendVarint(out, (uint64_t)state.m_nCntLinesBeingDropped);
+        for (int32_t i = 0; i < state.m_nCntLinesBeingDropped; i++) {
+            AppendVarint(out, (uint64_t)state.m_LinesBeingDropped[i]);
+        }
+
+        // board
+        const TetrisBoard& board = state.m_Board;
+        const uint16_t* pRows = board.GetRows();
+        int32_t top = 0;
+        while (top < BOARD_ROWS && pRows[top] == 0)
+            top++;
+        AppendVarint(out, (uint64_t)top);
+        for (int32_t row = top; row < BOARD_ROWS; row++) {
+            out.push_back((uint8_t)pRows[row]);
+            out.push_back((uint8_t)(pRows[row] >> 8));
+        }
+        uint32_t bits = 0;
+        int32_t cntBits = 0;
+        for (int32_t row = top; row < BOARD_ROWS; row++) {
+            for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+                if ((pRows[row] >> x) & 1) {
+                    bits |= (uint32_t)board.GetTile(x, row - EXTRA_HEIGHT_TILES) << cntBits;
+                    cntBits += CNT_COLOR_BITS;
+                }
+                for (; cntBits >= 8; cntBits -= 8, bits >>= 8)
+                    out.push_back((uint8_t)bits);
+            }
+        }
+        if (cntBits > 0)
+            out.push_back((uint8_t)bits);
+    }
+
+
+    // Reads the keyframe of AppendKeyframe(), checking that every value is in range
+    class KeyframeParser
+    {
+    public:
+        KeyframeParser(const uint8_t* pData, size_t size) : m_p(pData), m_pEnd(pData + size), m_bOk(true) {}
+
+        bool IsOk() const       { return m_bOk; }
+        // (all of it read)
+        bool IsEnd() const      { return m_p == m_pEnd; }
+
+        uint8_t Byte()
+        {
+            if (m_p == m_pEnd) {
+                m_bOk = false;
+                return 0;
+            }
+            return *m_p++;
+        }
+
+        // a value in [minValue, maxValue]
+        int64_t Unsigned(int64_t minValue, int64_t maxValue)
+        {
+            uint64_t value;
+            if (!ReadVarint(m_p, m_pEnd, value) || value < (uint64_t)minValue || value > (uint64_t)maxValue) {
+                m_bOk = false;
+                return minValue;
+            }
+            return (int64_t)value;
+        }
+
+        int64_t Signed(int64_t minValue, int64_t maxValue)
+        {
+            uint64_t value;
+            int64_t signedValue = 0;
+            if (!ReadVarint(m_p, m_pEnd, value) || (signedValue = ZigzagDecode(value)) < minValue || signedValue > maxValue) {
+                m_bOk = false;
+                return minValue;
+            }
+            return signedValue;
+        }
+
+        // pieces of the randomizer (4 bits each)
+        bool PieceTypes(uint8_t* pValues, int32_t count)
+        {
+            for (int32_t i = 0; i < count; i += 2) {
+                uint8_t byte = Byte();
+                pValues[i] = byte & 0x0F;
+                if (i + 1 < count)
+                    pValues[i + 1] = byte >> 4;
+                else if ((byte >> 4) != 0)
+                    m_bOk = false;
+            }
+            for (int32_t i = 0; i < count; i++) {
+                if (pValues[i] >= CNT_TETRIMINOS)
+                    m_bOk = false;
+            }
+            return m_bOk;
+        }
+
+        int8_t PieceType()
+        {
+            uint8_t type = Byte();
+            if (type >= CNT_TETRIMINOS)
+                m_bOk = false;
+            return m_bOk ? (int8_t)type : 0;
+        }
+
+    private:
+        const uint8_t* m_p;
+        const uint8_t* m_pEnd;
+        bool m_bOk;
+    };
+
+
+    // false if the keyframe is cut short, or does not describe a valid state
+    bool ReadKeyframe(const uint8_t* pData, size_t size, const TetrisRules& rules, TetrisEngineState& state)
+    {
+        KeyframeParser parser(pData, size);
+        // (the padding too, as the engine has it)
+        memset(static_cast<void*>(&state), 0, sizeof(TetrisEngineState));
+        state.m_Rules = rules;
+
+        uint8_t flags = parser.Byte();
+        if (flags > (KEYFRAME_FIRST_PIECE << 1) - 1)
+            return false;
+        state.m_bGameOver = (flags & KEYFRAME_GAME_OVER) != 0;
+        state.m_bSpawnNextPiece = (flags & KEYFRAME_SPAWN_PENDING) != 0;
+        state.m_bPieceResting = (flags & KEYFRAME_RESTING) != 0;
+        state.m_bIsPieceHeld = (flags & KEYFRAME_HELD) != 0;
+        state.m_bAllowedToHold = (flags & KEYFRAME_HOLD_ALLOWED) != 0;
+        state.m_PerformedTSpin = (flags & KEYFRAME_TSPIN) != 0;
+        state.m_RandomState.bFirstPiece = (flags & KEYFRAME_FIRST_PIECE) != 0;
+        state.m_nScore = (int32_t)parser.Unsigned(0, INT32_MAX);
+        state.m_nLines = (int32_t)parser.Unsigned(0, INT32_MAX);
+        state.m_nLevel = (int32_t)parser.Unsigned(1, INT32_MAX);
+        state.m_nPieces = (int32_t)parser.Unsigned(0, INT32_MAX);
+        state.m_nGravity = (int32_t)parser.Unsigned(1, GRAVITY_ONE);
+        state.m_nGravityAccum = parser.Signed(0, GRAVITY_ONE - 1);
+        state.m_nCurrentTime = (int32_t)parser.Signed(INT32_MIN, INT32_MAX);
+        state.m_nMovingLockTime = (int32_t)parser.Signed(INT32_MIN, INT32_MAX);
+        state.m_nAutoRepeatCountdown = (int32_t)parser.Signed(INT32_MIN, INT32_MAX);
+        state.m_AnimationFlags = (int32_t)parser.Unsigned(0, MAX_ANIMATION_FLAGS);
+        state.m_nAnimationTimer = (int32_t)parser.Unsigned(0, INT32_MAX);
+
+        // pieces
+        TetroPlacement current;
+        current.nType = parser.PieceType();
+        current.nRot = (int8_t)parser.Byte();
+        current.x = (int8_t)parser.Byte();
+        current.y = (int8_t)parser.Byte();
+        if (!parser.IsOk() || current.nRot < 0 || current.nRot >= CNT_ROTATIONS)
+            return false;
+        state.m_CurrentPiece = Tetrimino(current);
+        for (int32_t i = 0; i < 4; i++) {
+            int32_t x = state.m_CurrentPiece.getX((int8_t)i), y = state.m_CurrentPiece.getY((int8_t)i);
+            if (x < 0 || x >= TABLE_WIDTH_TILES || y < -EXTRA_HEIGHT_TILES || y >= TABLE_HEIGHT_TILES)
+                return false;
+        }
+        for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+            state.m_NextPieces[i] = Tetrimino(parser.PieceType());
+        }
+        state.m_HeldPiece = Tetrimino(parser.PieceType());
+
+        // randomizer
+        RandomizerState& random = state.m_RandomState;
+        for (int32_t i = 0; i < 4; i++) {
+            for (int32_t b = 0; b < 4; b++) {
+                random.rng.s[i] |= (uint32_t)parser.Byte() << (8 * b);
+            }
+        }
+        parser.PieceTypes(random.bag, MAX_BAG_SIZE);
+        parser.PieceTypes(random.history, HISTORY_SIZE);
+        random.nBagIndex = parser.Byte();
+        if (random.nBagIndex > MAX_BAG_SIZE)
+            return false;
+
+        // lines being dropped (full lines, top to bottom)
+        state.m_nCntLinesBeingDropped = (int32_t)parser.Unsigned(0, MAX_LINES_PER_LOCK);
+        for (int32_t i = 0; i < state.m_nCntLinesBeingDropped; i++) {
+            int32_t minLine = (i == 0) ? 0 : state.m_LinesBeingDropped[i - 1] + 1;
+            state.m_LinesBeingDropped[i] = (int32_t)parser.Unsigned(minLine, TABLE_HEIGHT_TILES - 1);
+        }
+
+        // board
+        uint16_t rows[BOARD_ROWS] = {};
+        int32_t top = (int32_t)parser.Unsigned(0, BOARD_ROWS);
+        for (int32_t row = top; row < BOARD_ROWS; row++) {
+            rows[row] = parser.Byte();
+            rows[row] |= (uint16_t)(parser.Byte() << 8);
+            if (rows[row] > FULL_ROW_MASK || (row == top && rows[row] == 0))
+                return false;
+        }
+        state.m_Board.Clear();
+        uint32_t bits = 0;
+        int32_t cntBits = 0;
+        for (int32_t row = top; row < BOARD_ROWS && parser.IsOk(); row++) {
+            for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+                if (((rows[row] >> x) & 1) == 0)
+                    continue;
+                if (cntBits < CNT_COLOR_BITS) {
+                    bits |= (uint32_t)parser.Byte() << cntBits;
+                    cntBits += 8;
+                }
+                int8_t color = (int8_t)(bits & ((1 << CNT_COLOR_BITS) - 1));
+                bits >>= CNT_COLOR_BITS;
+                cntBits -= CNT_COLOR_BITS;
+                if (color >= CNT_TETRIMINOS)
+                    return false;
+                state.m_Board.SetTile(x, row - EXTRA_HEIGHT_TILES, color);
+            }
+        }
+        if (!parser.IsOk() || !parser.IsEnd() || bits != 0)
+            return false;
+        for (int32_t i = 0; i < state.m_nCntLinesBeingDropped; i++) {
+            if (!state.m_Board.IsFullLine(state.m_LinesBeingDropped[i]))
+                return false;
+        }
+        // (a piece in play is not inside the stack)
+        return state.m_bSpawnNextPiece || state.m_bGameOver || state.m_nCntLinesBeingDropped > 0
+            || !state.m_Board.DoesPieceCollide(state.m_CurrentPiece);
+    }
+}
+
+
+
+vector<string> ListReplayFiles(const char* pDirectory)
+{
+    vector<string> names;
+    size_t extLen = strlen(REPLAY_EXTENSION);
+    auto add = [&](const char* pName) {
+        size_t len = strlen(pName);
+        if (len > extLen && strcmp(pName + len - extLen, REPLAY_EXTENSION) == 0)
+            names.push_back(pName);
+    };
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE hFind = FindFirstFileA((string(pDirectory) + "\\*").c_str(), &data);
+    if (hFind != INVALID_HANDLE_VALUE)
+    {
+        do {
+            add(data.cFileName);
+        } while (FindNextFileA(hFind, &data));
+        FindClose(hFind);
+    }
+#else
+    DIR* pDir = opendir(pDirectory);
+    if (pDir != nullptr)
+    {
+        for (dirent* pEntry = readdir(pDir); pEntry != nullptr; pEntry = readdir(pDir))
+            add(pEntry->d_name);
+        closedir(pDir);
+    }
+#endif
+    sort(names.begin(), names.end());
+    return names;
+}
+
+
+
+/////////////////////////////////////////////
+//  RECORDER
+/////////////////////////////////////////////
+
+TetrisReplayRecorder::TetrisReplayRecorder()
+: m_Rules()
+, m_nHeld(0)
+, m_nPressed(0)
+, m_nTicks(0)
+, m_nIdleUpdates(0)
+, m_nRepeatUpdates(0)
+, m_nUpdates(0)
+, m_nKeyframePieces(0)
+, m_bFinished(false)
+{
+}
+
+
+void TetrisReplayRecorder::Start(const TetrisRules& rules, uint64_t seed, RandomizerType randomizer)
+{
+    m_Data.assign(REPLAY_MAGIC, REPLAY_MAGIC + sizeof(REPLAY_MAGIC));
+    AppendVarint(m_Data, VERSION);
+    AppendVarint(m_Data, seed);
+    AppendVarint(m_Data, (uint64_t)randomizer);
+    AppendRules(m_Data, rules);
+    m_Rules = rules;
+    m_nHeld = 0;
+    m_nPressed = 0;
+    m_nTicks = 0;
+    m_nIdleUpdates = 0;
+    m_nRepeatUpdates = 0;
+    m_nUpdates = 0;
+    m_nKeyframePieces = 0;
+    m_bFinished = false;
+}
+
+
+void TetrisReplayRecorder::RecordRules(const TetrisRules& rules)
+{
+    if (m_bFinished || IsSameRules(rules, m_Rules))
+        return;
+    AppendTag(RECORD_RULES);
+    AppendRules(m_Data, rules);
+    m_Rules = rules;
+}
+
+
+void TetrisReplayRecorder::Record(const TetrisInput& input, int32_t nTicks)
+{
+    if (m_bFinished)
+        return;
+    m_nUpdates++;
+    // (most updates only let the time run, or press the same keys again, e.g. the soft drops
+    // of a bot: they are counted, not written)
+    if (input.nPressed != 0 && input.nPressed == m_nPressed && input.nHeld == m_nHeld && nTicks == m_nTicks) {
+        m_nRepeatUpdates++;
+        return;
+    }
+    FlushRepeats();
+    m_nPressed = input.nPressed;
+    if (input.nPressed == 0 && input.nHeld == m_nHeld && nTicks == m_nTicks) {
+        m_nIdleUpdates++;
+        return;
+    }
+    if (nTicks == m_nTicks) {
+        AppendTag(RECORD_INPUT);
+    }
+    else {
+        AppendTag(RECORD_TICKS);
+        AppendVarint(m_Data, (uint64_t)nTicks);
+        m_nTicks = nTicks;
+    }
+    AppendVarint(m_Data, PackInput(input));
+    m_nHeld = input.nHeld;
+}
+
+
+void TetrisReplayRecorder::RecordKeyframe(const TetrisEngine& engine)
+{
+    if (m_bFinished || engine.GetPieceCount() - m_nKeyframePieces < KEYFRAME_PIECES)
+        return;
+    vector<uint8_t> keyframe;
+    AppendKeyframe(keyframe, engine.GetState());
+    AppendTag(RECORD_KEYFRAME);
+    AppendVarint(m_Data, m_nUpdates);
+    AppendVarint(m_Data, keyframe.size());
+    m_Data.insert(m_Data.end(), keyframe.begin(), keyframe.end());
+    m_nKeyframePieces = engine.GetPieceCount();
+}
+
+
+void TetrisReplayRecorder::Finish(const TetrisEngine& engine)
+{
+    if (m_bFinished)
+        return;
+    AppendTag(RECORD_END);
+    uint64_t hash = engine.GetStateHash();
+    for (int32_t i = 0; i < 8; i++) {
+        m_Data.push_back((uint8_t)(hash >> (8 * i)));
+    }
+    AppendVarint(m_Data, (uint64_t)engine.GetScore());
+    AppendVarint(m_Data, (uint64_t)engine.GetLines());
+    AppendVarint(m_Data, (uint64_t)engine.GetLevel());
+    AppendVarint(m_Data, (uint64_t)engine.GetPieceCount());
+    m_bFinished = true;
+}
+
+
+bool TetrisReplayRecorder::Save(const char* pPath) const
+{
+    FILE* pFile = fopen(pPath, "wb");
+    if (pFile == nullptr)
+        return false;
+    bool bOk = fwrite(m_Data.data(), 1, m_Data.size(), pFile) == m_Data.size();
+    return (fclose(pFile) == 0) && bOk;
+}
+
+
+void TetrisReplayRecorder::AppendTag(uint32_t kind)
+{
+    FlushRepeats();
+    AppendVarint(m_Data, (m_nIdleUpdates << CNT_KIND_BITS) | kind);
+    m_nIdleUpdates = 0;
+}
+
+
+void TetrisReplayRecorder::FlushRepeats()
+{
+    // (repeats follow the update they repeat: there are no idle updates before them)
+    if (m_nRepeatUpdates == 0)
+        return;
+    AppendVarint(m_Data, RECORD_REPEAT);
+    AppendVarint(m_Data, m_nRepeatUpdates);
+    m_nRepeatUpdates = 0;
+}
+
+
+
+/////////////////////////////////////////////
+//  READER
+/////////////////////////////////////////////
+
+TetrisReplayReader::TetrisReplayReader()
+: m_pData(nullptr)
+, m_pEnd(nullptr)
+, m_nVersion(0)
+, m_nKindBits(CNT_KIND_BITS)
+, m_nSeed(0)
+, m_RandomizerType(RANDOMIZER_7_BAG)
+, m_StartRules()
+, m_Rules()
+, m_nHeld(0)
+, m_nPressed(0)
+, m_nTicks(0)
+, m_nIdleUpdates(0)
+, m_nRepeatUpdates(0)
+, m_bPending(false)
+, m_nPendingKind(RECORD_INPUT)
+, m_PendingInput()
+, m_nPendingTicks(0)
+, m_nPendingRepeats(0)
+, m_PendingRules()
+, m_nPendingKeyframeUpdates(0)
+, m_pPendingKeyframe(nullptr)
+, m_nPendingKeyframeSize(0)
+, m_pKeyframe(nullptr)
+, m_nKeyframeSize(0)
+, m_nUpdates(0)
+, m_bEnd(false)
+, m_bCorrupt(false)
+, m_Result()
+{
+}
+
+
+bool TetrisReplayReader::Open(const uint8_t* pData, size_t size)
+{
+    *this = TetrisReplayReader();
+    const uint8_t* pEnd = pData + size;
+    uint64_t version, seed, randomizer;
+    if (size < sizeof(REPLAY_MAGIC) || memcmp(pData, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0)
+        return false;
+    m_pData = pData + sizeof(REPLAY_MAGIC);
+    m_pEnd = pEnd;
+    if (!ReadVarint(m_pData, m_pEnd, version) || version < 1 || version > TetrisReplayRecorder::VERSION
+        || !ReadVarint(m_pData, m_pEnd, seed)
+        || !ReadVarint(m_pData, m_pEnd, randomizer) || randomizer >= (uint64_t)CNT_RANDOMIZERS
+        || !ReadRules(m_StartRules)) {
+        *this = TetrisReplayReader();
+        return false;
+    }
+    m_nVersion = (uint32_t)version;
+    m_nKindBits = (version == 1) ? CNT_KIND_BITS_V1 : CNT_KIND_BITS;
+    m_nSeed = seed;
+    m_RandomizerType = (RandomizerType)randomizer;
+    m_Rules = m_StartRules;
+    return true;
+}
+
+
+TetrisEngine TetrisReplayReader::CreateEngine() const
+{
+    return TetrisEngine(m_StartRules, m_nSeed, GetRandomizer(m_RandomizerType));
+}
+
+
+bool TetrisReplayReader::Next(TetrisInput& input, int32_t& nTicks)
+{
+    while (!m_bEnd && !m_bCorrupt)
+    {
+        if (m_nIdleUpdates > 0)
+        {
+            m_nIdleUpdates--;
+            m_nPressed = 0;
+            input.nPressed = 0;
+            input.nHeld = m_nHeld;
+            nTicks = m_nTicks;
+            m_nUpdates++;
+            return true;
+        }
+        if (m_nRepeatUpdates > 0)
+        {
+            m_nRepeatUpdates--;
+            input.nPressed = m_nPressed;
+            input.nHeld = m_nHeld;
+            nTicks = m_nTicks;
+            m_nUpdates++;
+            return true;
+        }
+        if (!m_bPending)
+        {
+            if (!ReadRecord())
+                m_bCorrupt = true;
+            continue;
+        }
+        if (ApplyRecord(input, nTicks))
+            return true;
+    }
+    return false;
+}
+
+
+bool TetrisReplayReader::SkipToKeyframe()
+{
+    TetrisInput input;
+    int32_t nTicks;
+    while (!m_bEnd && !m_bCorrupt)
+    {
+        // (the idle and repeated updates only count)
+        if (m_nIdleUpdates > 0)
+            m_nPressed = 0;
+        m_nUpdates += (int64_t)(m_nIdleUpdates + m_nRepeatUpdates);
+        m_nIdleUpdates = 0;
+        m_nRepeatUpdates = 0;
+        if (!m_bPending)
+        {
+            if (!ReadRecord())
+                m_bCorrupt = true;
+            continue;
+        }
+        bool bKeyframe = (m_nPendingKind == RECORD_KEYFRAME);
+        ApplyRecord(input, nTicks);
+        if (bKeyframe && !m_bCorrupt)
+            return true;
+    }
+    return false;
+}
+
+
+bool TetrisReplayReader::SkipToEnd()
+{
+    while (SkipToKeyframe()) {}
+    return m_bEnd;
+}
+
+
+bool TetrisReplayReader::RestoreKeyframe(TetrisEngine& engine) const
+{
+    // (version 2 keyframes are engine states as they were in memory, of the build which wrote them)
+    TetrisEngineState state;
+    if (m_pKeyframe == nullptr || m_nVersion < 3 || !ReadKeyframe(m_pKeyframe, m_nKeyframeSize, m_Rules, state))
+        return false;
+    engine.RestoreState(state);
+    return true;
+}
+
+
+bool TetrisReplayReader::ApplyRecord(TetrisInput& input, int32_t& nTicks)
+{
+    // the record, after its idle updates
+    m_bPending = false;
+    switch (m_nPendingKind)
+    {
+    case RECORD_RULES:
+        m_Rules = m_PendingRules;
+        return false;
+    case RECORD_END:
+        m_bEnd = true;
+        return false;
+    case RECORD_REPEAT:
+        m_nRepeatUpdates = m_nPendingRepeats;
+        return false;
+    case RECORD_KEYFRAME:
+        // (a keyframe knows how many updates come before it)
+        if (m_nPendingKeyframeUpdates != (uint64_t)m_nUpdates) {
+            m_bCorrupt = true;
+            return false;
+        }
+        m_pKeyframe = m_pPendingKeyframe;
+        m_nKeyframeSize = m_nPendingKeyframeSize;
+        return false;
+    default:
+        input = m_PendingInput;
+        m_nTicks = m_nPendingTicks;
+        nTicks = m_nTicks;
+        m_nHeld = input.nHeld;
+        m_nPressed = input.nPressed;
+        m_nUpdates++;
+        return true;
+    }
+}
+
+
+bool TetrisReplayReader::Step(TetrisEngine& engine)
+{
+    TetrisInput input;
+    int32_t nTicks;
+    if (!Next(input, nTicks))
+        return false;
+    engine.SetRules(m_Rules);
+    engine.UpdateGame(input, nTicks);
+    return true;
+}
+
+
+bool TetrisReplayReader::PlayToEnd(TetrisEngine& engine)
+{
+    while (Step(engine)) {}
+    return m_bEnd && MatchesResult(engine);
+}
+
+
+bool TetrisReplayReader::MatchesResult(const TetrisEngine& engine) const
+{
+    return m_bEnd && engine.GetStateHash() == m_Result.nStateHash && engine.GetScore() == m_Result.nScore
+        && engine.GetLines() == m_Result.nLines && engine.GetLevel() == m_Result.nLevel
+        && (m_Result.nPieces < 0 || engine.GetPieceCount() == m_Result.nPieces);
+}
+
+
+bool TetrisReplayReader::ReadRecord()
+{
+    uint64_t tag;
+    if (!ReadVarint(m_pData, m_pEnd, tag))
+        return false;
+    m_nIdleUpdates = tag >> m_nKindBits;
+    m_nPendingKind = (uint32_t)(tag & ((1 << m_nKindBits) - 1));
+    m_bPending = true;
+
+    uint64_t value;
+    switch (m_nPendingKind)
+    {
+    case RECORD_TICKS:
+        // (the ticks of the record's update: the idle updates before it keep the previous ones)
+        if (!ReadVarint(m_pData, m_pEnd, value) || value > (uint64_t)INT32_MAX)
+            return false;
+        m_nPendingTicks = (int32_t)value;
+        return ReadVarint(m_pData, m_pEnd, value) && UnpackInput(value, m_PendingInput);
+    case RECORD_INPUT:
+        m_nPendingTicks = m_nTicks;
+        return ReadVarint(m_pData, m_pEnd, value) && UnpackInput(value, m_PendingInput);
+    case RECORD_RULES:
+        return ReadRules(m_PendingRules);
+    case RECORD_REPEAT:
+        // (right after the update it repeats, which pressed some key)
+        return m_nVersion >= 4 && m_nIdleUpdates == 0 && m_nPressed != 0
+            && ReadVarint(m_pData, m_pEnd, m_nPendingRepeats) && m_nPendingRepeats > 0;
+    case RECORD_KEYFRAME:
+        if (!ReadVarint(m_pData, m_pEnd, m_nPendingKeyframeUpdates) || !ReadVarint(m_pData, m_pEnd, value)
+            || value > (uint64_t)(m_pEnd - m_pData))
+            return false;
+        m_pPendingKeyframe = m_pData;
+        m_nPendingKeyframeSize = (size_t)value;
+        m_pData += value;
+        return true;
+    case RECORD_END:
+        if (m_pEnd - m_pData < 8)
+            return false;
+        m_Result.nStateHash = 0;
+        for (int32_t i = 0; i < 8; i++) {
+            m_Result.nStateHash |= (uint64_t)m_pData[i] << (8 * i);
+        }
+        m_pData += 8;
+        uint64_t score, lines, level, pieces;
+        if (!ReadVarint(m_pData, m_pEnd, score) || !ReadVarint(m_pData, m_pEnd, lines) || !ReadVarint(m_pData, m_pEnd, level))
+            return false;
+        pieces = (uint64_t)-1;
+        if (m_nVersion >= 2 && !ReadVarint(m_pData, m_pEnd, pieces))
+            return false;
+        m_Result.nScore = (int32_t)score;
+        m_Result.nLines = (int32_t)lines;
+        m_Result.nLevel = (int32_t)level;
+        m_Result.nPieces = (int32_t)pieces;
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+bool TetrisReplayReader::ReadRules(TetrisRules& rules)
+{
+    uint64_t values[4];
+    for (int32_t i = 0; i < 4; i++) {
+        if (!ReadVarint(m_pData, m_pEnd, values[i]))
+            return false;
+    }
+    rules.nStartLevel = (int32_t)ZigzagDecode(values[0]);
+    rules.nDelayAutoRepeatMs = (int32_t)ZigzagDecode(values[1]);
+    rules.nSpeedAutoRepeatMs = (int32_t)ZigzagDecode(values[2]);
+    rules.nGravity = (int32_t)ZigzagDecode(values[3]);
+    // (as the game can set them: the engine indexes its tables with the level)
+    return rules.nStartLevel >= 1 && rules.nStartLevel <= MAX_LEVEL && rules.nDelayAutoRepeatMs >= 0
+        && rules.nSpeedAutoRepeatMs >= 0 && rules.nGravity >= 0;
+}
+
+
+
+/////////////////////////////////////////////
+//  PLAYER
+/////////////////////////////////////////////
+
+TetrisReplayPlayer::TetrisReplayPlayer()
+: m_Reader()
+, m_Engine(DEFAULT_RULES, 0)
+, m_nUpdates(0)
+, m_nPieces(0)
+, m_nTickBudget(0)
+{
+}
+
+
+bool TetrisReplayPlayer::Load(const char* pPath)
+{
+    FILE* pFile = fopen(pPath, "rb");
+    if (pFile == nullptr)
+        return false;
+    vector<uint8_t> data;
+    uint8_t buffer[1 << 16];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+        data.insert(data.end(), buffer, buffer + size);
+    bool bOk = ferror(pFile) == 0;
+    fclose(pFile);
+    return bOk && Open(data.data(), data.size());
+}
+
+
+bool TetrisReplayPlayer::Open(const uint8_t* pData, size_t size)
+{
+    m_Data.assign(pData, pData + size);
+    m_Keyframes.clear();
+    if (!m_Reader.Open(m_Data.data(), m_Data.size())) {
+        m_Data.clear();
+        return false;
+    }
+
+    // index the keyframes (the engine is only used to read their piece counts)
+    TetrisReplayReader scan = m_Reader;
+    m_Engine = m_Reader.CreateEngine();
+    while (scan.SkipToKeyframe())
+    {
+        if (scan.RestoreKeyframe(m_Engine))
+            m_Keyframes.push_back({ scan, m_Engine.GetPieceCount() });
+    }
+    m_nUpdates = scan.GetUpdateCount();
+    m_Engine = m_Reader.CreateEngine();
+    if (scan.IsEnd() && scan.GetResult().nPieces >= 0) {
+        m_nPieces = scan.GetResult().nPieces;
+    }
+    else {
+        // (the pieces are not recorded in version 1, nor in a replay cut short: play it once)
+        scan = m_Reader;
+        while (scan.Step(m_Engine)) {}
+        m_nPieces = m_Engine.GetPieceCount();
+        m_Engine = m_Reader.CreateEngine();
+    }
+    m_nTickBudget = 0;
+    return true;
+}
+
+
+bool TetrisReplayPlayer::Step()
+{
+    return m_Reader.Step(m_Engine);
+}
+
+
+void TetrisReplayPlayer::Play(int64_t nTicks)
+{
+    m_nTickBudget += nTicks;
+    TetrisInput input;
+    int32_t nStepTicks;
+    while (m_nTickBudget > 0 && m_Reader.Next(input, nStepTicks))
+    {
+        m_Engine.SetRules(m_Reader.GetRules());
+        m_Engine.UpdateGame(input, nStepTicks);
+        m_nTickBudget -= (nStepTicks > 0) ? nStepTicks : 1;
+    }
+    if (IsEnd())
+        m_nTickBudget = 0;
+}
+
+
+void TetrisReplayPlayer::SeekPiece(int32_t nPiece)
+{
+    if (!IsOpen())
+        return;
+    // the last keyframe before the piece spawned (or the start of the game)
+    auto it = lower_bound(m_Keyframes.begin(), m_Keyframes.end(), nPiece,
+                          [](const Keyframe& k, int32_t piece) { return k.nPieces < piece; });
+    if (it != m_Keyframes.begin()) {
+        --it;
+        m_Reader = it->reader;
+        m_Reader.RestoreKeyframe(m_Engine);
+    }
+    else {
+        m_Reader.Open(m_Data.data(), m_Data.size());
+        m_Engine = m_Reader.CreateEngine();
+    }
+    while (m_Engine.GetPieceCount() < nPiece && Step()) {}
+    m_nTickBudget = 0;
+}
@@ -0,0 +1,278 @@
+#ifndef TETRISREPLAY_H
+#define TETRISREPLAY_H
+
+#include "TetrisEngine.h"
+#include "TetrisRandom.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+//=======================
+//  Varints (LEB128: 7 bits per byte, low bits first), and zigzag for the
+//  signed values (small negative numbers stay short)
+//=======================
+inline void AppendVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// false if the varint is cut short, or longer than 64 bits
+inline bool ReadVarint(const uint8_t*& p, const uint8_t* pEnd, uint64_t& value)
+{
+    value = 0;
+    for (int32_t shift = 0; shift < 64 && p < pEnd; shift += 7)
+    {
+        uint8_t byte = *p++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+inline uint64_t ZigzagEncode(int64_t value)     { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+inline int64_t ZigzagDecode(uint64_t value)     { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+
+
+//=======================
+//  Replay of a game: the seed, and the input of every engine update.
+//  The engine is deterministic, so the updates replayed from the same seed
+//  (and rules) play exactly the same game.
+//
+//  Format (version 4):
+//    "TRPL", varint version, varint seed, varint randomizer,
+//    the rules (4 zigzag varints: start level, auto-repeat delay and speed, gravity),
+//    then the records, each a varint tag = (idle updates << 3) | kind
+//  The idle updates come before the record: no key pressed, the same keys held
+//  as the update before, and the same ticks. Kinds:
+//    INPUT: an update with other keys, and the same ticks: varint (pressed | held << 7)
+//    TICKS: an update with other ticks (they are the ticks of the next updates):
+//           varint ticks, varint (pressed | held << 7)
+//    RULES: new rules for the next updates (4 zigzag varints)
+//    REPEAT: the update before (which pressed some key) is repeated: varint count
+//           of the repeats (no idle updates before it)
+//    END:   the last record: state hash (8 bytes, little endian), varint score,
+//           varint lines, varint level, varint pieces
+//    KEYFRAME: the whole engine state after the updates so far: varint updates,
+//           varint size, then the state (the rules are those of the replay):
+//           flags byte (game over, spawn pending, resting, held, hold allowed,
+//           T-Spin, first piece), varints score, lines, level, pieces, gravity,
+//           zigzag varints gravity fraction, current time, moving lock time,
+//           auto-repeat countdown, varints animation flags, animation timer;
+//           the current piece (type, rotation, x, y: 4 bytes), the NEXT and HOLD
+//           types (1 byte each); the randomizer: 4 words (little endian), the bag
+//           and the history (4 bits per piece), the bag index; the lines being
+//           dropped (varint count, then varint rows); the board: varint count
+//           of empty rows at the top, the masks of the other rows (2 bytes each,
+//           little endian), then the color of each occupied tile (3 bits, rows
+//           top to bottom, low bits first)
+//  A game driven with fixed steps (as the frontend does) costs a few bytes for
+//  each key pressed or released, and nothing for the steps in between, nor for
+//  a key pressed again at each step (the games of the bots take about 9 bytes
+//  per piece); the keyframes (every KEYFRAME_PIECES pieces) add about 5 bytes
+//  per piece.
+//  Version 1 has 2 bits of kind in the tags, no keyframes and no pieces at the end;
+//  the keyframes of version 2 are engine states as they were in memory: they are
+//  skipped, not restored. REPEAT records are new in version 4.
+//=======================
+struct TetrisReplayResult
+{
+    uint64_t nStateHash;
+    int32_t nScore;
+    int32_t nLines;
+    int32_t nLevel;
+    int32_t nPieces;        // (-1 in version 1)
+};
+
+
+// The replays (file names) of a directory, sorted by name
+std::vector<std::string> ListReplayFiles(const char* pDirectory);
+
+
+
+//=======================
+//  Records a game, while it is played (one Record() call per engine update)
+//=======================
+class TetrisReplayRecorder
+{
+public:
+    static const uint32_t VERSION = 4;
+    // A seek re-simulates at most this many pieces
+    static const int32_t KEYFRAME_PIECES = 16;
+
+public:
+    TetrisReplayRecorder();
+
+    void Start(const TetrisRules& rules, uint64_t seed, RandomizerType randomizer = RANDOMIZER_7_BAG);
+    // The rules of the next updates (nothing is recorded if they did not change)
+    void RecordRules(const TetrisRules& rules);
+    void Record(const TetrisInput& input, int32_t nTicks);
+    // The engine after the update (optional, for seeking): written as a keyframe every KEYFRAME_PIECES pieces
+    void RecordKeyframe(const TetrisEngine& engine);
+    // The end of the game (or where it was left), with the result to check the replay against
+    void Finish(const TetrisEngine& engine);
+
+    bool IsFinished() const                     { return m_bFinished; }
+    const std::vector<uint8_t>& GetData() const { return m_Data; }
+    bool Save(const char* pPath) const;
+
+private:
+    void AppendTag(uint32_t kind);
+    void FlushRepeats();
+
+private:
+    std::vector<uint8_t> m_Data;
+    TetrisRules m_Rules;
+    uint8_t m_nHeld;
+    uint8_t m_nPressed;             // by the last update
+    int32_t m_nTicks;
+    uint64_t m_nIdleUpdates;
+    uint64_t m_nRepeatUpdates;      // of the last update, not written yet
+    uint64_t m_nUpdates;
+    int32_t m_nKeyframePieces;      // of the last keyframe
+    bool m_bFinished;
+};
+
+
+
+//=======================
+//  Reads a replay, update after update. The replay stays in the memory of
+//  the caller (a file read, or mapped, in memory); the reader is plain data,
+//  so a copy of it is a position in the replay (e.g. next to a saved engine state).
+//=======================
+class TetrisReplayReader
+{
+public:
+    TetrisReplayReader();
+
+    // Reads the header (false if it is not a replay, or of an unknown version)
+    bool Open(const uint8_t* pData, size_t size);
+
+    uint64_t GetSeed() const                    { return m_nSeed; }
+    RandomizerType GetRandomizerType() const    { return m_RandomizerType; }
+    // The rules of the next update
+    const TetrisRules& GetRules() const         { return m_Rules; }
+    // The engine at the start of the game
+    TetrisEngine CreateEngine() const;
+
+    // The next update: false at the end of the replay (or if it is corrupt)
+    bool Next(TetrisInput& input, int32_t& nTicks);
+    // Plays the next update on the engine
+    bool Step(TetrisEngine& engine);
+    // Plays the rest of the replay; true if it ends, and the game ends as it was recorded
+    bool PlayToEnd(TetrisEngine& engine);
+    // Skips the updates up to the next keyframe (without playing them); false if there is none
+    bool SkipToKeyframe();
+    // Skips the rest of the replay (e.g. to read its result); false if it does not end
+    bool SkipToEnd();
+    // Restores the engine to the last keyframe read (false if there is none, or it is not
+    // a valid state: the engine is left unchanged). The engine is one of this replay.
+    bool RestoreKeyframe(TetrisEngine& engine) const;
+
+    int64_t GetUpdateCount() const              { return m_nUpdates; }
+    bool IsEnd() const                          { return m_bEnd; }
+    bool IsCorrupt() const                      { return m_bCorrupt; }
+    // The result recorded at the end (once IsEnd())
+    const TetrisReplayResult& GetResult() const { return m_Result; }
+    bool MatchesResult(const TetrisEngine& engine) const;
+
+private:
+    bool ReadRecord();
+    bool ReadRules(TetrisRules& rules);
+    // Applies the pending record: true if it is an update
+    bool ApplyRecord(TetrisInput& input, int32_t& nTicks);
+
+private:
+    const uint8_t* m_pData;
+    const uint8_t* m_pEnd;
+    uint32_t m_nVersion;
+    uint32_t m_nKindBits;
+    uint64_t m_nSeed;
+    RandomizerType m_RandomizerType;
+    TetrisRules m_StartRules;
+
+    // position
+    TetrisRules m_Rules;
+    uint8_t m_nHeld;
+    uint8_t m_nPressed;             // by the last update
+    int32_t m_nTicks;
+    uint64_t m_nIdleUpdates;        // before the pending record
+    uint64_t m_nRepeatUpdates;      // of the last update
+    bool m_bPending;
+    uint32_t m_nPendingKind;
+    TetrisInput m_PendingInput;
+    int32_t m_nPendingTicks;
+    uint64_t m_nPendingRepeats;
+    TetrisRules m_PendingRules;
+    uint64_t m_nPendingKeyframeUpdates;
+    const uint8_t* m_pPendingKeyframe;
+    size_t m_nPendingKeyframeSize;
+    const uint8_t* m_pKeyframe;     // engine state of the last keyframe
+    size_t m_nKeyframeSize;
+    int64_t m_nUpdates;
+    bool m_bEnd;
+    bool m_bCorrupt;
+    TetrisReplayResult m_Result;
+};
+
+
+
+//=======================
+//  Plays a replay for a viewer: at any speed, and seeking to any piece.
+//  Open() scans the whole replay for its keyframes (without playing it), so a
+//  seek restores the last keyframe before the piece, and plays the updates
+//  from there (those of at most KEYFRAME_PIECES pieces).
+//=======================
+class TetrisReplayPlayer
+{
+public:
+    TetrisReplayPlayer();
+
+    // Reads a replay file (or takes a copy of a replay): false if it is not a replay
+    bool Load(const char* pPath);
+    bool Open(const uint8_t* pData, size_t size);
+    bool IsOpen() const                         { return !m_Data.empty(); }
+
+    const TetrisEngine& GetEngine() const       { return m_Engine; }
+    int64_t GetUpdate() const                   { return m_Reader.GetUpdateCount(); }
+    int64_t GetUpdateCount() const              { return m_nUpdates; }
+    // The current piece (1 for the first one), and the pieces of the whole game
+    int32_t GetPiece() const                    { return m_Engine.GetPieceCount(); }
+    int32_t GetPieceCount() const               { return m_nPieces; }
+    // The replay was played to its end, or it can't be played further (it is corrupt)
+    bool IsEnd() const                          { return m_Reader.IsEnd() || m_Reader.IsCorrupt(); }
+
+    // Plays the next update
+    bool Step();
+    // Plays the updates of this much game time (a frame time, times the speed)
+    void Play(int64_t nTicks);
+    // Goes to where a piece spawned (0: the start of the game)
+    void SeekPiece(int32_t nPiece);
+
+private:
+    struct Keyframe
+    {
+        TetrisReplayReader reader;      // just after the keyframe
+        int32_t nPieces;
+    };
+
+private:
+    std::vector<uint8_t> m_Data;
+    TetrisReplayReader m_Reader;
+    TetrisEngine m_Engine;
+    std::vector<Keyframe> m_Keyframes;
+    int64_t m_nUpdates;
+    int32_t m_nPieces;
+    int64_t m_nTickBudget;          // game time to play (negative: played ahead)
+};
+
+
+#endif // TETRISREPLAY_H
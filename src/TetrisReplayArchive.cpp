@@ -0,0 +1,310 @@
+#include "TetrisReplayArchive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+namespace
+{
+    const uint32_t ARCHIVE_MAGIC = 0x41505254;      // "TRPA"
+    const uint32_t SEGMENT_MAGIC = 0x49505254;      // "TRPI"
+    const uint32_t ARCHIVE_VERSION = 1;
+    const size_t ARCHIVE_ALIGNMENT = 8;
+
+    size_t AlignUp(size_t size)
+    {
+        return (size + ARCHIVE_ALIGNMENT - 1) / ARCHIVE_ALIGNMENT * ARCHIVE_ALIGNMENT;
+    }
+
+    bool SeekFile(FILE* pFile, uint64_t offset)
+    {
+#ifdef _WIN32
+        return _fseeki64(pFile, (__int64)offset, SEEK_SET) == 0;
+#else
+        return fseeko(pFile, (off_t)offset, SEEK_SET) == 0;
+#endif
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  BATCH
+/////////////////////////////////////////////
+
+TetrisReplayBatch::TetrisReplayBatch()
+{
+}
+
+
+bool TetrisReplayBatch::Add(const uint8_t* pReplay, size_t size)
+{
+    // (the index keeps the result, so that it can be queried without reading the replay)
+    TetrisReplayReader reader;
+    if (size > UINT32_MAX || !reader.Open(pReplay, size) || !reader.SkipToEnd())
+        return false;
+    const TetrisReplayResult& result = reader.GetResult();
+    TetrisArchiveEntry entry = {};
+    entry.nSeed = reader.GetSeed();
+    entry.nOffset = m_Data.size();
+    entry.nLength = (uint32_t)size;
+    entry.nScore = result.nScore;
+    entry.nLines = result.nLines;
+    entry.nLevel = result.nLevel;
+    entry.nPieces = result.nPieces;
+    m_Entries.push_back(entry);
+    m_Data.insert(m_Data.end(), pReplay, pReplay + size);
+    m_Data.resize(AlignUp(m_Data.size()), 0);
+    return true;
+}
+
+
+void TetrisReplayBatch::Clear()
+{
+    m_Data.clear();
+    m_Entries.clear();
+}
+
+
+
+/////////////////////////////////////////////
+//  WRITER
+/////////////////////////////////////////////
+
+TetrisReplayArchiveWriter::TetrisReplayArchiveWriter()
+: m_pFile(nullptr)
+, m_Header()
+, m_nNextTicket(0)
+, m_nCommitTicket(0)
+, m_bFailed(false)
+{
+}
+
+
+TetrisReplayArchiveWriter::~TetrisReplayArchiveWriter()
+{
+    Close();
+}
+
+
+bool TetrisReplayArchiveWriter::Open(const char* pPath)
+{
+    Close();
+    m_pFile = fopen(pPath, "r+b");
+    if (m_pFile != nullptr)
+    {
+        // append after the last commit (over what a commit cut short may have left)
+        bool bOk = fread(&m_Header, sizeof(m_Header), 1, m_pFile) == 1 && m_Header.nMagic == ARCHIVE_MAGIC
+            && m_Header.nVersion == ARCHIVE_VERSION && m_Header.nCommittedSize >= sizeof(m_Header);
+        if (!bOk)
+            Close();
+        return bOk;
+    }
+
+    m_pFile = fopen(pPath, "w+b");
+    if (m_pFile == nullptr)
+        return false;
+    memset(&m_Header, 0, sizeof(m_Header));
+    m_Header.nMagic = ARCHIVE_MAGIC;
+    m_Header.nVersion = ARCHIVE_VERSION;
+    m_Header.nCommittedSize = sizeof(m_Header);
+    if (!WriteAt(0, &m_Header, sizeof(m_Header)) || !Sync()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+
+void TetrisReplayArchiveWriter::Close()
+{
+    if (m_pFile != nullptr)
+        fclose(m_pFile);
+    m_pFile = nullptr;
+    m_nNextTicket = m_nCommitTicket = 0;
+    m_bFailed = false;
+}
+
+
+uint64_t TetrisReplayArchiveWriter::TakeTicket()
+{
+    lock_guard<mutex> lock(m_Mutex);
+    return m_nNextTicket++;
+}
+
+
+bool TetrisReplayArchiveWriter::Commit(TetrisReplayBatch& batch, uint64_t nTicket)
+{
+    unique_lock<mutex> lock(m_Mutex);
+    m_TurnChanged.wait(lock, [&]() { return m_nCommitTicket == nTicket; });
+    // (after a failure, the next batches are not written: the header may be out of date)
+    bool bOk = m_pFile != nullptr && !m_bFailed && WriteCommit(batch);
+    m_bFailed = !bOk;
+    m_nCommitTicket++;
+    lock.unlock();
+    m_TurnChanged.notify_all();
+    batch.Clear();
+    return bOk;
+}
+
+
+uint64_t TetrisReplayArchiveWriter::GetGameCount() const
+{
+    lock_guard<mutex> lock(m_Mutex);
+    return m_Header.nCntGames;
+}
+
+
+bool TetrisReplayArchiveWriter::WriteCommit(TetrisReplayBatch& batch)
+{
+    uint32_t cntGames = (uint32_t)batch.m_Entries.size();
+    if (cntGames == 0)
+        return true;
+
+    // the replays, then the index segment (with the offsets in the file)
+    uint64_t base = m_Header.nCommittedSize;
+    for (uint32_t i = 0; i < cntGames; i++) {
+        batch.m_Entries[i].nGameId = m_Header.nCntGames + i;
+        batch.m_Entries[i].nOffset += base;
+    }
+    TetrisArchiveSegment segment = { SEGMENT_MAGIC, cntGames, m_Header.nLastSegment };
+    uint64_t segmentOffset = base + batch.m_Data.size();
+    if (!WriteAt(base, batch.m_Data.data(), batch.m_Data.size())
+        || fwrite(&segment, sizeof(segment), 1, m_pFile) != 1
+        || fwrite(batch.m_Entries.data(), sizeof(TetrisArchiveEntry), cntGames, m_pFile) != cntGames
+        || !Sync())
+        return false;
+
+    // publish the commit, once it is on the disk
+    TetrisArchiveHeader header = m_Header;
+    header.nCntGames += cntGames;
+    header.nLastSegment = segmentOffset;
+    header.nCommittedSize = segmentOffset + sizeof(segment) + (uint64_t)cntGames * sizeof(TetrisArchiveEntry);
+    if (!WriteAt(0, &header, sizeof(header)) || !Sync())
+        return false;
+    m_Header = header;
+    return true;
+}
+
+
+bool TetrisReplayArchiveWriter::WriteAt(uint64_t offset, const void* pData, size_t size)
+{
+    return SeekFile(m_pFile, offset) && fwrite(pData, 1, size, m_pFile) == size;
+}
+
+
+bool TetrisReplayArchiveWriter::Sync()
+{
+    if (fflush(m_pFile) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(m_pFile)) == 0;
+#else
+    return fsync(fileno(m_pFile)) == 0;
+#endif
+}
+
+
+
+/////////////////////////////////////////////
+//  READER
+/////////////////////////////////////////////
+
+TetrisReplayArchive::TetrisReplayArchive()
+: m_nCntGames(0)
+{
+}
+
+
+bool TetrisReplayArchive::Open(const char* pPath)
+{
+    Close();
+    if (!m_Memory.Open(pPath, true) || m_Memory.GetSize() < sizeof(TetrisArchiveHeader)) {
+        Close();
+        return false;
+    }
+    const uint8_t* pData = m_Memory.GetData();
+    TetrisArchiveHeader header;
+    memcpy(&header, pData, sizeof(header));
+    if (header.nMagic != ARCHIVE_MAGIC || header.nVersion != ARCHIVE_VERSION
+        || header.nCommittedSize < sizeof(header) || header.nCommittedSize > m_Memory.GetSize()) {
+        Close();
+        return false;
+    }
+
+    // the index segments, from the last commit back to the first one
+    uint64_t cntGames = 0;
+    uint64_t limit = header.nCommittedSize;
+    for (uint64_t offset = header.nLastSegment; offset != 0; )
+    {
+        const TetrisArchiveSegment* pSegment = reinterpret_cast<const TetrisArchiveSegment*>(pData + offset);
+        if (offset % ARCHIVE_ALIGNMENT != 0 || offset < sizeof(header) || offset + sizeof(TetrisArchiveSegment) > limit
+            || pSegment->nMagic != SEGMENT_MAGIC
+            || offset + sizeof(TetrisArchiveSegment) + (uint64_t)pSegment->nCntGames * sizeof(TetrisArchiveEntry) > limit) {
+            Close();
+            return false;
+        }
+        m_Segments.push_back({ reinterpret_cast<const TetrisArchiveEntry*>(pSegment + 1), pSegment->nCntGames, 0 });
+        cntGames += pSegment->nCntGames;
+        // (the replays of the segment are before it, and the segment before them)
+        limit = offset;
+        offset = pSegment->nPrevSegment;
+    }
+    reverse(m_Segments.begin(), m_Segments.end());
+
+    uint64_t firstGame = 0;
+    for (Segment& segment : m_Segments)
+    {
+        segment.nFirstGame = firstGame;
+        for (uint64_t i = 0; i < segment.nCntGames; i++) {
+            const TetrisArchiveEntry& entry = segment.pEntries[i];
+            if (entry.nGameId != firstGame + i || entry.nOffset < sizeof(header) || entry.nOffset > header.nCommittedSize
+                || entry.nLength > header.nCommittedSize - entry.nOffset) {
+                Close();
+                return false;
+            }
+        }
+        firstGame += segment.nCntGames;
+    }
+    if (cntGames != header.nCntGames) {
+        Close();
+        return false;
+    }
+    m_nCntGames = cntGames;
+    return true;
+}
+
+
+void TetrisReplayArchive::Close()
+{
+    m_Memory.Close();
+    m_Segments.clear();
+    m_nCntGames = 0;
+}
+
+
+const TetrisArchiveEntry& TetrisReplayArchive::GetEntry(uint64_t idx) const
+{
+    // the last segment which starts at (or before) the game
+    auto it = upper_bound(m_Segments.begin(), m_Segments.end(), idx,
+                          [](uint64_t game, const Segment& s) { return game < s.nFirstGame; });
+    --it;
+    return it->pEntries[idx - it->nFirstGame];
+}
+
+
+bool TetrisReplayArchive::OpenReplay(uint64_t idx, TetrisReplayReader& reader) const
+{
+    if (idx >= m_nCntGames)
+        return false;
+    const TetrisArchiveEntry& entry = GetEntry(idx);
+    return reader.Open(GetReplay(entry), entry.nLength);
+}
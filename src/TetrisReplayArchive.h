@@ -0,0 +1,170 @@
+#ifndef TETRISREPLAYARCHIVE_H
+#define TETRISREPLAYARCHIVE_H
+
+#include "TetrisReplay.h"
+#include "TetrisShmRing.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+
+//=======================
+//  Replay archive: many finished games (TetrisReplay) in one append-only
+//  file, instead of one file per game.
+//
+//  Layout (little endian, every part 8-byte aligned):
+//    the header (64 bytes), then the commits, each: the replays packed one
+//    after the other, then an index segment (a segment header and one entry
+//    per game of the commit, linked to the segment of the commit before)
+//  The header is rewritten after each commit (once the commit is flushed to
+//  the disk): it is the only part which is ever overwritten, and a commit cut
+//  short (e.g. by a crash) is not part of the archive.
+//  Readers map the file, and read the replays and the index in place.
+//=======================
+struct TetrisArchiveHeader
+{
+    uint32_t nMagic;
+    uint32_t nVersion;
+    uint64_t nCntGames;
+    uint64_t nLastSegment;      // offset of the index segment of the last commit (0: none)
+    uint64_t nCommittedSize;    // size of the archive, up to the end of the last commit
+    uint8_t reserved[32];
+};
+
+struct TetrisArchiveSegment
+{
+    uint32_t nMagic;
+    uint32_t nCntGames;
+    uint64_t nPrevSegment;      // (0: the first commit)
+};
+
+// A game of the archive: the result as it was recorded, and where its replay is
+struct TetrisArchiveEntry
+{
+    uint64_t nGameId;           // order of the game in the archive (0, 1, 2, ...)
+    uint64_t nSeed;
+    uint64_t nOffset;           // of the replay, from the start of the file
+    uint32_t nLength;
+    int32_t nScore;
+    int32_t nLines;
+    int32_t nLevel;
+    int32_t nPieces;
+    uint32_t nReserved;
+};
+
+static_assert(sizeof(TetrisArchiveHeader) == 64, "the archive header is 64 bytes");
+static_assert(sizeof(TetrisArchiveSegment) == 16, "the index segment header is 16 bytes");
+static_assert(sizeof(TetrisArchiveEntry) == 48, "the index entries are 48 bytes");
+
+
+
+//=======================
+//  Games of one batch worker, gathered without any lock, then committed
+//  to the archive as a whole
+//=======================
+class TetrisReplayBatch
+{
+public:
+    TetrisReplayBatch();
+
+    // Adds a finished replay (false if it is not one: it has no result)
+    bool Add(const uint8_t* pReplay, size_t size);
+    bool Add(const TetrisReplayRecorder& recorder)  { return Add(recorder.GetData().data(), recorder.GetData().size()); }
+    void Clear();
+
+    size_t GetGameCount() const         { return m_Entries.size(); }
+    size_t GetDataSize() const          { return m_Data.size(); }
+
+private:
+    friend class TetrisReplayArchiveWriter;
+
+    std::vector<uint8_t> m_Data;                // the replays, 8-byte aligned
+    std::vector<TetrisArchiveEntry> m_Entries;  // (offsets in m_Data, until the commit)
+};
+
+
+
+//=======================
+//  Appends to an archive (creating it if needed). Batches are committed one
+//  at a time, in the order of their tickets: with a ticket taken for each
+//  batch in a fixed order (e.g. the batch numbers), the archive is the same
+//  however the workers are scheduled. One writer per archive file.
+//=======================
+class TetrisReplayArchiveWriter
+{
+public:
+    TetrisReplayArchiveWriter();
+    ~TetrisReplayArchiveWriter();
+    TetrisReplayArchiveWriter(const TetrisReplayArchiveWriter&) = delete;
+    TetrisReplayArchiveWriter& operator= (const TetrisReplayArchiveWriter&) = delete;
+
+    bool Open(const char* pPath);
+    void Close();
+    bool IsOpen() const                 { return m_pFile != nullptr; }
+
+    // The place of a batch in the archive: every ticket must be committed (an empty batch is fine)
+    uint64_t TakeTicket();
+    // Waits for the batches of the tickets before this one, then writes the batch, flushes it to
+    // the disk and publishes it (thread-safe); the batch is cleared. False if it could not be written
+    bool Commit(TetrisReplayBatch& batch, uint64_t nTicket);
+    bool Commit(TetrisReplayBatch& batch)   { return Commit(batch, TakeTicket()); }
+
+    uint64_t GetGameCount() const;
+
+private:
+    bool WriteCommit(TetrisReplayBatch& batch);
+    bool WriteAt(uint64_t offset, const void* pData, size_t size);
+    bool Sync();
+
+private:
+    FILE* m_pFile;
+    TetrisArchiveHeader m_Header;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_TurnChanged;
+    uint64_t m_nNextTicket;
+    uint64_t m_nCommitTicket;       // the ticket whose turn it is
+    bool m_bFailed;
+};
+
+
+
+//=======================
+//  Reads an archive, mapped in memory (read-only): the index and the replays
+//  are read in place, without any copy or system call per game. Any number
+//  of threads can read it at the same time. It shows the archive as it was
+//  when it was opened (Open() it again to see the commits since).
+//=======================
+class TetrisReplayArchive
+{
+public:
+    TetrisReplayArchive();
+
+    bool Open(const char* pPath);
+    void Close();
+
+    uint64_t GetGameCount() const                   { return m_nCntGames; }
+    const TetrisArchiveEntry& GetEntry(uint64_t idx) const;
+    const uint8_t* GetReplay(const TetrisArchiveEntry& entry) const   { return m_Memory.GetData() + entry.nOffset; }
+    // A reader of a game's replay (false if it is not a replay)
+    bool OpenReplay(uint64_t idx, TetrisReplayReader& reader) const;
+
+private:
+    struct Segment
+    {
+        const TetrisArchiveEntry* pEntries;
+        uint64_t nCntGames;
+        uint64_t nFirstGame;
+    };
+
+private:
+    TetrisSharedMemory m_Memory;
+    std::vector<Segment> m_Segments;    // in the order of the games
+    uint64_t m_nCntGames;
+};
+
+
+#endif // TETRISREPLAYARCHIVE_H
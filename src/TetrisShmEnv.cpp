@@ -0,0 +1,262 @@
+#include "TetrisShmEnv.h"
+
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+
+namespace
+{
+    // spins before each yield, while waiting for the other side
+    const int32_t WAIT_SPINS = 64;
+
+    uint32_t Align64(size_t size)
+    {
+        return (uint32_t)((size + 63) / 64 * 64);
+    }
+
+    // An array of this size, at this offset, is within the limit
+    bool Fits(uint64_t offset, uint64_t size, uint64_t limit)
+    {
+        return offset <= limit && size <= limit - offset;
+    }
+
+    uint64_t NewSessionId()
+    {
+        random_device device;
+        uint64_t id = (((uint64_t)device() << 32) | device()) ^ (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+        return (id != 0) ? id : 1;
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  CHANNEL
+/////////////////////////////////////////////
+
+TetrisShmEnvChannel::TetrisShmEnvChannel()
+: m_pHeader(nullptr)
+{
+}
+
+
+TetrisShmEnvChannel::~TetrisShmEnvChannel()
+{
+    // (the other side, if it still maps the file, sees that the channel is closed)
+    if (!m_Path.empty()) {
+        Close();
+        m_Memory.Unlink(m_Path.c_str());
+    }
+}
+
+
+bool TetrisShmEnvChannel::Create(const char* pPath, int32_t cntEnvs, int32_t cntBatches)
+{
+    if (cntEnvs <= 0 || cntBatches <= 0)
+        return false;
+
+    // observation slot
+    uint32_t offset = Align64(sizeof(TetrisShmSlotHeader));
+    uint32_t boardsOffset = offset;
+    offset += Align64((size_t)cntEnvs * VecTetrisEnv::CNT_BOARD_PLANES * TABLE_HEIGHT_TILES * sizeof(uint16_t));
+    uint32_t piecesOffset = offset;
+    offset += Align64((size_t)cntEnvs * VecTetrisEnv::CNT_OBS_PIECES);
+    uint32_t statsOffset = offset;
+    offset += Align64((size_t)cntEnvs * VecTetrisEnv::CNT_STATS * sizeof(int32_t));
+    uint32_t rewardsOffset = offset;
+    offset += Align64((size_t)cntEnvs * sizeof(float));
+    uint32_t donesOffset = offset;
+    uint32_t obsSlotSize = offset + Align64(cntEnvs);
+    // action slot
+    uint32_t actionsOffset = Align64(sizeof(TetrisShmSlotHeader));
+    uint32_t actionSlotSize = actionsOffset + Align64(cntEnvs);
+
+    size_t obsRingOffset = Align64(sizeof(TetrisShmEnvHeader));
+    size_t actionRingOffset = obsRingOffset + Align64(TetrisSpscRing::GetMemorySize(obsSlotSize, cntBatches));
+    size_t totalSize = actionRingOffset + TetrisSpscRing::GetMemorySize(actionSlotSize, cntBatches);
+    if (!m_Memory.Create(pPath, totalSize))
+        return false;
+
+    uint8_t* pData = m_Memory.GetData();
+    m_pHeader = new (pData) TetrisShmEnvHeader();
+    memcpy(m_pHeader->magic, "TSHE", 4);
+    m_pHeader->nVersion = VERSION;
+    m_pHeader->nCntEnvs = (uint32_t)cntEnvs;
+    m_pHeader->nCntBatches = (uint32_t)cntBatches;
+    m_pHeader->nBoardsOffset = boardsOffset;
+    m_pHeader->nPiecesOffset = piecesOffset;
+    m_pHeader->nStatsOffset = statsOffset;
+    m_pHeader->nRewardsOffset = rewardsOffset;
+    m_pHeader->nDonesOffset = donesOffset;
+    m_pHeader->nActionsOffset = actionsOffset;
+    m_pHeader->nObsRingOffset = obsRingOffset;
+    m_pHeader->nActionRingOffset = actionRingOffset;
+    m_pHeader->nSessionId = NewSessionId();
+    m_pHeader->nClosed.store(0, memory_order_relaxed);
+    TetrisSpscRing::Format(pData + obsRingOffset, obsSlotSize, cntBatches);
+    TetrisSpscRing::Format(pData + actionRingOffset, actionSlotSize, cntBatches);
+    m_Observations.Attach(pData + obsRingOffset, actionRingOffset - obsRingOffset);
+    m_Actions.Attach(pData + actionRingOffset, totalSize - actionRingOffset);
+    m_pHeader->nReady.store(1, memory_order_release);
+    m_Path = pPath;
+    return true;
+}
+
+
+bool TetrisShmEnvChannel::Open(const char* pPath)
+{
+    if (!m_Memory.Open(pPath) || m_Memory.GetSize() < sizeof(TetrisShmEnvHeader))
+        return false;
+    uint8_t* pData = m_Memory.GetData();
+    size_t size = m_Memory.GetSize();
+    TetrisShmEnvHeader* pHeader = reinterpret_cast<TetrisShmEnvHeader*>(pData);
+    // (a closed channel is left by a run which is over: the next run creates a new one)
+    if (pHeader->nReady.load(memory_order_acquire) == 0 || pHeader->nClosed.load(memory_order_acquire) != 0
+        || memcmp(pHeader->magic, "TSHE", 4) != 0 || pHeader->nVersion != VERSION
+        || pHeader->nCntEnvs == 0 || pHeader->nCntBatches == 0
+        || pHeader->nObsRingOffset < sizeof(TetrisShmEnvHeader) || pHeader->nObsRingOffset % 64 != 0
+        || pHeader->nActionRingOffset < pHeader->nObsRingOffset || pHeader->nActionRingOffset % 64 != 0
+        || pHeader->nActionRingOffset > size
+        // (each ring within its part of the file, and the arrays within their slots)
+        || !m_Observations.Attach(pData + pHeader->nObsRingOffset, (size_t)(pHeader->nActionRingOffset - pHeader->nObsRingOffset))
+        || !m_Actions.Attach(pData + pHeader->nActionRingOffset, (size_t)(size - pHeader->nActionRingOffset))
+        || !AreSlotsValid(*pHeader)) {
+        m_Memory.Close();
+        return false;
+    }
+    m_pHeader = pHeader;
+    return true;
+}
+
+
+bool TetrisShmEnvChannel::AreSlotsValid(const TetrisShmEnvHeader& header) const
+{
+    uint64_t cntEnvs = header.nCntEnvs;
+    uint64_t obsSlotSize = m_Observations.GetSlotSize();
+    uint64_t actionSlotSize = m_Actions.GetSlotSize();
+    const uint32_t offsets[] = { header.nBoardsOffset, header.nPiecesOffset, header.nStatsOffset,
+                                 header.nRewardsOffset, header.nDonesOffset, header.nActionsOffset };
+    for (uint32_t offset : offsets) {
+        if (offset < sizeof(TetrisShmSlotHeader) || offset % 64 != 0)
+            return false;
+    }
+    return Fits(header.nBoardsOffset, cntEnvs * VecTetrisEnv::CNT_BOARD_PLANES * TABLE_HEIGHT_TILES * sizeof(uint16_t), obsSlotSize)
+        && Fits(header.nPiecesOffset, cntEnvs * VecTetrisEnv::CNT_OBS_PIECES, obsSlotSize)
+        && Fits(header.nStatsOffset, cntEnvs * VecTetrisEnv::CNT_STATS * sizeof(int32_t), obsSlotSize)
+        && Fits(header.nRewardsOffset, cntEnvs * sizeof(float), obsSlotSize)
+        && Fits(header.nDonesOffset, cntEnvs, obsSlotSize)
+        && Fits(header.nActionsOffset, cntEnvs, actionSlotSize);
+}
+
+
+VecTetrisBuffers TetrisShmEnvChannel::GetObsBuffers(uint8_t* pSlot) const
+{
+    VecTetrisBuffers buffers;
+    buffers.pBoards = reinterpret_cast<uint16_t*>(pSlot + m_pHeader->nBoardsOffset);
+    buffers.pPieces = reinterpret_cast<int8_t*>(pSlot + m_pHeader->nPiecesOffset);
+    buffers.pStats = reinterpret_cast<int32_t*>(pSlot + m_pHeader->nStatsOffset);
+    buffers.pRewards = reinterpret_cast<float*>(pSlot + m_pHeader->nRewardsOffset);
+    buffers.pDones = pSlot + m_pHeader->nDonesOffset;
+    return buffers;
+}
+
+
+uint8_t* TetrisShmEnvChannel::WaitWrite(TetrisSpscRing& ring) const
+{
+    for (int32_t spin = 1; !IsClosed(); spin++)
+    {
+        uint8_t* pSlot = ring.BeginWrite();
+        if (pSlot != nullptr)
+            return pSlot;
+        if (spin % WAIT_SPINS == 0)
+            this_thread::yield();
+    }
+    return nullptr;
+}
+
+
+const uint8_t* TetrisShmEnvChannel::WaitRead(TetrisSpscRing& ring) const
+{
+    for (int32_t spin = 1; !IsClosed(); spin++)
+    {
+        const uint8_t* pSlot = ring.BeginRead();
+        if (pSlot != nullptr)
+            return pSlot;
+        if (spin % WAIT_SPINS == 0)
+            this_thread::yield();
+    }
+    return nullptr;
+}
+
+
+
+/////////////////////////////////////////////
+//  SERVER
+/////////////////////////////////////////////
+
+TetrisShmEnvServer::TetrisShmEnvServer(TetrisShmEnvChannel& channel, const TetrisRules& rules, uint64_t seed,
+                                       const TetrisRandomizer* pRandomizer, TetrisThreadPool* pPool)
+: m_Channel(channel)
+, m_Steps(channel.GetHeader().nCntBatches, 0)
+{
+    // (the batches play different games: their seeds are far apart)
+    int32_t cntEnvs = (int32_t)channel.GetHeader().nCntEnvs;
+    for (size_t b = 0; b < m_Steps.size(); b++) {
+        m_Batches.emplace_back(new VecTetrisEnv(cntEnvs, rules, seed + b * 0x9E3779B97F4A7C15ull, pRandomizer, pPool));
+    }
+}
+
+
+int64_t TetrisShmEnvServer::Run(int64_t maxSteps)
+{
+    TetrisSpscRing& observations = m_Channel.GetObservations();
+    TetrisSpscRing& actions = m_Channel.GetActions();
+    int32_t cntEnvs = (int32_t)m_Channel.GetHeader().nCntEnvs;
+
+    // the first observations (there is a slot for each batch)
+    for (size_t b = 0; b < m_Batches.size(); b++)
+    {
+        uint8_t* pSlot = m_Channel.WaitWrite(observations);
+        if (pSlot == nullptr)
+            return 0;
+        TetrisShmSlotHeader* pHeader = reinterpret_cast<TetrisShmSlotHeader*>(pSlot);
+        pHeader->nBatch = (uint32_t)b;
+        pHeader->nStep = 0;
+        VecTetrisBuffers buffers = m_Channel.GetObsBuffers(pSlot);
+        m_Batches[b]->Reset(buffers);
+        memset(buffers.pRewards, 0, cntEnvs * sizeof(float));
+        memset(buffers.pDones, 0, cntEnvs);
+        observations.EndWrite();
+    }
+
+    // then a step for each action slot, written straight into the next observation slot
+    int64_t cntSteps = 0;
+    const uint32_t actionsOffset = m_Channel.GetHeader().nActionsOffset;
+    while (maxSteps <= 0 || cntSteps < maxSteps)
+    {
+        const uint8_t* pActionSlot = m_Channel.WaitRead(actions);
+        if (pActionSlot == nullptr)
+            break;
+        uint32_t batch = reinterpret_cast<const TetrisShmSlotHeader*>(pActionSlot)->nBatch;
+        if (batch >= m_Batches.size()) {
+            actions.EndRead();
+            continue;
+        }
+        uint8_t* pSlot = m_Channel.WaitWrite(observations);
+        if (pSlot == nullptr)
+            break;
+        TetrisShmSlotHeader* pHeader = reinterpret_cast<TetrisShmSlotHeader*>(pSlot);
+        pHeader->nBatch = batch;
+        pHeader->nStep = ++m_Steps[batch];
+        m_Batches[batch]->Step(pActionSlot + actionsOffset, m_Channel.GetObsBuffers(pSlot));
+        observations.EndWrite();
+        actions.EndRead();
+        cntSteps++;
+    }
+    return cntSteps;
+}
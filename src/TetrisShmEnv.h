@@ -0,0 +1,136 @@
+#ifndef TETRISSHMENV_H
+#define TETRISSHMENV_H
+
+#include "TetrisEngine.h"
+#include "TetrisRandom.h"
+#include "TetrisShmRing.h"
+#include "TetrisThreadPool.h"
+#include "VecTetrisEnv.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+//=======================
+//  Shared memory channel between headless games and a trainer in another
+//  process (which maps the same file, e.g. in /dev/shm, and reads it in
+//  place - e.g. as numpy arrays).
+//  The games run in batches of environments (VecTetrisEnv). Each
+//  observation slot holds one step of one batch; the trainer answers each of
+//  them with an action slot for the same batch, and the batch steps again.
+//  With several batches, the games of one batch step while the trainer
+//  works on the others.
+//
+//  Layout (little endian, all offsets multiples of 64 bytes):
+//    TetrisShmEnvHeader, at 0
+//    ring of observation slots, at nObsRingOffset (TetrisSpscRing, nCntBatches slots)
+//    ring of action slots, at nActionRingOffset (TetrisSpscRing, nCntBatches slots)
+//  observation slot: TetrisShmSlotHeader, then the arrays of VecTetrisBuffers at
+//    the offsets of the header (boards, pieces, stats, rewards, dones)
+//  action slot: TetrisShmSlotHeader, then uint8 actions[nCntEnvs] at nActionsOffset
+//  Each run of the games creates a new file (a trainer which maps the file of a
+//  previous run keeps it, unchanged), and removes it when it is over. On Windows,
+//  the trainer must open the file with FILE_SHARE_DELETE (as TetrisSharedMemory
+//  does), or the next run can't replace it while it is mapped. The session id
+//  tells the channels created at the same path apart (e.g. for a trainer to see
+//  that the games were restarted).
+//=======================
+struct TetrisShmEnvHeader
+{
+    char magic[4];                      // "TSHE"
+    uint32_t nVersion;
+    uint32_t nCntEnvs;                  // environments per batch
+    uint32_t nCntBatches;
+    // in an observation slot
+    uint32_t nBoardsOffset;
+    uint32_t nPiecesOffset;
+    uint32_t nStatsOffset;
+    uint32_t nRewardsOffset;
+    uint32_t nDonesOffset;
+    // in an action slot
+    uint32_t nActionsOffset;
+    uint64_t nObsRingOffset;
+    uint64_t nActionRingOffset;
+    uint64_t nSessionId;                // a new one for each channel created (never 0)
+    alignas(64) std::atomic<uint32_t> nReady;       // set once the channel is set up
+    std::atomic<uint32_t> nClosed;                  // set by either side, to stop
+};
+
+struct TetrisShmSlotHeader
+{
+    uint32_t nBatch;
+    uint32_t nReserved;
+    uint64_t nStep;                     // steps of the batch (0: the first observation)
+};
+
+
+
+class TetrisShmEnvChannel
+{
+public:
+    static const uint32_t VERSION = 2;
+
+public:
+    TetrisShmEnvChannel();
+    // (the side which created the channel closes it, and removes its file)
+    ~TetrisShmEnvChannel();
+    TetrisShmEnvChannel(const TetrisShmEnvChannel&) = delete;
+    TetrisShmEnvChannel& operator= (const TetrisShmEnvChannel&) = delete;
+
+    // Creates the channel in a new file (the side running the games)
+    bool Create(const char* pPath, int32_t cntEnvs, int32_t cntBatches);
+    // Opens the channel created by the other side (false if it is not set up yet, or already closed)
+    bool Open(const char* pPath);
+
+    const TetrisShmEnvHeader& GetHeader() const     { return *m_pHeader; }
+    TetrisSpscRing& GetObservations()               { return m_Observations; }
+    TetrisSpscRing& GetActions()                    { return m_Actions; }
+    // The arrays of an observation slot
+    VecTetrisBuffers GetObsBuffers(uint8_t* pSlot) const;
+
+    bool IsClosed() const   { return m_pHeader->nClosed.load(std::memory_order_acquire) != 0; }
+    void Close()            { m_pHeader->nClosed.store(1, std::memory_order_release); }
+
+    // Waits for a slot of the ring (spinning, then yielding); nullptr once the channel is closed
+    uint8_t* WaitWrite(TetrisSpscRing& ring) const;
+    const uint8_t* WaitRead(TetrisSpscRing& ring) const;
+
+private:
+    // The arrays of the header are within the slots of the rings
+    bool AreSlotsValid(const TetrisShmEnvHeader& header) const;
+
+private:
+    TetrisSharedMemory m_Memory;
+    TetrisShmEnvHeader* m_pHeader;
+    TetrisSpscRing m_Observations;
+    TetrisSpscRing m_Actions;
+    std::string m_Path;             // of the file created (empty: opened)
+};
+
+
+
+//=======================
+//  The side running the games (headless): publishes the observations of the
+//  batches, then steps each batch with the actions which come back for it
+//=======================
+class TetrisShmEnvServer
+{
+public:
+    TetrisShmEnvServer(TetrisShmEnvChannel& channel, const TetrisRules& rules, uint64_t seed,
+                       const TetrisRandomizer* pRandomizer = nullptr, TetrisThreadPool* pPool = nullptr);
+
+    // Runs until the channel is closed, or after maxSteps batch steps (0 = no limit);
+    // returns the batch steps
+    int64_t Run(int64_t maxSteps);
+
+private:
+    TetrisShmEnvChannel& m_Channel;
+    std::vector<std::unique_ptr<VecTetrisEnv>> m_Batches;
+    std::vector<uint64_t> m_Steps;
+};
+
+
+#endif // TETRISSHMENV_H
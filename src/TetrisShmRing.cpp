@@ -0,0 +1,294 @@
+#include "TetrisShmRing.h"
+
+#include <cstring>
+#include <new>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+/////////////////////////////////////////////
+//  SHARED MEMORY
+/////////////////////////////////////////////
+
+TetrisSharedMemory::TetrisSharedMemory()
+: m_pData(nullptr)
+, m_nSize(0)
+#ifdef _WIN32
+, m_hFile(INVALID_HANDLE_VALUE)
+, m_hMapping(nullptr)
+#else
+, m_nFile(-1)
+#endif
+{
+}
+
+
+TetrisSharedMemory::~TetrisSharedMemory()
+{
+    Close();
+}
+
+
+bool TetrisSharedMemory::Create(const char* pPath, size_t size)
+{
+    return size > 0 && Map(pPath, size, true, false);
+}
+
+
+bool TetrisSharedMemory::Open(const char* pPath, bool bReadOnly)
+{
+    return Map(pPath, 0, false, bReadOnly);
+}
+
+
+#ifdef _WIN32
+
+namespace
+{
+    // (every handle shares the deletion: a file which is mapped can be renamed and deleted)
+    const DWORD SHARE_ALL = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+
+    // Removes the file at the path: a deleted file keeps its name until the last process which
+    // maps it closes it, so it is first renamed to a name of its own, which frees the path
+    void RemoveFile(const char* pPath)
+    {
+        static atomic<uint32_t> s_nCntRemoved(0);
+        string tempPath = string(pPath) + "." + to_string(GetCurrentProcessId()) + "." + to_string(s_nCntRemoved++) + ".old";
+        if (MoveFileExA(pPath, tempPath.c_str(), 0))
+            DeleteFileA(tempPath.c_str());
+        else
+            DeleteFileA(pPath);
+    }
+}
+
+
+bool TetrisSharedMemory::Map(const char* pPath, size_t size, bool bCreate, bool bReadOnly)
+{
+    Close();
+    // (a new file: one which another process still maps is not overwritten, it keeps it as it is)
+    if (bCreate)
+        RemoveFile(pPath);
+    // (a temporary file: it stays in the file cache, as long as there is memory)
+    m_hFile = CreateFileA(pPath, bReadOnly ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE), SHARE_ALL, nullptr,
+                          bCreate ? CREATE_NEW : OPEN_EXISTING, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return false;
+    if (!bCreate)
+    {
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart == 0) {
+            Close();
+            return false;
+        }
+        size = (size_t)fileSize.QuadPart;
+    }
+    m_hMapping = CreateFileMappingA(m_hFile, nullptr, bReadOnly ? PAGE_READONLY : PAGE_READWRITE,
+                                    (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), nullptr);
+    if (m_hMapping == nullptr) {
+        Close();
+        return false;
+    }
+    m_pData = (uint8_t*)MapViewOfFile(m_hMapping, bReadOnly ? FILE_MAP_READ : FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (m_pData == nullptr) {
+        Close();
+        return false;
+    }
+    m_nSize = size;
+    return true;
+}
+
+
+void TetrisSharedMemory::Close()
+{
+    if (m_pData != nullptr)
+        UnmapViewOfFile(m_pData);
+    if (m_hMapping != nullptr)
+        CloseHandle(m_hMapping);
+    if (m_hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(m_hFile);
+    m_pData = nullptr;
+    m_nSize = 0;
+    m_hMapping = nullptr;
+    m_hFile = INVALID_HANDLE_VALUE;
+}
+
+
+void TetrisSharedMemory::Unlink(const char* pPath)
+{
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return;
+    // (the file at the path must be this one: its volume and index are the same)
+    HANDLE hPathFile = CreateFileA(pPath, 0, SHARE_ALL, nullptr, OPEN_EXISTING, 0, nullptr);
+    if (hPathFile == INVALID_HANDLE_VALUE)
+        return;
+    BY_HANDLE_FILE_INFORMATION fileInfo, pathInfo;
+    bool bSameFile = GetFileInformationByHandle((HANDLE)m_hFile, &fileInfo) && GetFileInformationByHandle(hPathFile, &pathInfo)
+                     && fileInfo.dwVolumeSerialNumber == pathInfo.dwVolumeSerialNumber
+                     && fileInfo.nFileIndexHigh == pathInfo.nFileIndexHigh && fileInfo.nFileIndexLow == pathInfo.nFileIndexLow;
+    CloseHandle(hPathFile);
+    if (bSameFile)
+        RemoveFile(pPath);
+}
+
+#else
+
+bool TetrisSharedMemory::Map(const char* pPath, size_t size, bool bCreate, bool bReadOnly)
+{
+    Close();
+    // (a new file: truncating the one at the path would crash the processes which map it, with SIGBUS)
+    if (bCreate)
+        unlink(pPath);
+    m_nFile = open(pPath, bCreate ? (O_RDWR | O_CREAT | O_EXCL) : (bReadOnly ? O_RDONLY : O_RDWR), 0600);
+    if (m_nFile < 0)
+        return false;
+    if (bCreate)
+    {
+        if (ftruncate(m_nFile, (off_t)size) != 0) {
+            Close();
+            return false;
+        }
+    }
+    else
+    {
+        struct stat fileStat;
+        if (fstat(m_nFile, &fileStat) != 0 || fileStat.st_size == 0) {
+            Close();
+            return false;
+        }
+        size = (size_t)fileStat.st_size;
+    }
+    void* pData = mmap(nullptr, size, bReadOnly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, m_nFile, 0);
+    if (pData == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    m_pData = (uint8_t*)pData;
+    m_nSize = size;
+    return true;
+}
+
+
+void TetrisSharedMemory::Close()
+{
+    if (m_pData != nullptr)
+        munmap(m_pData, m_nSize);
+    if (m_nFile >= 0)
+        close(m_nFile);
+    m_pData = nullptr;
+    m_nSize = 0;
+    m_nFile = -1;
+}
+
+
+void TetrisSharedMemory::Unlink(const char* pPath)
+{
+    struct stat fileStat, pathStat;
+    if (m_nFile >= 0 && fstat(m_nFile, &fileStat) == 0 && stat(pPath, &pathStat) == 0
+        && fileStat.st_dev == pathStat.st_dev && fileStat.st_ino == pathStat.st_ino)
+        unlink(pPath);
+}
+
+#endif
+
+
+
+/////////////////////////////////////////////
+//  SPSC RING
+/////////////////////////////////////////////
+
+TetrisSpscRing::TetrisSpscRing()
+: m_pHeader(nullptr)
+, m_pSlots(nullptr)
+, m_nWriteIdx(0)
+, m_nCachedReadIdx(0)
+, m_nReadIdx(0)
+, m_nCachedWriteIdx(0)
+{
+}
+
+
+size_t TetrisSpscRing::GetMemorySize(uint32_t slotSize, uint32_t cntSlots)
+{
+    size_t alignedSlot = (slotSize + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+    return sizeof(Header) + alignedSlot * cntSlots;
+}
+
+
+void TetrisSpscRing::Format(void* pMemory, uint32_t slotSize, uint32_t cntSlots)
+{
+    Header* pHeader = new (pMemory) Header();
+    pHeader->nSlotSize = (slotSize + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+    pHeader->nCntSlots = (cntSlots > 0) ? cntSlots : 1;
+    pHeader->nReserved = 0;
+    pHeader->nWriteIdx.store(0, memory_order_relaxed);
+    pHeader->nReadIdx.store(0, memory_order_relaxed);
+    memset(reinterpret_cast<uint8_t*>(pHeader + 1), 0, (size_t)pHeader->nSlotSize * pHeader->nCntSlots);
+    // (the magic last: a ring is valid once it is set)
+    atomic_thread_fence(memory_order_release);
+    pHeader->nMagic = RING_MAGIC;
+}
+
+
+bool TetrisSpscRing::Attach(void* pMemory, size_t size)
+{
+    Header* pHeader = static_cast<Header*>(pMemory);
+    if (size < sizeof(Header) || pHeader->nMagic != RING_MAGIC || pHeader->nCntSlots == 0
+        || pHeader->nSlotSize % SLOT_ALIGNMENT != 0
+        || (uint64_t)pHeader->nSlotSize * pHeader->nCntSlots > size - sizeof(Header))
+        return false;
+    atomic_thread_fence(memory_order_acquire);
+    m_pHeader = pHeader;
+    m_pSlots = reinterpret_cast<uint8_t*>(pHeader + 1);
+    m_nWriteIdx = m_nCachedWriteIdx = pHeader->nWriteIdx.load(memory_order_acquire);
+    m_nReadIdx = m_nCachedReadIdx = pHeader->nReadIdx.load(memory_order_acquire);
+    return true;
+}
+
+
+uint8_t* TetrisSpscRing::BeginWrite()
+{
+    if (m_nWriteIdx - m_nCachedReadIdx >= m_pHeader->nCntSlots)
+    {
+        m_nCachedReadIdx = m_pHeader->nReadIdx.load(memory_order_acquire);
+        if (m_nWriteIdx - m_nCachedReadIdx >= m_pHeader->nCntSlots)
+            return nullptr;
+    }
+    return GetSlot(m_nWriteIdx);
+}
+
+
+void TetrisSpscRing::EndWrite()
+{
+    m_pHeader->nWriteIdx.store(++m_nWriteIdx, memory_order_release);
+}
+
+
+const uint8_t* TetrisSpscRing::BeginRead()
+{
+    if (m_nReadIdx == m_nCachedWriteIdx)
+    {
+        m_nCachedWriteIdx = m_pHeader->nWriteIdx.load(memory_order_acquire);
+        if (m_nReadIdx == m_nCachedWriteIdx)
+            return nullptr;
+    }
+    return GetSlot(m_nReadIdx);
+}
+
+
+void TetrisSpscRing::EndRead()
+{
+    m_pHeader->nReadIdx.store(++m_nReadIdx, memory_order_release);
+}
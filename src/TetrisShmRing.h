@@ -0,0 +1,117 @@
+#ifndef TETRISSHMRING_H
+#define TETRISSHMRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+
+//=======================
+//  Shared memory: a file mapped in memory, which other processes can map
+//  too (on Linux, a file in /dev/shm stays in memory). POSIX mmap, or a
+//  Win32 file mapping.
+//=======================
+class TetrisSharedMemory
+{
+public:
+    TetrisSharedMemory();
+    ~TetrisSharedMemory();
+    TetrisSharedMemory(const TetrisSharedMemory&) = delete;
+    TetrisSharedMemory& operator= (const TetrisSharedMemory&) = delete;
+
+    // Creates a new file with this size, filled with zeros, and maps it. A file which was at the
+    // path is removed first, not truncated: the processes which still map it keep it as it is
+    // (on Windows, only if they opened it with FILE_SHARE_DELETE, as Open does: else this fails)
+    bool Create(const char* pPath, size_t size);
+    // Maps all of an existing file (read-only: the data must not be written)
+    bool Open(const char* pPath, bool bReadOnly = false);
+    void Close();
+    // Removes the file from its path (it stays mapped until it is closed), unless another file
+    // has been created there since
+    void Unlink(const char* pPath);
+
+    uint8_t* GetData() const    { return m_pData; }
+    size_t GetSize() const      { return m_nSize; }
+
+private:
+    bool Map(const char* pPath, size_t size, bool bCreate, bool bReadOnly);
+
+private:
+    uint8_t* m_pData;
+    size_t m_nSize;
+#ifdef _WIN32
+    void* m_hFile;
+    void* m_hMapping;
+#else
+    int m_nFile;
+#endif
+};
+
+
+
+//=======================
+//  Lock-free single producer / single consumer ring of fixed size slots,
+//  in memory shared by two processes (or threads).
+//  The producer fills the slot at the write index then publishes it (release
+//  store of the index), the consumer reads the slot at the read index then
+//  gives it back (release store of its index). Each side keeps the last
+//  index it read from the other side, and reads it again (one cache miss)
+//  only when the ring looks full, or empty. The two indices are on their own
+//  cache lines. The slots are read and written in place: no copy.
+//=======================
+class TetrisSpscRing
+{
+public:
+    static const uint32_t SLOT_ALIGNMENT = 64;
+
+    // Layout in memory (the header, then the slots)
+    struct Header
+    {
+        uint32_t nMagic;
+        uint32_t nSlotSize;         // (a multiple of SLOT_ALIGNMENT)
+        uint32_t nCntSlots;
+        uint32_t nReserved;
+        alignas(64) std::atomic<uint64_t> nWriteIdx;    // slots published by the producer
+        alignas(64) std::atomic<uint64_t> nReadIdx;     // slots given back by the consumer
+    };
+
+public:
+    TetrisSpscRing();
+
+    // Memory needed by a ring (from an address aligned to 64 bytes)
+    static size_t GetMemorySize(uint32_t slotSize, uint32_t cntSlots);
+    // Sets up a ring in this memory (once, by the process which creates it)
+    static void Format(void* pMemory, uint32_t slotSize, uint32_t cntSlots);
+    // Uses the ring in this memory, of this size (false if it is not a ring, or does not fit in it)
+    bool Attach(void* pMemory, size_t size);
+
+    uint32_t GetSlotSize() const    { return m_pHeader->nSlotSize; }
+    uint32_t GetSlotCount() const   { return m_pHeader->nCntSlots; }
+
+    // Producer: the slot to fill (nullptr if the ring is full), then publishes it
+    uint8_t* BeginWrite();
+    void EndWrite();
+    // Consumer: the next published slot (nullptr if the ring is empty), then gives it back
+    const uint8_t* BeginRead();
+    void EndRead();
+
+private:
+    static const uint32_t RING_MAGIC = 0x474E4952;     // "RING"
+
+    uint8_t* GetSlot(uint64_t idx) const
+    {
+        return m_pSlots + (size_t)(idx % m_pHeader->nCntSlots) * m_pHeader->nSlotSize;
+    }
+
+private:
+    Header* m_pHeader;
+    uint8_t* m_pSlots;
+    // (each side only uses its own)
+    uint64_t m_nWriteIdx, m_nCachedReadIdx;
+    uint64_t m_nReadIdx, m_nCachedWriteIdx;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the ring indices must be lock-free atomics (shared between processes)");
+
+
+#endif // TETRISSHMRING_H
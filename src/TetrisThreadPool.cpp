@@ -0,0 +1,245 @@
+#include "TetrisThreadPool.h"
+
+#include <chrono>
+
+using namespace std;
+
+
+namespace
+{
+    // the pool + worker index of the current thread
+    thread_local const TetrisThreadPool* currentPool = nullptr;
+    thread_local int32_t currentWorkerIdx = -1;
+    // time spent in Wait() by the task running on the current thread (it is not busy time)
+    thread_local int64_t waitMicros = 0;
+
+    // a thread which is not a worker spins that long in Wait(), before sleeping
+    const int64_t WAIT_SPIN_MICROS = 2000;
+
+    int64_t MicrosSince(chrono::steady_clock::time_point start)
+    {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    }
+}
+
+
+
+/////////////////////////////////////////////
+//  TASK DEQUE
+/////////////////////////////////////////////
+
+void TetrisThreadPool::TaskDeque::PushBack(QueuedTask&& task)
+{
+    if (m_nCount == m_Tasks.size())
+    {
+        // full: move the tasks to a bigger buffer, in order
+        vector<QueuedTask> tasks(m_Tasks.empty() ? 64 : 2 * m_Tasks.size());
+        for (size_t i = 0; i < m_nCount; i++) {
+            tasks[i] = move(m_Tasks[(m_nHead + i) % m_Tasks.size()]);
+        }
+        m_Tasks.swap(tasks);
+        m_nHead = 0;
+    }
+    m_Tasks[(m_nHead + m_nCount) % m_Tasks.size()] = move(task);
+    m_nCount++;
+}
+
+
+void TetrisThreadPool::TaskDeque::PopBack(QueuedTask& task)
+{
+    m_nCount--;
+    task = move(m_Tasks[(m_nHead + m_nCount) % m_Tasks.size()]);
+}
+
+
+void TetrisThreadPool::TaskDeque::PopFront(QueuedTask& task)
+{
+    task = move(m_Tasks[m_nHead]);
+    m_nHead = (m_nHead + 1) % m_Tasks.size();
+    m_nCount--;
+}
+
+
+
+/////////////////////////////////////////////
+//  THREAD POOL
+/////////////////////////////////////////////
+
+
+
+TetrisThreadPool::TetrisThreadPool(int32_t cntThreads)
+: m_nQueued(0)
+, m_nNextWorker(0)
+, m_bStop(false)
+{
+    if (cntThreads <= 0)
+        cntThreads = (int32_t)thread::hardware_concurrency();
+    if (cntThreads <= 0)
+        cntThreads = 1;
+
+    // create all the workers first: they steal from each other as soon as they start
+    for (int32_t i = 0; i < cntThreads; i++)
+    {
+        Worker* pWorker = new Worker();
+        pWorker->nTasks = 0;
+        pWorker->nSteals = 0;
+        pWorker->nBusyMicros = 0;
+        m_Workers.push_back(pWorker);
+    }
+    for (int32_t i = 0; i < cntThreads; i++) {
+        m_Workers[i]->thread = thread(&TetrisThreadPool::WorkerLoop, this, i);
+    }
+}
+
+
+TetrisThreadPool::~TetrisThreadPool()
+{
+    {
+        lock_guard<mutex> lock(m_WakeMutex);
+        m_bStop = true;
+    }
+    m_WakeCondition.notify_all();
+    // (the other workers may still steal from a worker which has finished)
+    for (Worker* pWorker : m_Workers) {
+        pWorker->thread.join();
+    }
+    for (Worker* pWorker : m_Workers) {
+        delete pWorker;
+    }
+}
+
+
+void TetrisThreadPool::Submit(Task task, TetrisTaskGroup* pGroup)
+{
+    if (pGroup != nullptr)
+        pGroup->nPending++;
+
+    // own deque for a worker, round-robin for the other threads
+    int32_t workerIdx = GetCurrentWorker();
+    if (workerIdx < 0)
+        workerIdx = (int32_t)(m_nNextWorker++ % m_Workers.size());
+    Worker& worker = *m_Workers[workerIdx];
+    {
+        lock_guard<mutex> lock(worker.mutex);
+        worker.tasks.PushBack(QueuedTask{ move(task), pGroup });
+    }
+    m_nQueued++;
+
+    // wake up a sleeping worker (taking the mutex, so that the wake-up can't be missed)
+    {
+        lock_guard<mutex> lock(m_WakeMutex);
+    }
+    m_WakeCondition.notify_one();
+}
+
+
+void TetrisThreadPool::Wait(TetrisTaskGroup& group)
+{
+    int32_t workerIdx = GetCurrentWorker();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    while (group.nPending > 0)
+    {
+        // keep working while waiting (the sub-tasks of a worker are probably on its own deque)
+        QueuedTask task;
+        if (FindTask(workerIdx, task)) {
+            RunTask(workerIdx, task);
+        }
+        else if (workerIdx >= 0 || MicrosSince(start) < WAIT_SPIN_MICROS) {
+            this_thread::yield();
+        }
+        else {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    waitMicros += MicrosSince(start);
+}
+
+
+TetrisThreadPool::WorkerStats TetrisThreadPool::GetWorkerStats(int32_t workerIdx) const
+{
+    const Worker& worker = *m_Workers[workerIdx];
+    WorkerStats stats;
+    stats.nTasks = worker.nTasks;
+    stats.nSteals = worker.nSteals;
+    stats.nBusyMicros = worker.nBusyMicros;
+    return stats;
+}
+
+
+int32_t TetrisThreadPool::GetCurrentWorker() const
+{
+    return (currentPool == this) ? currentWorkerIdx : -1;
+}
+
+
+void TetrisThreadPool::WorkerLoop(int32_t workerIdx)
+{
+    currentPool = this;
+    currentWorkerIdx = workerIdx;
+
+    for (;;)
+    {
+        QueuedTask task;
+        if (FindTask(workerIdx, task)) {
+            RunTask(workerIdx, task);
+            continue;
+        }
+        // nothing to do => sleep until there are new tasks (or the pool is destroyed)
+        unique_lock<mutex> lock(m_WakeMutex);
+        if (m_bStop && m_nQueued == 0)
+            break;
+        m_WakeCondition.wait(lock, [this] { return m_bStop || m_nQueued > 0; });
+    }
+}
+
+
+bool TetrisThreadPool::FindTask(int32_t workerIdx, QueuedTask& task)
+{
+    // newest task of its own deque
+    if (workerIdx >= 0)
+    {
+        Worker& worker = *m_Workers[workerIdx];
+        lock_guard<mutex> lock(worker.mutex);
+        if (!worker.tasks.IsEmpty()) {
+            worker.tasks.PopBack(task);
+            m_nQueued--;
+            return true;
+        }
+    }
+
+    // oldest task of another worker (any worker, for a thread which is not a worker)
+    int32_t cntWorkers = (int32_t)m_Workers.size();
+    int32_t cntVictims = (workerIdx >= 0) ? cntWorkers - 1 : cntWorkers;
+    for (int32_t i = 0; i < cntVictims; i++)
+    {
+        Worker& victim = *m_Workers[(workerIdx + 1 + i) % cntWorkers];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.tasks.IsEmpty()) {
+            victim.tasks.PopFront(task);
+            m_nQueued--;
+            if (workerIdx >= 0)
+                m_Workers[workerIdx]->nSteals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void TetrisThreadPool::RunTask(int32_t workerIdx, QueuedTask& task)
+{
+    // (tasks run inside Wait() count for themselves, so a waiting task is not busy)
+    int64_t outerWaitMicros = waitMicros;
+    waitMicros = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    task.task();
+    if (workerIdx >= 0) {
+        Worker& worker = *m_Workers[workerIdx];
+        worker.nBusyMicros += MicrosSince(start) - waitMicros;
+        worker.nTasks++;
+    }
+    waitMicros = outerWaitMicros;
+
+    if (task.pGroup != nullptr)
+        task.pGroup->nPending--;
+}
@@ -0,0 +1,119 @@
+#ifndef TETRISTHREADPOOL_H
+#define TETRISTHREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//=======================
+//  Group of tasks which can be waited for (e.g. the sub-tasks of a task)
+//=======================
+struct TetrisTaskGroup
+{
+    std::atomic<int32_t> nPending;
+
+    TetrisTaskGroup() : nPending(0) {}
+};
+
+
+
+//=======================
+//  Work-stealing thread pool
+//  Each worker has its own deque of tasks: it pushes and pops its tasks at
+//  the back (newest first, while they are still in cache), and when it runs
+//  out of tasks it steals the oldest task (the biggest piece of work) from
+//  the front of another worker's deque.
+//  A task may submit sub-tasks and wait for them: while waiting, its thread
+//  keeps running tasks, so the cores do not idle and waits cannot deadlock.
+//  Another thread waiting for a group (e.g. the frame loop) steals tasks too.
+//  Submitting a task does not allocate in steady state, if the task fits in
+//  the small buffer of std::function (e.g. a lambda capturing two pointers).
+//=======================
+class TetrisThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    // Per worker statistics
+    struct WorkerStats
+    {
+        uint64_t nTasks;        // tasks run
+        uint64_t nSteals;       // tasks stolen from other workers
+        int64_t nBusyMicros;    // time spent running tasks
+    };
+
+public:
+    explicit TetrisThreadPool(int32_t cntThreads = 0);      // 0 => one per core
+    ~TetrisThreadPool();
+
+    int32_t GetThreadCount() const    { return (int32_t)m_Workers.size(); }
+
+    // From a worker: onto its own deque; from another thread: spread over the workers
+    void Submit(Task task, TetrisTaskGroup* pGroup = nullptr);
+    // Runs tasks until all the tasks of the group are done (from any thread)
+    void Wait(TetrisTaskGroup& group);
+
+    WorkerStats GetWorkerStats(int32_t workerIdx) const;
+    // Index of the worker running the current thread (-1 if not a worker of this pool)
+    int32_t GetCurrentWorker() const;
+
+
+private:
+    struct QueuedTask
+    {
+        Task task;
+        TetrisTaskGroup* pGroup;
+    };
+
+    // Deque of tasks, on a ring buffer (it allocates only when it grows)
+    class TaskDeque
+    {
+    public:
+        TaskDeque() : m_nHead(0), m_nCount(0) {}
+
+        bool IsEmpty() const    { return m_nCount == 0; }
+        void PushBack(QueuedTask&& task);
+        void PopBack(QueuedTask& task);
+        void PopFront(QueuedTask& task);
+
+    private:
+        std::vector<QueuedTask> m_Tasks;
+        size_t m_nHead;
+        size_t m_nCount;
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        TaskDeque tasks;
+        std::thread thread;
+        std::atomic<uint64_t> nTasks;
+        std::atomic<uint64_t> nSteals;
+        std::atomic<int64_t> nBusyMicros;
+        // (allocated one by one: the padding keeps the next worker off these cache lines)
+        char padding[64];
+    };
+
+    void WorkerLoop(int32_t workerIdx);
+    // (workerIdx is -1 for a thread which is not a worker)
+    bool FindTask(int32_t workerIdx, QueuedTask& task);
+    void RunTask(int32_t workerIdx, QueuedTask& task);
+
+private:
+    std::vector<Worker*> m_Workers;
+    std::atomic<int32_t> m_nQueued;
+    std::atomic<uint32_t> m_nNextWorker;
+
+    // sleeping workers wait for new tasks
+    std::mutex m_WakeMutex;
+    std::condition_variable m_WakeCondition;
+    bool m_bStop;
+};
+
+
+#endif // TETRISTHREADPOOL_H
@@ -0,0 +1,110 @@
+#include "TetrisTransTable.h"
+
+#include <cstring>
+
+using namespace std;
+
+
+namespace
+{
+    // data layout: score (bits 0-31), depth (32-39), generation (40-47), valid (63)
+    const uint64_t DATA_VALID = (uint64_t)1 << 63;
+    const int32_t DEPTH_SHIFT = 32;
+    const int32_t GENERATION_SHIFT = 40;
+
+    const uintptr_t CACHE_LINE_BYTES = 64;
+
+    // an entry of an older search is worth as much as one this many plies shallower, per search
+    const int32_t AGE_PENALTY = 8;
+}
+
+
+
+TetrisTransTable::TetrisTransTable(int32_t sizeLog2)
+: m_pEntries(nullptr)
+, m_nClusterMask(0)
+, m_nGeneration(0)
+{
+    int32_t clusterLog2 = (sizeLog2 > 2) ? sizeLog2 - 2 : 0;
+    uint64_t cntClusters = (uint64_t)1 << clusterLog2;
+    m_nClusterMask = cntClusters - 1;
+
+    // (extra entries, to align the clusters on a cache line)
+    const size_t cntExtra = CACHE_LINE_BYTES / sizeof(Entry);
+    m_pBuffer.reset(new Entry[cntClusters * CLUSTER_ENTRIES + cntExtra]);
+    uintptr_t address = reinterpret_cast<uintptr_t>(m_pBuffer.get());
+    uintptr_t aligned = (address + CACHE_LINE_BYTES - 1) & ~(CACHE_LINE_BYTES - 1);
+    m_pEntries = m_pBuffer.get() + (aligned - address) / sizeof(Entry);
+    Clear();
+}
+
+
+void TetrisTransTable::Clear()
+{
+    int64_t cntEntries = GetEntryCount();
+    for (int64_t i = 0; i < cntEntries; i++) {
+        m_pEntries[i].nCheck.store(0, memory_order_relaxed);
+        m_pEntries[i].nData.store(0, memory_order_relaxed);
+    }
+    m_nGeneration = 0;
+}
+
+
+uint64_t TetrisTransTable::PackData(float score, int32_t depth, uint8_t generation)
+{
+    uint32_t scoreBits;
+    memcpy(&scoreBits, &score, sizeof(scoreBits));
+    depth = (depth < 0) ? 0 : (depth > MAX_DEPTH) ? MAX_DEPTH : depth;
+    return DATA_VALID | scoreBits | ((uint64_t)depth << DEPTH_SHIFT) | ((uint64_t)generation << GENERATION_SHIFT);
+}
+
+
+bool TetrisTransTable::Probe(uint64_t hash, float& score, int32_t& depth) const
+{
+    const Entry* pCluster = GetCluster(hash);
+    for (int32_t i = 0; i < CLUSTER_ENTRIES; i++)
+    {
+        uint64_t data = pCluster[i].nData.load(memory_order_relaxed);
+        uint64_t check = pCluster[i].nCheck.load(memory_order_relaxed);
+        if ((data & DATA_VALID) != 0 && (check ^ data) == hash)
+        {
+            uint32_t scoreBits = (uint32_t)data;
+            memcpy(&score, &scoreBits, sizeof(score));
+            depth = (int32_t)((data >> DEPTH_SHIFT) & 0xFF);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void TetrisTransTable::Store(uint64_t hash, float score, int32_t depth)
+{
+    Entry* pCluster = GetCluster(hash);
+    Entry* pReplace = nullptr;
+    int32_t replaceWorth = INT32_MAX;
+    for (int32_t i = 0; i < CLUSTER_ENTRIES; i++)
+    {
+        uint64_t data = pCluster[i].nData.load(memory_order_relaxed);
+        uint64_t check = pCluster[i].nCheck.load(memory_order_relaxed);
+        if ((data & DATA_VALID) == 0) {
+            // empty: nothing to lose (but keep looking, the position may be there already)
+            if (replaceWorth > INT32_MIN)
+                pReplace = &pCluster[i], replaceWorth = INT32_MIN;
+            continue;
+        }
+        if ((check ^ data) == hash) {
+            // same position: refresh it
+            pReplace = &pCluster[i];
+            break;
+        }
+        int32_t age = (uint8_t)(m_nGeneration - (uint8_t)(data >> GENERATION_SHIFT));
+        int32_t worth = (int32_t)((data >> DEPTH_SHIFT) & 0xFF) - AGE_PENALTY * age;
+        if (worth < replaceWorth)
+            pReplace = &pCluster[i], replaceWorth = worth;
+    }
+
+    uint64_t data = PackData(score, depth, m_nGeneration);
+    pReplace->nData.store(data, memory_order_relaxed);
+    pReplace->nCheck.store(hash ^ data, memory_order_relaxed);
+}
@@ -0,0 +1,58 @@
+#ifndef TETRISTRANSTABLE_H
+#define TETRISTRANSTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+
+//=======================
+//  Transposition table: remembers the score of the positions already seen
+//  (keyed by their Zobrist hash), so that a search does not score twice a
+//  position reached through another order of moves, or by a previous search.
+//  - fixed size, allocated once: storing never allocates
+//  - lock-free: each entry is two atomic words, the data and hash ^ data; a
+//    read mixing two writes does not match its hash, so it is just a miss
+//  - replacement: the entries come in clusters of 4 (one cache line); a new
+//    position replaces the entry of the cluster that is the least worth
+//    keeping: empty, then from an older search, then the shallowest
+//=======================
+class TetrisTransTable
+{
+public:
+    static const int32_t CLUSTER_ENTRIES = 4;
+    static const int32_t MAX_DEPTH = 255;
+
+public:
+    explicit TetrisTransTable(int32_t sizeLog2 = 16);      // 2^sizeLog2 entries (16 bytes each)
+
+    int64_t GetEntryCount() const   { return (int64_t)(m_nClusterMask + 1) * CLUSTER_ENTRIES; }
+
+    void Clear();
+    // Starts a new search: the entries of the previous searches get older (and are replaced first)
+    void NewSearch()                { m_nGeneration = (uint8_t)(m_nGeneration + 1); }
+
+    // The depth tells how much the entry is worth keeping (0..MAX_DEPTH, the higher the better)
+    bool Probe(uint64_t hash, float& score, int32_t& depth) const;
+    void Store(uint64_t hash, float score, int32_t depth);
+
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> nCheck;       // hash ^ data
+        std::atomic<uint64_t> nData;        // score, depth, generation, valid flag
+    };
+
+    static uint64_t PackData(float score, int32_t depth, uint8_t generation);
+    Entry* GetCluster(uint64_t hash) const  { return m_pEntries + (hash & m_nClusterMask) * CLUSTER_ENTRIES; }
+
+private:
+    std::unique_ptr<Entry[]> m_pBuffer;
+    Entry* m_pEntries;                      // (the buffer, aligned on a cache line)
+    uint64_t m_nClusterMask;
+    uint8_t m_nGeneration;
+};
+
+
+#endif // TETRISTRANSTABLE_H
@@ -0,0 +1,68 @@
+#ifndef TETRISZOBRIST_H
+#define TETRISZOBRIST_H
+
+#include "TetrisConstants.h"
+
+#include <cstdint>
+
+
+//=======================
+//  Zobrist keys: one random key per board cell, and per piece type in each
+//  piece slot (current, NEXT queue, HOLD). The hash of a state is the XOR of
+//  the keys of what it contains, so it is updated with one XOR when a cell
+//  changes. The keys are generated at compile time, so the hashes are the
+//  same in every build (they can be saved, and compared across machines).
+//=======================
+struct TetrisZobristKeys
+{
+    uint64_t cells[BOARD_ROWS][TABLE_WIDTH_TILES];      // occupied cells (the colors are not hashed)
+    uint64_t currentPiece[CNT_TETRIMINOS];
+    uint64_t nextPieces[CNT_NEXT_PIECES][CNT_TETRIMINOS];
+    uint64_t heldPiece[CNT_TETRIMINOS];
+    uint64_t holdUsed;                                  // HOLD was used during the current piece
+};
+
+
+namespace TetrisZobrist
+{
+    // splitmix64 finalizer (also hashes small values, e.g. a packed piece placement)
+    constexpr uint64_t Mix(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // splitmix64 sequence
+    constexpr uint64_t NextKey(uint64_t& state)
+    {
+        state += 0x9E3779B97F4A7C15ull;
+        return Mix(state);
+    }
+
+    constexpr TetrisZobristKeys MakeKeys()
+    {
+        TetrisZobristKeys keys = {};
+        uint64_t state = 0x5A0B1C7E7E7215ull;
+        for (int32_t y = 0; y < BOARD_ROWS; y++) {
+            for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+                keys.cells[y][x] = NextKey(state);
+            }
+        }
+        for (int32_t type = 0; type < CNT_TETRIMINOS; type++) {
+            keys.currentPiece[type] = NextKey(state);
+            for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+                keys.nextPieces[i][type] = NextKey(state);
+            }
+            keys.heldPiece[type] = NextKey(state);
+        }
+        keys.holdUsed = NextKey(state);
+        return keys;
+    }
+}
+
+
+constexpr TetrisZobristKeys ZOBRIST_KEYS = TetrisZobrist::MakeKeys();
+
+
+#endif // TETRISZOBRIST_H
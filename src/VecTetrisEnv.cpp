@@ -0,0 +1,132 @@
+#include "VecTetrisEnv.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+
+
+VecTetrisEnv::VecTetrisEnv(int32_t cntEnvs, const TetrisRules& rules, uint64_t seed,
+                           const TetrisRandomizer* pRandomizer, TetrisThreadPool* pPool, int32_t stepTicks)
+: m_Rules(rules)
+, m_pRandomizer(pRandomizer)
+, m_pPool(pPool)
+, m_nSeed(seed)
+, m_nStepTicks(max(stepTicks, 1))
+, m_Episodes(max(cntEnvs, 1), 0)
+, m_EpisodeSteps(max(cntEnvs, 1), 0)
+, m_pActions(nullptr)
+, m_Out()
+{
+    m_Engines.reserve(m_Episodes.size());
+    for (size_t i = 0; i < m_Episodes.size(); i++) {
+        m_Engines.emplace_back(m_Rules, m_nSeed + i, m_pRandomizer);
+    }
+}
+
+
+void VecTetrisEnv::Reset(const VecTetrisBuffers& out)
+{
+    for (int32_t i = 0; i < GetCount(); i++)
+    {
+        ResetEnv(i);
+        WriteObservation(i, out);
+    }
+}
+
+
+void VecTetrisEnv::Step(const uint8_t* pActions, const VecTetrisBuffers& out)
+{
+    m_pActions = pActions;
+    m_Out = out;
+    int32_t cntChunks = (GetCount() + CHUNK_ENVS - 1) / CHUNK_ENVS;
+    if (m_pPool == nullptr || cntChunks == 1)
+    {
+        for (int32_t c = 0; c < cntChunks; c++) {
+            StepChunk(c);
+        }
+    }
+    else
+    {
+        // (the calling thread steps chunks too, while it waits)
+        TetrisTaskGroup group;
+        for (int32_t c = 0; c < cntChunks; c++) {
+            m_pPool->Submit([this, c]() { StepChunk(c); }, &group);
+        }
+        m_pPool->Wait(group);
+    }
+}
+
+
+void VecTetrisEnv::ResetEnv(int32_t idx)
+{
+    uint64_t seed = m_nSeed + (uint64_t)idx + (uint64_t)m_Episodes[idx] * m_Engines.size();
+    m_Episodes[idx]++;
+    m_EpisodeSteps[idx] = 0;
+    if (m_Episodes[idx] > 1) {
+        m_Engines[idx] = TetrisEngine(m_Rules, seed, m_pRandomizer);
+    }
+}
+
+
+void VecTetrisEnv::StepChunk(int32_t chunkIdx)
+{
+    int32_t first = chunkIdx * CHUNK_ENVS;
+    int32_t last = min(first + CHUNK_ENVS, GetCount());
+    for (int32_t i = first; i < last; i++)
+    {
+        TetrisEngine& engine = m_Engines[i];
+        TetrisInput input;
+        input.nPressed = input.nHeld = (uint8_t)(m_pActions[i] & (CNT_ACTION_MASKS - 1));
+
+        int32_t score = engine.GetScore();
+        engine.UpdateGame(input, m_nStepTicks);
+        m_EpisodeSteps[i]++;
+        m_Out.pRewards[i] = (float)(engine.GetScore() - score);
+        m_Out.pDones[i] = engine.IsGameOver() ? 1 : 0;
+        if (engine.IsGameOver())
+            ResetEnv(i);
+        WriteObservation(i, m_Out);
+    }
+}
+
+
+void VecTetrisEnv::WriteObservation(int32_t idx, const VecTetrisBuffers& out) const
+{
+    const TetrisEngine& engine = m_Engines[idx];
+
+    // board planes: the locked tiles, and the falling piece (its visible tiles)
+    uint16_t* pPlanes = out.pBoards + (size_t)idx * CNT_BOARD_PLANES * TABLE_HEIGHT_TILES;
+    const TetrisBoard& board = engine.GetBoard();
+    for (int32_t y = 0; y < TABLE_HEIGHT_TILES; y++) {
+        pPlanes[PLANE_LOCKED * TABLE_HEIGHT_TILES + y] = board.GetRowMask(y);
+    }
+    uint16_t* pPiecePlane = pPlanes + PLANE_PIECE * TABLE_HEIGHT_TILES;
+    memset(pPiecePlane, 0, TABLE_HEIGHT_TILES * sizeof(uint16_t));
+    bool bHasPiece = !engine.IsSpawnPending() && !engine.IsGameOver();
+    if (bHasPiece)
+    {
+        const Tetrimino& piece = engine.GetCurrentPiece();
+        for (int8_t t = 0; t < 4; t++)
+        {
+            int32_t x = piece.getX(t), y = piece.getY(t);
+            if (y >= 0 && y < TABLE_HEIGHT_TILES && x >= 0 && x < TABLE_WIDTH_TILES)
+                pPiecePlane[y] |= (uint16_t)(1 << x);
+        }
+    }
+
+    int8_t* pPieces = out.pPieces + (size_t)idx * CNT_OBS_PIECES;
+    pPieces[0] = bHasPiece ? engine.GetCurrentPiece().getTypeIndex() : -1;
+    for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+        pPieces[1 + i] = engine.GetNextPiece(i).getTypeIndex();
+    }
+    pPieces[1 + CNT_NEXT_PIECES] = engine.IsPieceHeld() ? engine.GetHeldPiece().getTypeIndex() : -1;
+
+    int32_t* pStats = out.pStats + (size_t)idx * CNT_STATS;
+    pStats[STAT_SCORE] = engine.GetScore();
+    pStats[STAT_LINES] = engine.GetLines();
+    pStats[STAT_LEVEL] = engine.GetLevel();
+    pStats[STAT_EPISODE_STEPS] = m_EpisodeSteps[idx];
+    pStats[STAT_HOLD_ALLOWED] = engine.IsHoldAllowed() ? 1 : 0;
+}
@@ -0,0 +1,98 @@
+#ifndef VECTETRISENV_H
+#define VECTETRISENV_H
+
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisRandom.h"
+#include "TetrisThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+
+//=======================
+//  Buffers of the caller, for the observations and rewards of all the
+//  environments (contiguous arrays, environment after environment)
+//=======================
+struct VecTetrisBuffers
+{
+    uint16_t* pBoards;      // [envs][CNT_BOARD_PLANES][TABLE_HEIGHT_TILES] row masks (bit x = column x), top row first
+    int8_t* pPieces;        // [envs][CNT_OBS_PIECES] piece types: current (-1 if none), the NEXT queue, HOLD (-1 if empty)
+    int32_t* pStats;        // [envs][CNT_STATS]
+    float* pRewards;        // [envs] (written by Step() only)
+    uint8_t* pDones;        // [envs] (written by Step() only)
+};
+
+
+
+//=======================
+//  Vectorized environment (as the vector environments of gym): N games,
+//  stepped all at once, for reinforcement learning.
+//  An action is the bit mask of the TetrisActions pressed during the step
+//  (one frame: they are held down for the step, then released). The reward
+//  is the score gained during the step. A game over ends the episode: the
+//  environment starts the next one at once (its observation is the start of
+//  the new game) and reports it in pDones.
+//  The engines are kept in one array, and their bookkeeping in parallel
+//  arrays; nothing is allocated after the construction. With a thread pool,
+//  the environments are stepped in chunks on the workers; the results do not
+//  depend on it (episode k of environment i is seeded with seed + i + k * N).
+//=======================
+class VecTetrisEnv
+{
+public:
+    enum { PLANE_LOCKED, PLANE_PIECE, CNT_BOARD_PLANES };
+    static const int32_t CNT_OBS_PIECES = 1 + CNT_NEXT_PIECES + 1;
+    enum {
+        STAT_SCORE,
+        STAT_LINES,
+        STAT_LEVEL,
+        STAT_EPISODE_STEPS,
+        STAT_HOLD_ALLOWED,
+        CNT_STATS
+    };
+
+    // Action masks: 0 = no action, 1 << ACTION_xxx for a single action
+    static const int32_t CNT_ACTION_MASKS = 1 << CNT_ACTIONS;
+    static const int32_t DEFAULT_STEP_TICKS = 16;
+
+public:
+    VecTetrisEnv(int32_t cntEnvs, const TetrisRules& rules, uint64_t seed,
+                 const TetrisRandomizer* pRandomizer = nullptr, TetrisThreadPool* pPool = nullptr,
+                 int32_t stepTicks = DEFAULT_STEP_TICKS);
+
+    int32_t GetCount() const                        { return (int32_t)m_Engines.size(); }
+    const TetrisEngine& GetEngine(int32_t idx) const    { return m_Engines[idx]; }
+
+    // Starts new episodes in all the environments, and writes their observations
+    void Reset(const VecTetrisBuffers& out);
+    // Steps all the environments, with one action mask each
+    void Step(const uint8_t* pActions, const VecTetrisBuffers& out);
+
+
+private:
+    // environments per task, with a thread pool
+    static const int32_t CHUNK_ENVS = 64;
+
+    void ResetEnv(int32_t idx);
+    void StepChunk(int32_t chunkIdx);
+    void WriteObservation(int32_t idx, const VecTetrisBuffers& out) const;
+
+private:
+    TetrisRules m_Rules;
+    const TetrisRandomizer* m_pRandomizer;
+    TetrisThreadPool* m_pPool;
+    uint64_t m_nSeed;
+    int32_t m_nStepTicks;
+
+    std::vector<TetrisEngine> m_Engines;
+    std::vector<uint32_t> m_Episodes;           // episodes started by each environment
+    std::vector<int32_t> m_EpisodeSteps;
+
+    // the step in progress
+    const uint8_t* m_pActions;
+    VecTetrisBuffers m_Out;
+};
+
+
+#endif // VECTETRISENV_H
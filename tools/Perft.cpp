@@ -0,0 +1,207 @@
+//=======================
+//  perft: counts the lock placements reachable to depth N (as chess engines do
+//  with moves), for a corpus of reference boards and piece queues.
+//  It checks the counts against the known ones (any difference means that the
+//  rotation/kick tables, the collision checks or the move generator changed)
+//  and reports the move generation speed, single and multi-threaded.
+//
+//  usage: perft [threads]
+//=======================
+#include "TetrisBoard.h"
+#include "TetrisConstants.h"
+#include "TetrisMoveGen.h"
+#include "Tetrimino.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace
+{
+    const int32_t MAX_DEPTH = 3;
+
+    // Reference position: board rows (bottom rows only, '.' = empty), pieces queue,
+    // and the number of placements at depth 1..MAX_DEPTH
+    struct PerftPosition
+    {
+        const char* name;
+        const char* rows[TABLE_HEIGHT_TILES + 1];   // nullptr-terminated
+        const char* queue;
+        uint64_t counts[MAX_DEPTH];
+    };
+
+    const PerftPosition PERFT_CORPUS[] = {
+        { "empty board",
+          { nullptr },
+          "TIL",    { 34, 600, 21397 } },
+        { "jagged stack",
+          { "..X.......",
+            "X.XX...X..",
+            "XXXX.XXXX.",
+            "XXXXX.XXXX",
+            nullptr },
+          "SZO",    { 17, 297, 2786 } },
+        { "T-spin double slot",
+          { "XX........",
+            "X...XXXXXX",
+            "XX.XXXXXXX",
+            nullptr },
+          "TTJ",    { 38, 1423, 51297 } },
+        { "tall well",
+          { "XXXXXXXXX.",
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+            nullptr },
+          "IJL",    { 17, 578, 20328 } },
+        { "overhangs",
+          { "XXX...XXXX",
+            "XX.....XXX",
+            "XX.X.X.XXX",
+            "X..XXX..XX",
+            nullptr },
+          "LJT",    { 37, 1375, 51801 } },
+    };
+    const int32_t CNT_PERFT_POSITIONS = sizeof(PERFT_CORPUS) / sizeof(PERFT_CORPUS[0]);
+
+
+    TetrisBoard MakeBoard(const PerftPosition& pos)
+    {
+        TetrisBoard board;
+        int32_t cntRows = 0;
+        while (pos.rows[cntRows] != nullptr)
+            cntRows++;
+        for (int32_t i = 0; i < cntRows; i++) {
+            int32_t y = TABLE_HEIGHT_TILES - cntRows + i;
+            for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+                if (pos.rows[i][x] != '.')
+                    board.SetTile(x, y, 0);
+            }
+        }
+        return board;
+    }
+
+
+    // Places the piece and removes the full lines (as the engine does when a piece locks)
+    void LockPiece(TetrisBoard& board, const Tetrimino& piece)
+    {
+        board.PlacePiece(piece);
+        int32_t fullLines[TABLE_HEIGHT_TILES];
+        int32_t cntFullLines = board.FindFullLines(fullLines);
+        board.RemoveLines(fullLines, cntFullLines);
+    }
+
+
+    // Counts the placements at the given depth; pGenerated counts all the placements generated
+    uint64_t Perft(TetrisMoveGen& gen, const TetrisBoard& board, const char* queue, int32_t depth, uint64_t* pGenerated)
+    {
+        TetrisMove moves[TetrisMoveGen::MAX_MOVES];
+        Tetrimino piece(Tetrimino::typeIndexFromChar(queue[0]));
+        int32_t cntMoves = gen.Generate(board, piece, moves, TetrisMoveGen::MAX_MOVES);
+        *pGenerated += cntMoves;
+        if (depth <= 1)
+            return cntMoves;
+
+        uint64_t count = 0;
+        for (int32_t i = 0; i < cntMoves; i++) {
+            TetrisBoard child = board;
+            LockPiece(child, Tetrimino(moves[i].placement));
+            count += Perft(gen, child, queue + 1, depth - 1, pGenerated);
+        }
+        return count;
+    }
+
+
+    // Same as Perft(), with the moves of the root split between the threads
+    uint64_t PerftParallel(const TetrisBoard& board, const char* queue, int32_t depth, int32_t cntThreads, uint64_t* pGenerated)
+    {
+        TetrisMoveGen rootGen;
+        TetrisMove moves[TetrisMoveGen::MAX_MOVES];
+        Tetrimino piece(Tetrimino::typeIndexFromChar(queue[0]));
+        int32_t cntMoves = rootGen.Generate(board, piece, moves, TetrisMoveGen::MAX_MOVES);
+        *pGenerated += cntMoves;
+        if (depth <= 1)
+            return cntMoves;
+
+        atomic<int32_t> nextMove(0);
+        atomic<uint64_t> count(0), generated(0);
+        auto worker = [&]() {
+            unique_ptr<TetrisMoveGen> pGen(new TetrisMoveGen());
+            uint64_t myCount = 0, myGenerated = 0;
+            for (int32_t i = nextMove++; i < cntMoves; i = nextMove++) {
+                TetrisBoard child = board;
+                LockPiece(child, Tetrimino(moves[i].placement));
+                myCount += Perft(*pGen, child, queue + 1, depth - 1, &myGenerated);
+            }
+            count += myCount;
+            generated += myGenerated;
+        };
+
+        vector<thread> threads;
+        for (int32_t t = 0; t < cntThreads; t++)
+            threads.emplace_back(worker);
+        for (thread& th : threads)
+            th.join();
+        *pGenerated += generated;
+        return count;
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    int32_t cntThreads = (argc > 1) ? atoi(argv[1]) : (int32_t)thread::hardware_concurrency();
+    cntThreads = (cntThreads > 0) ? cntThreads : 1;
+
+    // 1) correctness: counts at every depth
+    unique_ptr<TetrisMoveGen> pGen(new TetrisMoveGen());
+    int32_t cntFailed = 0;
+    for (int32_t p = 0; p < CNT_PERFT_POSITIONS; p++)
+    {
+        const PerftPosition& pos = PERFT_CORPUS[p];
+        TetrisBoard board = MakeBoard(pos);
+        cout << left << setw(20) << pos.name << " " << pos.queue << ":";
+        for (int32_t depth = 1; depth <= MAX_DEPTH; depth++) {
+            uint64_t generated = 0;
+            uint64_t count = Perft(*pGen, board, pos.queue, depth, &generated);
+            bool ok = (count == pos.counts[depth - 1]);
+            cntFailed += ok ? 0 : 1;
+            cout << "  " << count << (ok ? "" : " (FAILED, expected " + to_string(pos.counts[depth - 1]) + ")");
+        }
+        cout << endl;
+    }
+
+    // 2) speed: generated placements per second, at the full depth
+    using Clock = chrono::steady_clock;
+    for (int32_t threads : { 1, cntThreads })
+    {
+        uint64_t generated = 0;
+        Clock::time_point start = Clock::now();
+        for (int32_t p = 0; p < CNT_PERFT_POSITIONS; p++) {
+            const PerftPosition& pos = PERFT_CORPUS[p];
+            uint64_t count = PerftParallel(MakeBoard(pos), pos.queue, MAX_DEPTH, threads, &generated);
+            cntFailed += (count == pos.counts[MAX_DEPTH - 1]) ? 0 : 1;
+        }
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        cout << threads << " thread(s): " << generated << " placements in " << fixed << setprecision(3)
+             << seconds << " s = " << (uint64_t)(generated / seconds) << " placements/s" << endl;
+        cout.unsetf(ios::fixed);
+    }
+
+    if (cntFailed > 0) {
+        cout << cntFailed << " perft count(s) FAILED !!!" << endl;
+        return 1;
+    }
+    cout << "perft OK" << endl;
+    return 0;
+}
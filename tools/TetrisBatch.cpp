@@ -0,0 +1,131 @@
+//=======================
+//  tetris_batch: plays N independent headless games on all the cores, and
+//  streams the results (one line per game) to a CSV file.
+//  Each worker thread owns its engine, bot player and bot PRNG (no shared
+//  state, no global rand()); game i is always seeded with (seed + i), so the
+//  results do not depend on the number of threads.
+//
+//  usage: tetris_batch <games> <output.csv> [threads] [seed] [randomizer] [max pieces]
+//=======================
+#include "TetrisBot.h"
+#include "TetrisEngine.h"
+#include "TetrisRandom.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace
+{
+    // results are written to the file in chunks
+    const int32_t FLUSH_GAMES = 64;
+    const size_t MAX_LINE_CHARS = 128;
+
+    struct BatchConfig
+    {
+        int64_t nGames;
+        int32_t cntThreads;
+        uint64_t nSeed;
+        const TetrisRandomizer* pRandomizer;
+        int32_t nMaxPieces;
+    };
+
+    // Everything a worker thread needs to play games, on its own cache lines
+    struct alignas(64) BatchWorker
+    {
+        TetrisBotPlayer player;
+        TetrisGreedyBot bot;
+        string output;
+    };
+
+
+    void RunWorker(const BatchConfig& config, atomic<int64_t>& nextGame, FILE* pFile, mutex& fileMutex)
+    {
+        // (on the stack of its thread: operator new ignores the alignment before C++17)
+        BatchWorker worker;
+        worker.output.reserve(FLUSH_GAMES * MAX_LINE_CHARS);
+
+        auto flush = [&]() {
+            lock_guard<mutex> lock(fileMutex);
+            fwrite(worker.output.data(), 1, worker.output.size(), pFile);
+            worker.output.clear();
+        };
+
+        int32_t cntPending = 0;
+        for (int64_t game = nextGame++; game < config.nGames; game = nextGame++)
+        {
+            uint64_t seed = config.nSeed + (uint64_t)game;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            TetrisRules rules = { 1, 0, 0, 0 };
+            alignas(64) TetrisEngine engine(rules, seed, config.pRandomizer);
+            worker.bot.NewGame(seed);
+            TetrisGameResult r = worker.player.PlayGame(engine, worker.bot, config.nMaxPieces);
+            int64_t micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+            char line[MAX_LINE_CHARS];
+            snprintf(line, sizeof(line), "%lld,%llu,%d,%d,%d,%d,%lld,%lld\n",
+                     (long long)game, (unsigned long long)seed, r.nScore, r.nLines, r.nLevel, r.nPieces,
+                     (long long)r.nTicks, (long long)micros);
+            worker.output.append(line);
+            if (++cntPending >= FLUSH_GAMES) {
+                flush();
+                cntPending = 0;
+            }
+        }
+        flush();
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cout << "usage: tetris_batch <games> <output.csv> [threads] [seed] [randomizer] [max pieces]" << endl;
+        cout << "randomizers:";
+        for (int32_t r = 0; r < CNT_RANDOMIZERS; r++)
+            cout << " " << r << "=" << GetRandomizer((RandomizerType)r)->GetName();
+        cout << endl;
+        return 1;
+    }
+
+    BatchConfig config;
+    config.nGames = atoll(argv[1]);
+    config.cntThreads = (argc > 3) ? atoi(argv[3]) : (int32_t)thread::hardware_concurrency();
+    config.cntThreads = (config.cntThreads > 0) ? config.cntThreads : 1;
+    config.nSeed = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 1;
+    config.pRandomizer = GetRandomizer((argc > 5) ? (RandomizerType)atoi(argv[5]) : RANDOMIZER_7_BAG);
+    config.nMaxPieces = (argc > 6) ? atoi(argv[6]) : 100000;
+
+    FILE* pFile = fopen(argv[2], "w");
+    if (pFile == nullptr) {
+        cout << "FAILED to open " << argv[2] << " !!!" << endl;
+        return 1;
+    }
+    fprintf(pFile, "# randomizer: %s\n", config.pRandomizer->GetName());
+    fprintf(pFile, "game,seed,score,lines,level,pieces,ticks,micros\n");
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    atomic<int64_t> nextGame(0);
+    mutex fileMutex;
+    vector<thread> threads;
+    for (int32_t t = 0; t < config.cntThreads; t++)
+        threads.emplace_back(RunWorker, cref(config), ref(nextGame), pFile, ref(fileMutex));
+    for (thread& th : threads)
+        th.join();
+    fclose(pFile);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << config.nGames << " games on " << config.cntThreads << " thread(s) in " << seconds << " s = "
+         << (int64_t)(config.nGames * 3600 / seconds) << " games/hour" << endl;
+    return 0;
+}
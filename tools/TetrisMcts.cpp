@@ -0,0 +1,97 @@
+//=======================
+//  tetris_mcts: how far the Monte Carlo tree search planner scales with the cores.
+//  Plays the same game (seed) with the MCTS bot, with 1, 2, 4, ... threads up to
+//  the given count, the same time budget per piece, and reports the rollouts per
+//  second, the speedup over one thread, the size of the trees and the score.
+//
+//  usage: tetris_mcts [max threads] [budget per piece, ms] [pieces] [seed]
+//=======================
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisMCTS.h"
+#include "TetrisThreadPool.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace
+{
+    struct RunResult
+    {
+        int64_t nRollouts;
+        int64_t nSearchMicros;
+        int64_t nTreeNodes;
+        int32_t nPieces;
+        TetrisGameResult game;
+    };
+
+
+    RunResult PlayGame(int32_t cntThreads, int64_t budgetMicros, int32_t maxPieces, uint64_t seed)
+    {
+        // (the calling thread runs simulations too, while it waits for the workers)
+        unique_ptr<TetrisThreadPool> pPool((cntThreads > 1) ? new TetrisThreadPool(cntThreads - 1) : nullptr);
+        TetrisMCTSBot bot(budgetMicros, 0, pPool.get());
+        TetrisBotPlayer player;
+        TetrisRules rules = { 1, 0, 0, 0 };
+        TetrisEngine engine(rules, seed);
+        bot.NewGame(seed);
+
+        RunResult result = {};
+        while (result.nPieces < maxPieces && player.PlayPiece(engine, bot))
+        {
+            const TetrisMCTS& search = bot.GetSearch();
+            result.nRollouts += search.GetRollouts();
+            result.nSearchMicros += search.GetElapsedMicros();
+            result.nTreeNodes += search.GetTreeNodes();
+            result.nPieces++;
+            // (the next piece spawns in the next PlayPiece(), before any time runs)
+            TetrisBotPlayer::PlayLinesAnimation(engine);
+        }
+        result.game.nScore = engine.GetScore();
+        result.game.nLines = engine.GetLines();
+        result.game.nPieces = result.nPieces;
+        return result;
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    int32_t maxThreads = (argc > 1) ? atoi(argv[1]) : (int32_t)thread::hardware_concurrency();
+    int64_t budgetMicros = 1000 * ((argc > 2) ? atoi(argv[2]) : 20);
+    int32_t maxPieces = (argc > 3) ? atoi(argv[3]) : 200;
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 1;
+    maxThreads = (maxThreads > 0) ? maxThreads : 1;
+
+    // 1, 2, 4, ... threads, and the maximum
+    vector<int32_t> threadCounts;
+    for (int32_t t = 1; t < maxThreads; t *= 2) {
+        threadCounts.push_back(t);
+    }
+    threadCounts.push_back(maxThreads);
+
+    cout << "threads  rollouts/s  speedup  tree nodes     score  lines  pieces" << endl;
+    double baseRate = 0.0;
+    for (int32_t cntThreads : threadCounts)
+    {
+        RunResult result = PlayGame(cntThreads, budgetMicros, maxPieces, seed);
+        double rate = (result.nSearchMicros > 0) ? result.nRollouts * 1e6 / result.nSearchMicros : 0.0;
+        baseRate = (baseRate > 0.0) ? baseRate : rate;
+        cout << setw(7) << cntThreads << setw(12) << (int64_t)rate
+             << setw(8) << fixed << setprecision(2) << ((baseRate > 0.0) ? rate / baseRate : 0.0) << "x"
+             << setw(12) << ((result.nPieces > 0) ? result.nTreeNodes / result.nPieces : 0)
+             << setw(10) << result.game.nScore << setw(7) << result.game.nLines << setw(8) << result.nPieces << endl;
+        cout.unsetf(ios::fixed);
+    }
+    return 0;
+}
@@ -0,0 +1,650 @@
+//=======================
+//  tetris_nn: trains and benchmarks the neural network value function (TetrisNNEval).
+//  train: plays games with the heuristic AI (on all the cores); the boards after some of
+//         the placements of each piece are valued by the heuristic AI playing the NEXT
+//         pieces from them. The float network learns these values (mostly how much better
+//         a board is than the others of its piece), then is quantized to int8 and written
+//         to the weights file.
+//  bench: measures the batched evaluation speed, and plays the network bot against the
+//         heuristic AI on the same seeds
+//
+//  usage: tetris_nn train <weights.bin> [boards] [epochs] [threads] [seed]
+//         tetris_nn bench <weights.bin> [games] [max pieces] [threads] [seed]
+//=======================
+#include "TetrisAI.h"
+#include "TetrisBoard.h"
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisMoveGen.h"
+#include "TetrisNN.h"
+#include "TetrisRandom.h"
+#include "TetrisThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+namespace
+{
+    // the value of a board: the heuristic score of the placements of the NEXT pieces (as the heuristic AI
+    // plays them), which the network sees: the value only depends on its inputs
+    const int32_t VALUE_PIECES = CNT_NEXT_PIECES;
+    // score of each placement missed after a game over (as for the MCTS rollouts)
+    const float GAME_OVER_SCORE = -2000.0f;
+    const int32_t GAME_PIECES = 500;
+    // boards valued per piece of the games (the network learns how much better a board is than the others)
+    const int32_t BOARD_PLACEMENTS = 4;
+    const int32_t TOP_PLACEMENTS = 8;
+    // (the error of the values themselves only counts this much)
+    const float VALUE_ERROR_WEIGHT = 0.1f;
+
+    const int32_t HIDDEN1 = 64;
+    const int32_t HIDDEN2 = 32;
+    const int32_t INPUT_SIZE = TetrisNNEval::INPUT_SIZE;
+
+    const int32_t BATCH_SIZE = 64;
+    const float LEARNING_RATE = 0.001f;
+
+
+    int64_t NowMicros()
+    {
+        return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+
+    //=======================
+    //  Training data
+    //=======================
+    struct Sample
+    {
+        uint8_t input[INPUT_SIZE];
+        float fTarget;
+    };
+
+
+    // Score of the heuristic AI over the given pieces, played greedily from the board
+    float Rollout(const TetrisAI& ai, TetrisMoveGen& moveGen, TetrisBoard board, const int8_t* pPieces, int32_t cntPieces)
+    {
+        TetrisMove moves[TetrisMoveGen::MAX_MOVES];
+        TetrisBoard after;
+        float value = 0.0f;
+        for (int32_t piece = 0; piece < cntPieces; piece++)
+        {
+            int32_t cntMoves = moveGen.Generate(board, Tetrimino(pPieces[piece]), moves, TetrisMoveGen::MAX_MOVES);
+            if (cntMoves == 0)
+                return value + GAME_OVER_SCORE * (cntPieces - piece);
+
+            int32_t bestIdx = 0;
+            float bestScore = 0.0f;
+            for (int32_t i = 0; i < cntMoves; i++)
+            {
+                float score = ai.EvaluatePlacement(board, moves[i].placement);
+                if (i == 0 || score > bestScore) {
+                    bestIdx = i, bestScore = score;
+                }
+            }
+            ai.EvaluateLock(board, moves[bestIdx].placement, after);
+            board = after;
+            value += bestScore;
+        }
+        return value;
+    }
+
+
+    // One game of the heuristic AI. For each piece, the boards after a few of its placements (the
+    // best one first, then others picked at random: the network must also know the boards the AI
+    // would not reach) are valued with rollouts over the pieces which really came next.
+    void PlayDataGame(uint64_t seed, vector<Sample>& samples)
+    {
+        TetrisRules rules = { 1, 0, 0, 0 };
+        TetrisEngine engine(rules, seed);
+        TetrisAI ai;
+        unique_ptr<TetrisBotPlayer> pPlayer(new TetrisBotPlayer());
+        vector<TetrisBoard> boards;
+        vector<int8_t> pieces;
+        for (int32_t piece = 0; piece < GAME_PIECES; piece++)
+        {
+            // (the piece to play: the first of the NEXT queue, until it spawns)
+            boards.push_back(engine.GetBoard());
+            const Tetrimino& next = engine.IsSpawnPending() ? engine.GetNextPiece(0) : engine.GetCurrentPiece();
+            pieces.push_back(next.getTypeIndex());
+            if (!pPlayer->PlayPiece(engine, ai))
+                break;
+            TetrisBotPlayer::PlayLinesAnimation(engine);
+        }
+        // the pieces after the last one (the next piece has not spawned, or it was the last one)
+        for (int32_t i = 0; i < CNT_NEXT_PIECES; i++) {
+            pieces.push_back(engine.GetNextPiece(i).getTypeIndex());
+        }
+
+        unique_ptr<TetrisMoveGen> pMoveGen(new TetrisMoveGen());
+        vector<TetrisMove> moves(TetrisMoveGen::MAX_MOVES);
+        vector<pair<float, int32_t>> scores;
+        TetrisRng rng;
+        rng.Seed(seed);
+        TetrisBoard after;
+        int32_t cntBoards = (int32_t)pieces.size() - VALUE_PIECES;
+        for (int32_t b = 0; b < cntBoards; b++)
+        {
+            int32_t cntMoves = pMoveGen->Generate(boards[b], Tetrimino(pieces[b]), moves.data(), TetrisMoveGen::MAX_MOVES);
+            if (cntMoves == 0)
+                continue;
+            // (most of the others among the best moves, where the choice is made)
+            scores.resize(cntMoves);
+            for (int32_t i = 0; i < cntMoves; i++) {
+                scores[i] = make_pair(-ai.EvaluatePlacement(boards[b], moves[i].placement), i);
+            }
+            int32_t cntTop = min(cntMoves, TOP_PLACEMENTS);
+            partial_sort(scores.begin(), scores.begin() + cntTop, scores.end());
+            for (int32_t c = 0; c < BOARD_PLACEMENTS; c++)
+            {
+                int32_t rank = (c == 0) ? 0 : (int32_t)rng.NextBelow((uint32_t)((c < BOARD_PLACEMENTS - 1) ? cntTop : cntMoves));
+                if (rank >= cntTop)
+                    nth_element(scores.begin() + cntTop, scores.begin() + rank, scores.end());
+                int32_t moveIdx = scores[rank].second;
+                ai.EvaluateLock(boards[b], moves[moveIdx].placement, after);
+                // (as the network bot sees it: the NEXT queue after the lock, nothing in HOLD)
+                Sample sample;
+                TetrisNNEval::EncodeInput(after, &pieces[b + 1], -1, sample.input);
+                sample.fTarget = Rollout(ai, *pMoveGen, after, &pieces[b + 1], VALUE_PIECES);
+                samples.push_back(sample);
+            }
+        }
+    }
+
+
+    vector<Sample> GenerateData(TetrisThreadPool& pool, int32_t cntBoards, uint64_t seed)
+    {
+        // enough games for the boards (most games last GAME_PIECES pieces)
+        int32_t gameSamples = (GAME_PIECES - VALUE_PIECES) * BOARD_PLACEMENTS;
+        int32_t cntGames = max(1, (cntBoards + gameSamples - 1) / gameSamples);
+        vector<vector<Sample>> games(cntGames);
+        TetrisTaskGroup group;
+        for (int32_t g = 0; g < cntGames; g++) {
+            pool.Submit([&games, g, seed]() { PlayDataGame(seed + (uint64_t)g, games[g]); }, &group);
+        }
+        pool.Wait(group);
+
+        vector<Sample> samples;
+        for (const vector<Sample>& game : games) {
+            samples.insert(samples.end(), game.begin(), game.end());
+        }
+        // (whole groups of boards)
+        if ((int32_t)samples.size() > cntBoards)
+            samples.resize(cntBoards - cntBoards % BOARD_PLACEMENTS);
+        return samples;
+    }
+
+
+
+    //=======================
+    //  Float network (training), with clipped ReLU activations as the int8 network
+    //=======================
+    class FloatNet
+    {
+    public:
+        FloatNet()
+        {
+            m_Params.assign(OFFSET_COUNT, 0.0f);
+            m_Grads.assign(OFFSET_COUNT, 0.0f);
+            m_Moment1.assign(OFFSET_COUNT, 0.0f);
+            m_Moment2.assign(OFFSET_COUNT, 0.0f);
+            m_nSteps = 0;
+        }
+
+        void Init(uint64_t seed)
+        {
+            TetrisRng rng;
+            rng.Seed(seed);
+            auto Uniform = [&rng](float range) { return range * (2.0f * (rng.Next() >> 8) / (float)(1 << 24) - 1.0f); };
+            for (int32_t j = 0; j < HIDDEN1; j++) {
+                for (int32_t i = 0; i < TetrisNNEval::INPUT_FEATURES; i++) {
+                    // (heights and holes count up to 20, the other inputs are 0/1)
+                    m_Params[W1 + j * INPUT_SIZE + i] = Uniform((i < TetrisNNEval::INPUT_HEIGHTS) ? 0.1f : 0.01f);
+                }
+                m_Params[B1 + j] = 0.5f;
+            }
+            for (int32_t k = 0; k < HIDDEN2; k++) {
+                for (int32_t j = 0; j < HIDDEN1; j++) {
+                    m_Params[W2 + k * HIDDEN1 + j] = Uniform(1.0f / sqrtf((float)HIDDEN1));
+                }
+            }
+            for (int32_t k = 0; k < HIDDEN2; k++) {
+                m_Params[W3 + k] = Uniform(1.0f / sqrtf((float)HIDDEN2));
+            }
+        }
+
+        float Forward(const Sample& sample)                 { return Run(sample, nullptr); }
+        // Accumulates the gradients, for this gradient of the loss over the output
+        void Backward(const Sample& sample, float gradient) { Run(sample, &gradient); }
+
+        // Adam step, with the gradients of a batch (the first layer weights are kept in -1..1, for the quantization)
+        void Step(int32_t batchSize)
+        {
+            const float beta1 = 0.9f, beta2 = 0.999f, epsilon = 1e-8f;
+            m_nSteps++;
+            float correction1 = 1.0f - powf(beta1, (float)m_nSteps);
+            float correction2 = 1.0f - powf(beta2, (float)m_nSteps);
+            for (int32_t p = 0; p < OFFSET_COUNT; p++)
+            {
+                float grad = m_Grads[p] / batchSize;
+                m_Grads[p] = 0.0f;
+                m_Moment1[p] = beta1 * m_Moment1[p] + (1.0f - beta1) * grad;
+                m_Moment2[p] = beta2 * m_Moment2[p] + (1.0f - beta2) * grad * grad;
+                m_Params[p] -= LEARNING_RATE * (m_Moment1[p] / correction1) / (sqrtf(m_Moment2[p] / correction2) + epsilon);
+            }
+            for (int32_t p = W1; p < W1 + HIDDEN1 * INPUT_SIZE; p++) {
+                m_Params[p] = min(max(m_Params[p], -1.0f), 1.0f);
+            }
+        }
+
+        // Writes the int8 network (see TetrisNNEval), for targets normalized as (value - mean) / stdDev
+        bool Save(const char* pFileName, float mean, float stdDev) const
+        {
+            // layer 1: in 0/1, out 0..127 = 127 * activation
+            float maxW1 = MaxAbs(W1, HIDDEN1 * INPUT_SIZE);
+            uint32_t shift1 = LargestShift(1.0f / max(maxW1, 1e-6f));
+            float scale1 = 127.0f * (float)(1u << shift1);
+            // layer 2: in 0..127, out 0..127
+            float maxW2 = MaxAbs(W2, HIDDEN2 * HIDDEN1);
+            uint32_t shift2 = LargestShift(127.0f / max(maxW2, 1e-6f));
+            float scale2 = (float)(1u << shift2);
+            // output: value = stdDev * (W3 . a2 + b3) + mean, with a2 = in / 127
+            float maxW3 = MaxAbs(W3, HIDDEN2) * stdDev / 127.0f;
+            float outputScale = max(maxW3, 1e-6f) / 127.0f;
+
+            ofstream file(pFileName, ofstream::binary);
+            uint32_t sizes[3] = { (uint32_t)INPUT_SIZE, (uint32_t)HIDDEN1, (uint32_t)HIDDEN2 };
+            file.write("TNN1", 4);
+            Write(file, sizes, 3);
+            Write(file, &outputScale, 1);
+            WriteLayer(file, shift1, B1, W1, HIDDEN1, INPUT_SIZE, scale1, scale1);
+            WriteLayer(file, shift2, B2, W2, HIDDEN2, HIDDEN1, 127.0f * scale2, scale2);
+            int32_t bias3 = (int32_t)lroundf((stdDev * m_Params[B3] + mean) / outputScale);
+            Write(file, &bias3, 1);
+            for (int32_t k = 0; k < HIDDEN2; k++) {
+                int8_t w = (int8_t)lroundf(m_Params[W3 + k] * stdDev / 127.0f / outputScale);
+                Write(file, &w, 1);
+            }
+            return file.good();
+        }
+
+    private:
+        enum {
+            W1 = 0,
+            B1 = W1 + HIDDEN1 * INPUT_SIZE,
+            W2 = B1 + HIDDEN1,
+            B2 = W2 + HIDDEN2 * HIDDEN1,
+            W3 = B2 + HIDDEN2,
+            B3 = W3 + HIDDEN2,
+            OFFSET_COUNT = B3 + 1
+        };
+
+        // Forward pass, and backward pass with the gradient of the output (returns the output)
+        float Run(const Sample& sample, const float* pGradient)
+        {
+            // (the inputs are mostly 0)
+            int32_t active[INPUT_SIZE];
+            float activeValues[INPUT_SIZE];
+            int32_t cntActive = 0;
+            for (int32_t i = 0; i < INPUT_SIZE; i++) {
+                if (sample.input[i] != 0) {
+                    active[cntActive] = i;
+                    activeValues[cntActive++] = sample.input[i];
+                }
+            }
+
+            float z1[HIDDEN1], a1[HIDDEN1], z2[HIDDEN2], a2[HIDDEN2];
+            for (int32_t j = 0; j < HIDDEN1; j++)
+            {
+                const float* pRow = &m_Params[W1 + j * INPUT_SIZE];
+                float sum = m_Params[B1 + j];
+                for (int32_t n = 0; n < cntActive; n++) {
+                    sum += pRow[active[n]] * activeValues[n];
+                }
+                z1[j] = sum;
+                a1[j] = min(max(sum, 0.0f), 1.0f);
+            }
+            for (int32_t k = 0; k < HIDDEN2; k++)
+            {
+                const float* pRow = &m_Params[W2 + k * HIDDEN1];
+                float sum = m_Params[B2 + k];
+                for (int32_t j = 0; j < HIDDEN1; j++) {
+                    sum += pRow[j] * a1[j];
+                }
+                z2[k] = sum;
+                a2[k] = min(max(sum, 0.0f), 1.0f);
+            }
+            float y = m_Params[B3];
+            for (int32_t k = 0; k < HIDDEN2; k++) {
+                y += m_Params[W3 + k] * a2[k];
+            }
+            if (pGradient == nullptr)
+                return y;
+
+            // backward
+            float dy = *pGradient;
+            float dz2[HIDDEN2], da1[HIDDEN1] = {};
+            m_Grads[B3] += dy;
+            for (int32_t k = 0; k < HIDDEN2; k++)
+            {
+                m_Grads[W3 + k] += dy * a2[k];
+                dz2[k] = (z2[k] > 0.0f && z2[k] < 1.0f) ? dy * m_Params[W3 + k] : 0.0f;
+                if (dz2[k] == 0.0f)
+                    continue;
+                m_Grads[B2 + k] += dz2[k];
+                float* pGrad = &m_Grads[W2 + k * HIDDEN1];
+                const float* pRow = &m_Params[W2 + k * HIDDEN1];
+                for (int32_t j = 0; j < HIDDEN1; j++) {
+                    pGrad[j] += dz2[k] * a1[j];
+                    da1[j] += dz2[k] * pRow[j];
+                }
+            }
+            for (int32_t j = 0; j < HIDDEN1; j++)
+            {
+                if (z1[j] <= 0.0f || z1[j] >= 1.0f)
+                    continue;
+                m_Grads[B1 + j] += da1[j];
+                float* pGrad = &m_Grads[W1 + j * INPUT_SIZE];
+                for (int32_t n = 0; n < cntActive; n++) {
+                    pGrad[active[n]] += da1[j] * activeValues[n];
+                }
+            }
+            return y;
+        }
+
+        float MaxAbs(int32_t offset, int32_t count) const
+        {
+            float maxValue = 0.0f;
+            for (int32_t i = 0; i < count; i++) {
+                maxValue = max(maxValue, fabsf(m_Params[offset + i]));
+            }
+            return maxValue;
+        }
+
+        static uint32_t LargestShift(float maxFactor)
+        {
+            uint32_t shift = 0;
+            while (shift < 24 && (float)(2u << shift) <= maxFactor)
+                shift++;
+            return shift;
+        }
+
+        template<typename T>
+        static void Write(ofstream& file, const T* pValues, size_t count)
+        {
+            file.write(reinterpret_cast<const char*>(pValues), count * sizeof(T));
+        }
+
+        void WriteLayer(ofstream& file, uint32_t shift, int32_t biasOffset, int32_t weightOffset,
+                        int32_t cntOutputs, int32_t cntInputs, float biasScale, float weightScale) const
+        {
+            Write(file, &shift, 1);
+            for (int32_t o = 0; o < cntOutputs; o++) {
+                int32_t bias = (int32_t)lroundf(m_Params[biasOffset + o] * biasScale);
+                Write(file, &bias, 1);
+            }
+            for (int32_t i = 0; i < cntOutputs * cntInputs; i++) {
+                long w = lroundf(m_Params[weightOffset + i] * weightScale);
+                int8_t w8 = (int8_t)min(max(w, -127L), 127L);
+                Write(file, &w8, 1);
+            }
+        }
+
+    private:
+        vector<float> m_Params;
+        vector<float> m_Grads;
+        vector<float> m_Moment1, m_Moment2;
+        int32_t m_nSteps;
+    };
+
+
+
+    // RMS errors of a network over the validation groups (its outputs are scaled back as values)
+    struct ValidationError
+    {
+        float fDifferences;     // on the difference of each board with the first one of its group
+        float fValues;
+    };
+
+    template<typename NETWORK>
+    ValidationError Validate(const vector<Sample>& samples, int32_t firstGroup, int32_t cntGroups,
+                             const NETWORK& network, float mean, float scale)
+    {
+        double differences = 0.0, values = 0.0;
+        for (int32_t g = firstGroup; g < cntGroups; g++)
+        {
+            const Sample* pGroup = &samples[(size_t)g * BOARD_PLACEMENTS];
+            float first = network(pGroup[0]) * scale + mean;
+            values += (first - pGroup[0].fTarget) * (first - pGroup[0].fTarget);
+            for (int32_t c = 1; c < BOARD_PLACEMENTS; c++)
+            {
+                float value = network(pGroup[c]) * scale + mean;
+                float error = (value - first) - (pGroup[c].fTarget - pGroup[0].fTarget);
+                differences += error * error;
+                values += (value - pGroup[c].fTarget) * (value - pGroup[c].fTarget);
+            }
+        }
+        int32_t cntValidation = max(cntGroups - firstGroup, 1);
+        ValidationError error;
+        error.fDifferences = (float)sqrt(differences / (cntValidation * (BOARD_PLACEMENTS - 1)));
+        error.fValues = (float)sqrt(values / (cntValidation * BOARD_PLACEMENTS));
+        return error;
+    }
+
+
+
+    //=======================
+    //  Commands
+    //=======================
+    int Train(const char* pFileName, int32_t cntBoards, int32_t cntEpochs, int32_t cntThreads, uint64_t seed)
+    {
+        TetrisThreadPool pool(cntThreads);
+        int64_t start = NowMicros();
+        vector<Sample> samples = GenerateData(pool, cntBoards, seed);
+        if (samples.size() < 10 * BOARD_PLACEMENTS) {
+            cerr << "not enough boards" << endl;
+            return 1;
+        }
+        cout << samples.size() << " boards, generated in " << (NowMicros() - start) / 1000 << " ms" << endl;
+
+        // targets normalized; the last tenth of the boards is kept for validation
+        double sum = 0.0, sumSquares = 0.0;
+        for (const Sample& sample : samples) {
+            sum += sample.fTarget;
+            sumSquares += (double)sample.fTarget * sample.fTarget;
+        }
+        float mean = (float)(sum / samples.size());
+        float stdDev = (float)sqrt(max(sumSquares / samples.size() - (double)mean * mean, 1.0));
+        vector<float> targets(samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            targets[i] = (samples[i].fTarget - mean) / stdDev;
+        }
+        int32_t cntGroups = (int32_t)samples.size() / BOARD_PLACEMENTS;
+        int32_t cntTrain = cntGroups * 9 / 10;
+
+        FloatNet net;
+        net.Init(seed);
+        vector<int32_t> order(cntTrain);
+        for (int32_t i = 0; i < cntTrain; i++) {
+            order[i] = i;
+        }
+        TetrisRng rng;
+        rng.Seed(seed);
+        for (int32_t epoch = 0; epoch < cntEpochs; epoch++)
+        {
+            for (int32_t i = cntTrain - 1; i > 0; i--) {
+                swap(order[i], order[rng.NextBelow(i + 1)]);
+            }
+            for (int32_t first = 0; first < cntTrain; first += BATCH_SIZE)
+            {
+                int32_t last = min(first + BATCH_SIZE, cntTrain);
+                for (int32_t i = first; i < last; i++)
+                {
+                    // loss: the errors on the differences with the first board of the group, and on the values
+                    int32_t base = order[i] * BOARD_PLACEMENTS;
+                    float outputs[BOARD_PLACEMENTS], gradients[BOARD_PLACEMENTS];
+                    for (int32_t c = 0; c < BOARD_PLACEMENTS; c++) {
+                        outputs[c] = net.Forward(samples[base + c]);
+                        gradients[c] = VALUE_ERROR_WEIGHT * (outputs[c] - targets[base + c]);
+                    }
+                    for (int32_t c = 1; c < BOARD_PLACEMENTS; c++) {
+                        float error = (outputs[c] - outputs[0]) - (targets[base + c] - targets[base]);
+                        gradients[c] += error;
+                        gradients[0] -= error;
+                    }
+                    for (int32_t c = 0; c < BOARD_PLACEMENTS; c++) {
+                        net.Backward(samples[base + c], gradients[c]);
+                    }
+                }
+                net.Step((last - first) * BOARD_PLACEMENTS);
+            }
+            ValidationError error = Validate(samples, cntTrain, cntGroups,
+                                             [&net](const Sample& sample) { return net.Forward(sample); }, mean, stdDev);
+            cout << "epoch " << setw(3) << epoch + 1 << ": validation error " << fixed << setprecision(1)
+                 << error.fDifferences << " on the differences, " << error.fValues << " on the values (std dev " << stdDev << ")" << endl;
+            cout.unsetf(ios::fixed);
+        }
+
+        // quantized network: its error, once loaded back
+        if (!net.Save(pFileName, mean, stdDev)) {
+            cerr << "cannot write " << pFileName << endl;
+            return 1;
+        }
+        TetrisNNEval eval;
+        if (!eval.Load(pFileName)) {
+            cerr << "cannot read back " << pFileName << endl;
+            return 1;
+        }
+        ValidationError error = Validate(samples, cntTrain, cntGroups, [&eval](const Sample& sample) {
+            float value;
+            eval.Evaluate(sample.input, 1, &value);
+            return value;
+        }, 0.0f, 1.0f);
+        cout << "int8 network: validation error " << fixed << setprecision(1)
+             << error.fDifferences << " on the differences, " << error.fValues << " on the values" << endl;
+        cout << "written to " << pFileName << endl;
+        return 0;
+    }
+
+
+    int Bench(const char* pFileName, int32_t cntGames, int32_t maxPieces, int32_t cntThreads, uint64_t seed)
+    {
+        TetrisNNEval eval;
+        if (!eval.Load(pFileName)) {
+            cerr << "cannot load the network from " << pFileName << endl;
+            return 1;
+        }
+
+        // evaluation speed: batches of the size of a piece's moves
+        const int32_t batchSize = 64, cntBatches = 20000;
+        vector<Sample> samples;
+        TetrisThreadPool pool(cntThreads);
+        samples = GenerateData(pool, batchSize, seed);
+        vector<uint8_t> inputs((size_t)batchSize * INPUT_SIZE);
+        for (int32_t i = 0; i < batchSize; i++) {
+            memcpy(&inputs[(size_t)i * INPUT_SIZE], samples[i % samples.size()].input, INPUT_SIZE);
+        }
+        vector<float> values(batchSize);
+        int64_t start = NowMicros();
+        for (int32_t b = 0; b < cntBatches; b++) {
+            eval.Evaluate(inputs.data(), batchSize, values.data());
+        }
+        double nnRate = (double)batchSize * cntBatches * 1e6 / max<int64_t>(NowMicros() - start, 1);
+        cout << "network: " << (int64_t)nnRate << " boards/s (batches of " << batchSize << ", one thread)" << endl;
+
+        // the heuristic, for comparison: the placements of a piece, on a board from the data
+        TetrisBoard board;
+        for (int32_t i = 0; i < TetrisNNEval::INPUT_PIECES; i++) {
+            if (samples[0].input[i] != 0)
+                board.SetTile(i % TABLE_WIDTH_TILES, i / TABLE_WIDTH_TILES, 0);
+        }
+        unique_ptr<TetrisMoveGen> pMoveGen(new TetrisMoveGen());
+        vector<TetrisMove> moves(TetrisMoveGen::MAX_MOVES);
+        int32_t cntMoves = pMoveGen->Generate(board, Tetrimino(0), moves.data(), TetrisMoveGen::MAX_MOVES);
+        TetrisAI ai;
+        int64_t cntEvals = 0;
+        start = NowMicros();
+        for (int32_t b = 0; b < cntBatches && cntMoves > 0; b++) {
+            for (int32_t i = 0; i < cntMoves; i++) {
+                ai.EvaluatePlacement(board, moves[i].placement);
+            }
+            cntEvals += cntMoves;
+        }
+        double aiRate = (double)cntEvals * 1e6 / max<int64_t>(NowMicros() - start, 1);
+        cout << "heuristic: " << (int64_t)aiRate << " placements/s" << endl;
+
+        // games: the network bot and the heuristic AI, on the same seeds
+        vector<int32_t> scoresNN(cntGames), scoresAI(cntGames);
+        TetrisTaskGroup group;
+        for (int32_t g = 0; g < cntGames; g++)
+        {
+            uint64_t gameSeed = seed + (uint64_t)g;
+            pool.Submit([&, g, gameSeed]() {
+                TetrisRules rules = { 1, 0, 0, 0 };
+                TetrisEngine engine(rules, gameSeed);
+                TetrisNNBot bot(eval);
+                unique_ptr<TetrisBotPlayer> pPlayer(new TetrisBotPlayer());
+                scoresNN[g] = pPlayer->PlayGame(engine, bot, maxPieces).nScore;
+            }, &group);
+            pool.Submit([&, g, gameSeed]() {
+                TetrisRules rules = { 1, 0, 0, 0 };
+                TetrisEngine engine(rules, gameSeed);
+                TetrisAI bot;
+                unique_ptr<TetrisBotPlayer> pPlayer(new TetrisBotPlayer());
+                scoresAI[g] = pPlayer->PlayGame(engine, bot, maxPieces).nScore;
+            }, &group);
+        }
+        pool.Wait(group);
+
+        int32_t winsNN = 0, winsAI = 0;
+        int64_t totalNN = 0, totalAI = 0;
+        for (int32_t g = 0; g < cntGames; g++) {
+            winsNN += (scoresNN[g] > scoresAI[g]) ? 1 : 0;
+            winsAI += (scoresAI[g] > scoresNN[g]) ? 1 : 0;
+            totalNN += scoresNN[g];
+            totalAI += scoresAI[g];
+        }
+        cout << "Neural net vs Heuristic AI  " << winsNN << " - " << winsAI
+             << "   (avg scores " << totalNN / max(cntGames, 1) << " / " << totalAI / max(cntGames, 1) << ")" << endl;
+        return 0;
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    string command = (argc > 1) ? argv[1] : "";
+    if (argc < 3 || (command != "train" && command != "bench"))
+    {
+        cerr << "usage: tetris_nn train <weights.bin> [boards] [epochs] [threads] [seed]" << endl;
+        cerr << "       tetris_nn bench <weights.bin> [games] [max pieces] [threads] [seed]" << endl;
+        return 1;
+    }
+    int32_t cntThreads = (argc > 5) ? atoi(argv[5]) : 0;
+    uint64_t seed = (argc > 6) ? strtoull(argv[6], nullptr, 10) : 1;
+    if (command == "train")
+    {
+        int32_t cntBoards = (argc > 3) ? atoi(argv[3]) : 100000;
+        int32_t cntEpochs = (argc > 4) ? atoi(argv[4]) : 10;
+        return Train(argv[2], cntBoards, cntEpochs, cntThreads, seed);
+    }
+    int32_t cntGames = (argc > 3) ? atoi(argv[3]) : 16;
+    int32_t maxPieces = (argc > 4) ? atoi(argv[4]) : 500;
+    // (other seeds than the training games)
+    return Bench(argv[2], cntGames, maxPieces, cntThreads, seed + 1000000);
+}
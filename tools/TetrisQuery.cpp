@@ -0,0 +1,464 @@
+//=======================
+//  tetris_query: analytics over replay archives (TetrisReplayArchive): the
+//  distribution of the scores, the piece droughts, the T-Spin rates and the
+//  line clears by level, over all the games of one or more archives.
+//  The archives are mapped in memory and scanned on all the cores: each worker
+//  takes the next chunk of games (an atomic counter) and adds them to its own
+//  partial statistics, which are merged once all the workers are done.
+//  A query reads no more than it needs:
+//    scores:         the index of the archive (the result of each game)
+//    droughts:       the seed of each game (the pieces are drawn again from its
+//                    randomizer); replays without their piece count are re-simulated
+//    tspins, clears: the replays, re-simulated update by update
+//
+//  usage: tetris_query <scores | droughts | tspins | clears | all> <archive.tra>... [threads]
+//=======================
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisRandom.h"
+#include "TetrisReplay.h"
+#include "TetrisReplayArchive.h"
+#include "Tetrimino.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+namespace
+{
+    enum QueryFlags
+    {
+        QUERY_SCORES    = 0x01,
+        QUERY_DROUGHTS  = 0x02,
+        QUERY_TSPINS    = 0x04,
+        QUERY_CLEARS    = 0x08,
+        QUERY_ALL       = 0x0F,
+        // the queries which re-simulate the games
+        QUERY_SIMULATE  = QUERY_TSPINS | QUERY_CLEARS,
+    };
+
+    // games a worker takes at a time
+    const uint64_t GAME_CHUNK = 64;
+    // bars of the score histogram (at most)
+    const int32_t SCORE_BARS = 20;
+    // drought lengths (the last bucket: this long, or longer)
+    const int32_t DROUGHT_BUCKETS = 32;
+    // line clears by level (the last row: MAX_LEVEL and above)
+    const int32_t CNT_LEVELS = MAX_LEVEL + 1;
+    const int32_t BAR_WIDTH = 40;
+
+
+    //=======================
+    //  Statistics of the games scanned by one worker (merged at the end)
+    //=======================
+    struct QueryStats
+    {
+        int64_t nGames = 0;
+        int64_t nSimulated = 0;
+        int64_t nUpdates = 0;
+        int64_t nFailed = 0;                // replays which could not be read, or re-simulated
+
+        // scores
+        vector<int32_t> scores;             // (for the percentiles)
+        int64_t nScoreSum = 0, nLinesSum = 0, nLevelSum = 0;
+
+        // droughts: the pieces dealt between two pieces of the same type
+        int64_t nDealt = 0;
+        int64_t cntDealt[CNT_TETRIMINOS] = {};
+        int64_t nDroughtSum[CNT_TETRIMINOS] = {};
+        int32_t nLongest[CNT_TETRIMINOS] = {};
+        int64_t droughtBuckets[DROUGHT_BUCKETS] = {};       // of the I piece
+
+        // T-Spins
+        int64_t nLocks = 0;
+        int64_t nTLocks = 0;
+        int64_t tspinLines[MAX_LINES_PER_LOCK + 1] = {};   // T-Spins, by lines cleared
+
+        // line clears, by level and lines cleared
+        int64_t clears[CNT_LEVELS][MAX_LINES_PER_LOCK + 1] = {};
+
+        void Merge(const QueryStats& other);
+    };
+
+
+    void QueryStats::Merge(const QueryStats& other)
+    {
+        nGames += other.nGames;
+        nSimulated += other.nSimulated;
+        nUpdates += other.nUpdates;
+        nFailed += other.nFailed;
+
+        scores.insert(scores.end(), other.scores.begin(), other.scores.end());
+        nScoreSum += other.nScoreSum;
+        nLinesSum += other.nLinesSum;
+        nLevelSum += other.nLevelSum;
+
+        nDealt += other.nDealt;
+        for (int32_t t = 0; t < CNT_TETRIMINOS; t++) {
+            cntDealt[t] += other.cntDealt[t];
+            nDroughtSum[t] += other.nDroughtSum[t];
+            nLongest[t] = max(nLongest[t], other.nLongest[t]);
+        }
+        for (int32_t i = 0; i < DROUGHT_BUCKETS; i++)
+            droughtBuckets[i] += other.droughtBuckets[i];
+
+        nLocks += other.nLocks;
+        nTLocks += other.nTLocks;
+        for (int32_t n = 0; n <= MAX_LINES_PER_LOCK; n++)
+            tspinLines[n] += other.tspinLines[n];
+        for (int32_t level = 0; level < CNT_LEVELS; level++)
+            for (int32_t n = 0; n <= MAX_LINES_PER_LOCK; n++)
+                clears[level][n] += other.clears[level][n];
+    }
+
+
+
+    /////////////////////////////////////////////
+    //  SCAN
+    /////////////////////////////////////////////
+
+    const int8_t PIECE_I = Tetrimino::typeIndexFromChar('I');
+    const int8_t PIECE_T = Tetrimino::typeIndexFromChar('T');
+
+
+    void AddScore(const TetrisArchiveEntry& entry, QueryStats& stats)
+    {
+        stats.scores.push_back(entry.nScore);
+        stats.nScoreSum += entry.nScore;
+        stats.nLinesSum += entry.nLines;
+        stats.nLevelSum += entry.nLevel;
+    }
+
+
+    // The pieces dealt in the game: its first pieces drawn from the seed (those which spawned;
+    // the HOLD of the first piece held deals one more, which is not counted)
+    void AddDroughts(const TetrisReplayReader& reader, int32_t cntPieces, vector<int8_t>& pieces, QueryStats& stats)
+    {
+        const TetrisRandomizer* pRandomizer = GetRandomizer(reader.GetRandomizerType());
+        RandomizerState state;
+        pRandomizer->Reset(state, reader.GetSeed());
+        pieces.resize((size_t)cntPieces);
+        pRandomizer->Generate(state, pieces.data(), pieces.size());
+
+        // (the drought before the first piece of a type counts; the one left open at the end does not)
+        int32_t lastSeen[CNT_TETRIMINOS];
+        fill(lastSeen, lastSeen + CNT_TETRIMINOS, -1);
+        for (int32_t i = 0; i < cntPieces; i++)
+        {
+            int8_t type = pieces[i];
+            int32_t drought = i - lastSeen[type] - 1;
+            lastSeen[type] = i;
+            stats.cntDealt[type]++;
+            stats.nDroughtSum[type] += drought;
+            stats.nLongest[type] = max(stats.nLongest[type], drought);
+            if (type == PIECE_I)
+                stats.droughtBuckets[min(drought, DROUGHT_BUCKETS - 1)]++;
+        }
+        stats.nDealt += cntPieces;
+    }
+
+
+    // Plays the replay, and records each lock and line clear: false if it does not end as it was recorded
+    bool SimulateGame(TetrisReplayReader& reader, int32_t& cntPieces, QueryStats& stats)
+    {
+        TetrisEngine engine = reader.CreateEngine();
+        bool bTSpinPending = false;     // the last lock was a T-Spin, and its lines are being dropped
+        for (;;)
+        {
+            bool bSpawnPending = engine.IsSpawnPending();
+            int32_t level = engine.GetLevel();
+            int32_t lines = engine.GetLines();
+            if (!reader.Step(engine))
+                break;
+
+            if (!bSpawnPending && engine.IsSpawnPending())
+            {
+                // locked: the piece is still the current one, and the flags are those of this lock
+                stats.nLocks++;
+                if (engine.GetCurrentPiece().getTypeIndex() == PIECE_T)
+                    stats.nTLocks++;
+                if ((engine.GetAnimationFlags() & TetrisEngine::ANIM_TSPIN) != 0)
+                {
+                    if (engine.IsDroppingLines())
+                        bTSpinPending = true;
+                    else
+                        stats.tspinLines[0]++;
+                }
+            }
+            // (the lines are cleared once they have been dropped, a few updates after the lock)
+            int32_t cntCleared = engine.GetLines() - lines;
+            if (cntCleared > 0)
+            {
+                cntCleared = min(cntCleared, MAX_LINES_PER_LOCK);
+                stats.clears[min(level, CNT_LEVELS - 1)][cntCleared]++;
+                if (bTSpinPending)
+                    stats.tspinLines[cntCleared]++;
+                bTSpinPending = false;
+            }
+        }
+        stats.nSimulated++;
+        stats.nUpdates += reader.GetUpdateCount();
+        cntPieces = engine.GetPieceCount();
+        return reader.IsEnd() && reader.MatchesResult(engine);
+    }
+
+
+    void ScanGame(const TetrisReplayArchive& archive, uint64_t idx, uint32_t queries,
+                  vector<int8_t>& pieces, QueryStats& stats)
+    {
+        const TetrisArchiveEntry& entry = archive.GetEntry(idx);
+        stats.nGames++;
+        if ((queries & QUERY_SCORES) != 0)
+            AddScore(entry, stats);
+        if ((queries & (QUERY_DROUGHTS | QUERY_SIMULATE)) == 0)
+            return;
+
+        TetrisReplayReader reader;
+        if (!archive.OpenReplay(idx, reader)) {
+            stats.nFailed++;
+            return;
+        }
+        int32_t cntPieces = entry.nPieces;
+        // (version 1 replays do not keep the pieces: they have to be played to count them)
+        if ((queries & QUERY_SIMULATE) != 0 || cntPieces < 0)
+        {
+            TetrisReplayReader simulation = reader;
+            if (!SimulateGame(simulation, cntPieces, stats))
+                stats.nFailed++;
+        }
+        if ((queries & QUERY_DROUGHTS) != 0)
+            AddDroughts(reader, cntPieces, pieces, stats);
+    }
+
+
+
+    /////////////////////////////////////////////
+    //  REPORTS
+    /////////////////////////////////////////////
+
+    string Bar(int64_t count, int64_t maxCount)
+    {
+        return string((size_t)((maxCount > 0) ? count * BAR_WIDTH / maxCount : 0), '#');
+    }
+
+
+    double Ratio(int64_t count, int64_t total)
+    {
+        return (total > 0) ? (double)count / (double)total : 0.0;
+    }
+
+
+    void ReportScores(QueryStats& stats)
+    {
+        cout << endl << "SCORES" << endl;
+        if (stats.scores.empty()) {
+            cout << "  (no games)" << endl;
+            return;
+        }
+        vector<int32_t>& scores = stats.scores;
+        int64_t cntGames = (int64_t)scores.size();
+        cout << "  mean score " << (int64_t)(stats.nScoreSum / cntGames) << ", lines " << fixed << setprecision(1)
+             << Ratio(stats.nLinesSum, cntGames) << ", level " << Ratio(stats.nLevelSum, cntGames) << endl;
+        cout << " ";
+        const int32_t PERCENTILES[] = { 0, 10, 50, 90, 99, 100 };
+        for (int32_t p : PERCENTILES)
+        {
+            size_t rank = min((size_t)(cntGames * p / 100), scores.size() - 1);
+            nth_element(scores.begin(), scores.begin() + rank, scores.end());
+            cout << " p" << p << " " << scores[rank];
+        }
+        cout << endl;
+
+        // (the bars are 1, 2 or 5 times a power of 10 wide, from the lowest score to the highest)
+        int32_t low = *min_element(scores.begin(), scores.end());
+        int32_t high = *max_element(scores.begin(), scores.end());
+        int64_t width = 1;
+        for (int64_t scale = 1; width * SCORE_BARS <= (int64_t)high - low; scale *= 10)
+            for (int64_t step : { 1, 2, 5 })
+                if (width * SCORE_BARS <= (int64_t)high - low)
+                    width = step * scale;
+        int64_t start = (low >= 0) ? low / width * width : -((-(int64_t)low + width - 1) / width * width);
+        vector<int64_t> bars((size_t)(((int64_t)high - start) / width + 1), 0);
+        for (int32_t score : scores)
+            bars[(size_t)((score - start) / width)]++;
+        int64_t maxCount = *max_element(bars.begin(), bars.end());
+        for (size_t b = 0; b < bars.size(); b++)
+        {
+            int64_t barLow = start + (int64_t)b * width;
+            cout << "  " << setw(10) << barLow << " - " << setw(10) << barLow + width - 1 << " " << setw(8) << bars[b]
+                 << " " << Bar(bars[b], maxCount) << endl;
+        }
+    }
+
+
+    void ReportDroughts(const QueryStats& stats)
+    {
+        cout << endl << "DROUGHTS (pieces dealt between two pieces of the same type)" << endl;
+        cout << "  " << stats.nDealt << " pieces dealt" << endl;
+        cout << "  piece   dealt    mean  longest" << endl;
+        for (int8_t t = 0; t < CNT_TETRIMINOS; t++)
+        {
+            cout << "  " << Tetrimino(t).getTypeChar() << "     " << fixed << setprecision(1)
+                 << setw(6) << 100.0 * Ratio(stats.cntDealt[t], stats.nDealt) << "% "
+                 << setw(7) << Ratio(stats.nDroughtSum[t], stats.cntDealt[t]) << " "
+                 << setw(8) << stats.nLongest[t] << endl;
+        }
+
+        cout << "  I droughts:" << endl;
+        int32_t last = DROUGHT_BUCKETS - 1;
+        while (last > 0 && stats.droughtBuckets[last] == 0) last--;
+        int64_t maxCount = *max_element(stats.droughtBuckets, stats.droughtBuckets + DROUGHT_BUCKETS);
+        for (int32_t d = 0; d <= last; d++)
+        {
+            cout << "  " << setw(4) << d << ((d == DROUGHT_BUCKETS - 1) ? "+" : " ") << " " << setw(10)
+                 << stats.droughtBuckets[d] << " " << Bar(stats.droughtBuckets[d], maxCount) << endl;
+        }
+    }
+
+
+    void ReportTSpins(const QueryStats& stats)
+    {
+        int64_t cntTSpins = 0;
+        for (int32_t n = 0; n <= MAX_LINES_PER_LOCK; n++)
+            cntTSpins += stats.tspinLines[n];
+        cout << endl << "T-SPINS" << endl;
+        cout << "  " << cntTSpins << " T-Spins, " << stats.nTLocks << " T pieces locked, " << stats.nLocks
+             << " pieces locked" << endl;
+        cout << fixed << setprecision(2) << "  " << 100.0 * Ratio(cntTSpins, stats.nTLocks) << "% of the T pieces, "
+             << 100.0 * Ratio(cntTSpins, stats.nLocks) << "% of the locks, "
+             << Ratio(cntTSpins, stats.nSimulated) << " per game" << endl;
+        cout << "  lines: ";
+        for (int32_t n = 0; n < MAX_LINES_PER_LOCK; n++)
+            cout << " " << n << ": " << stats.tspinLines[n];
+        cout << endl;
+    }
+
+
+    void ReportClears(const QueryStats& stats)
+    {
+        cout << endl << "LINE CLEARS BY LEVEL" << endl;
+        cout << "  level     single     double     triple     tetris    lines/clear" << endl;
+        for (int32_t level = 0; level < CNT_LEVELS; level++)
+        {
+            const int64_t* pClears = stats.clears[level];
+            int64_t cntClears = 0, cntLines = 0;
+            for (int32_t n = 1; n <= MAX_LINES_PER_LOCK; n++) {
+                cntClears += pClears[n];
+                cntLines += n * pClears[n];
+            }
+            if (cntClears == 0)
+                continue;
+            cout << "  " << setw(4) << level << ((level == CNT_LEVELS - 1) ? "+" : " ");
+            for (int32_t n = 1; n <= MAX_LINES_PER_LOCK; n++)
+                cout << " " << setw(10) << pClears[n];
+            cout << "    " << fixed << setprecision(2) << Ratio(cntLines, cntClears) << endl;
+        }
+    }
+
+
+    uint32_t ParseQuery(const string& query)
+    {
+        if (query == "scores")      return QUERY_SCORES;
+        if (query == "droughts")    return QUERY_DROUGHTS;
+        if (query == "tspins")      return QUERY_TSPINS;
+        if (query == "clears")      return QUERY_CLEARS;
+        if (query == "all")         return QUERY_ALL;
+        return 0;
+    }
+
+
+    bool IsArchive(const string& path)
+    {
+        return path.size() > 4 && path.compare(path.size() - 4, 4, ".tra") == 0;
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    uint32_t queries = (argc > 1) ? ParseQuery(argv[1]) : 0;
+    vector<string> paths;
+    int32_t cntThreads = (int32_t)thread::hardware_concurrency();
+    for (int32_t i = 2; i < argc; i++)
+    {
+        if (IsArchive(argv[i]))
+            paths.push_back(argv[i]);
+        else if (i == argc - 1)
+            cntThreads = atoi(argv[i]);
+    }
+    if (queries == 0 || paths.empty()) {
+        cout << "usage: tetris_query <scores | droughts | tspins | clears | all> <archive.tra>... [threads]" << endl;
+        return 1;
+    }
+    cntThreads = (cntThreads > 0) ? cntThreads : 1;
+
+    // the games of all the archives, one after the other
+    vector<unique_ptr<TetrisReplayArchive>> archives;
+    vector<uint64_t> firstGames;
+    uint64_t cntGames = 0;
+    for (const string& path : paths)
+    {
+        archives.emplace_back(new TetrisReplayArchive());
+        if (!archives.back()->Open(path.c_str())) {
+            cout << "FAILED to open the archive " << path << " !!!" << endl;
+            return 1;
+        }
+        firstGames.push_back(cntGames);
+        cntGames += archives.back()->GetGameCount();
+    }
+
+    vector<QueryStats> partials((size_t)cntThreads);
+    atomic<uint64_t> nextChunk(0);
+    auto work = [&](int32_t worker) {
+        QueryStats& stats = partials[worker];
+        vector<int8_t> pieces;
+        for (uint64_t first = nextChunk++ * GAME_CHUNK; first < cntGames; first = nextChunk++ * GAME_CHUNK)
+        {
+            uint64_t last = min(first + GAME_CHUNK, cntGames);
+            for (uint64_t game = first; game < last; game++)
+            {
+                size_t a = (size_t)(upper_bound(firstGames.begin(), firstGames.end(), game) - firstGames.begin()) - 1;
+                ScanGame(*archives[a], game - firstGames[a], queries, pieces, stats);
+            }
+        }
+    };
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int32_t t = 1; t < cntThreads; t++)
+        threads.emplace_back(work, t);
+    work(0);
+    for (thread& th : threads)
+        th.join();
+    QueryStats& stats = partials[0];
+    for (int32_t t = 1; t < cntThreads; t++)
+        stats.Merge(partials[t]);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    seconds = (seconds > 0.0) ? seconds : 1e-9;
+
+    cout << stats.nGames << " games in " << archives.size() << " archive(s), " << stats.nSimulated
+         << " re-simulated (" << stats.nUpdates << " updates), on " << cntThreads << " thread(s) in "
+         << seconds << " s: " << (int64_t)(stats.nGames / seconds) << " games/s" << endl;
+    if (stats.nFailed > 0)
+        cout << stats.nFailed << " replays could not be read or re-simulated to their recorded end" << endl;
+    if ((queries & QUERY_SCORES) != 0)
+        ReportScores(stats);
+    if ((queries & QUERY_DROUGHTS) != 0)
+        ReportDroughts(stats);
+    if ((queries & QUERY_TSPINS) != 0)
+        ReportTSpins(stats);
+    if ((queries & QUERY_CLEARS) != 0)
+        ReportClears(stats);
+    return (stats.nFailed > 0) ? 2 : 0;
+}
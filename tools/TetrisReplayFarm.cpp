@@ -0,0 +1,315 @@
+//=======================
+//  tetris_replay: re-simulates directories of replays (TetrisReplay), without
+//  rendering, on all the cores; checks that every game ends with the score,
+//  lines and level it recorded (e.g. to validate high score submissions), and
+//  reports the mismatches and the replay speed (a benchmark of the whole
+//  engine: updates, locks and line clears).
+//  The replays of a directory are read into memory first: only the
+//  re-simulation is timed; those of an archive (a .tra file, see
+//  TetrisReplayArchive) are read in place, from the archive mapped in memory.
+//  Each worker takes the next replay (an atomic counter), with its own engine.
+//
+//  usage: tetris_replay verify <directory | archive.tra> [threads]
+//         tetris_replay record <directory | archive.tra> <games> [threads] [seed] [max pieces]
+//  (record: games of the heuristic AI, played as in the demo - one input per
+//  16 ms step - to build a corpus; appended to an archive in batches, game N
+//  of the run in batch N / BATCH_GAMES, committed in the order of the batches)
+//=======================
+#include "TetrisAI.h"
+#include "TetrisBot.h"
+#include "TetrisEngine.h"
+#include "TetrisReplay.h"
+#include "TetrisReplayArchive.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+
+namespace
+{
+    const int32_t STEP_TICKS = TetrisBotPlayer::FRAME_TICKS;
+    // games of a batch, appended to an archive with one commit
+    const int64_t BATCH_GAMES = 64;
+
+    bool IsArchive(const string& path)
+    {
+        return path.size() > 4 && path.compare(path.size() - 4, 4, ".tra") == 0;
+    }
+
+
+    bool MakeDirectory(const string& path)
+    {
+#ifdef _WIN32
+        return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+        return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+    }
+
+
+    bool ReadFile(const string& path, vector<uint8_t>& data)
+    {
+        FILE* pFile = fopen(path.c_str(), "rb");
+        if (pFile == nullptr)
+            return false;
+        data.clear();
+        uint8_t buffer[1 << 16];
+        size_t size;
+        while ((size = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+            data.insert(data.end(), buffer, buffer + size);
+        bool bOk = ferror(pFile) == 0;
+        fclose(pFile);
+        return bOk;
+    }
+
+
+
+    /////////////////////////////////////////////
+    //  VERIFY
+    /////////////////////////////////////////////
+
+    enum ReplayStatus { REPLAY_OK, REPLAY_MISMATCH, REPLAY_CORRUPT, REPLAY_UNREADABLE };
+
+    struct ReplayCheck
+    {
+        ReplayStatus status;
+        TetrisReplayResult recorded;
+        TetrisReplayResult replayed;
+        int64_t nUpdates;
+    };
+
+
+    ReplayCheck CheckReplay(const uint8_t* pData, size_t size)
+    {
+        ReplayCheck check = {};
+        TetrisReplayReader reader;
+        if (size == 0 || !reader.Open(pData, size)) {
+            check.status = REPLAY_UNREADABLE;
+            return check;
+        }
+        TetrisEngine engine = reader.CreateEngine();
+        bool bMatch = reader.PlayToEnd(engine);
+        check.nUpdates = reader.GetUpdateCount();
+        check.recorded = reader.GetResult();
+        check.replayed.nStateHash = engine.GetStateHash();
+        check.replayed.nScore = engine.GetScore();
+        check.replayed.nLines = engine.GetLines();
+        check.replayed.nLevel = engine.GetLevel();
+        check.status = bMatch ? REPLAY_OK : (reader.IsEnd() ? REPLAY_MISMATCH : REPLAY_CORRUPT);
+        return check;
+    }
+
+
+    int Verify(const string& path, int32_t cntThreads)
+    {
+        // the replays: (pointer, size), in memory or in the mapped archive
+        vector<string> names;
+        vector<vector<uint8_t>> files;
+        vector<pair<const uint8_t*, size_t>> replays;
+        TetrisReplayArchive archive;
+        int64_t cntBytes = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (IsArchive(path))
+        {
+            if (!archive.Open(path.c_str())) {
+                cout << "FAILED to open the archive " << path << " !!!" << endl;
+                return 1;
+            }
+            for (uint64_t i = 0; i < archive.GetGameCount(); i++) {
+                const TetrisArchiveEntry& entry = archive.GetEntry(i);
+                names.push_back("game " + to_string(entry.nGameId));
+                replays.push_back(make_pair(archive.GetReplay(entry), (size_t)entry.nLength));
+                cntBytes += entry.nLength;
+            }
+        }
+        else
+        {
+            names = ListReplayFiles(path.c_str());
+            files.resize(names.size());
+            for (size_t i = 0; i < names.size(); i++) {
+                ReadFile(path + "/" + names[i], files[i]);
+                replays.push_back(make_pair(files[i].data(), files[i].size()));
+                cntBytes += (int64_t)files[i].size();
+            }
+        }
+        double readSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << names.size() << " replays (" << cntBytes << " bytes) " << (IsArchive(path) ? "mapped" : "read")
+             << " in " << readSeconds << " s" << endl;
+
+        vector<ReplayCheck> checks(names.size());
+        atomic<size_t> nextReplay(0);
+        auto work = [&]() {
+            for (size_t i = nextReplay++; i < replays.size(); i = nextReplay++)
+                checks[i] = CheckReplay(replays[i].first, replays[i].second);
+        };
+        start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (int32_t t = 1; t < cntThreads; t++)
+            threads.emplace_back(work);
+        work();
+        for (thread& th : threads)
+            th.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        int64_t cntUpdates = 0, cntLines = 0;
+        int64_t cntStatus[REPLAY_UNREADABLE + 1] = {};
+        for (size_t i = 0; i < checks.size(); i++)
+        {
+            const ReplayCheck& c = checks[i];
+            cntUpdates += c.nUpdates;
+            cntLines += c.replayed.nLines;
+            cntStatus[c.status]++;
+            if (c.status == REPLAY_MISMATCH)
+            {
+                cout << "MISMATCH " << names[i] << ": recorded score " << c.recorded.nScore << " lines " << c.recorded.nLines
+                     << " level " << c.recorded.nLevel << ", replayed score " << c.replayed.nScore
+                     << " lines " << c.replayed.nLines << " level " << c.replayed.nLevel
+                     << ((c.recorded.nStateHash != c.replayed.nStateHash) ? " (state differs)" : "") << endl;
+            }
+            else if (c.status != REPLAY_OK)
+            {
+                cout << ((c.status == REPLAY_CORRUPT) ? "CORRUPT " : "UNREADABLE ") << names[i] << endl;
+            }
+        }
+
+        seconds = (seconds > 0.0) ? seconds : 1e-9;
+        cout << cntStatus[REPLAY_OK] << " ok, " << cntStatus[REPLAY_MISMATCH] << " mismatched, "
+             << cntStatus[REPLAY_CORRUPT] << " corrupt, " << cntStatus[REPLAY_UNREADABLE] << " unreadable" << endl;
+        cout << "replayed on " << cntThreads << " thread(s) in " << seconds << " s: "
+             << (int64_t)(checks.size() / seconds) << " games/s, " << (int64_t)(cntUpdates / seconds) << " updates/s, "
+             << (int64_t)(cntLines / seconds) << " lines/s" << endl;
+        return (cntStatus[REPLAY_OK] == (int64_t)checks.size()) ? 0 : 2;
+    }
+
+
+
+    /////////////////////////////////////////////
+    //  RECORD
+    /////////////////////////////////////////////
+
+    // A game of the heuristic AI, one input per step (as the demo plays it): returns the pieces
+    // hard-dropped by the safeguard of the real-time bot (none expected)
+    int64_t RecordGame(uint64_t seed, int32_t maxPieces, TetrisReplayRecorder& recorder)
+    {
+        TetrisRules rules = { 1, 0, 0, 0 };
+        TetrisEngine engine(rules, seed);
+        TetrisAI bot;
+        TetrisBotPlayer player;
+        bot.NewGame(seed);
+        recorder.Start(rules, seed);
+        int32_t cntPieces = 0;
+        while (!engine.IsGameOver() && cntPieces < maxPieces)
+        {
+            bool bSpawn = engine.IsSpawnPending();
+            TetrisInput input = player.NextInput(engine, bot);
+            recorder.Record(input, STEP_TICKS);
+            engine.UpdateGame(input, STEP_TICKS);
+            recorder.RecordKeyframe(engine);
+            if (bSpawn && !engine.IsSpawnPending())
+                cntPieces++;
+        }
+        recorder.Finish(engine);
+        return player.GetForcedDropCount();
+    }
+
+
+    int Record(const string& path, int64_t cntGames, int32_t cntThreads, uint64_t seed, int32_t maxPieces)
+    {
+        bool bArchive = IsArchive(path);
+        TetrisReplayArchiveWriter writer;
+        if (bArchive ? !writer.Open(path.c_str()) : !MakeDirectory(path)) {
+            cout << "FAILED to create " << path << " !!!" << endl;
+            return 1;
+        }
+        atomic<int64_t> nextGame(0);
+        atomic<int64_t> cntBytes(0), cntFailed(0), cntForced(0);
+        auto work = [&]() {
+            TetrisReplayRecorder recorder;
+            if (!bArchive)
+            {
+                for (int64_t game = nextGame++; game < cntGames; game = nextGame++)
+                {
+                    cntForced += RecordGame(seed + (uint64_t)game, maxPieces, recorder);
+                    char name[64];
+                    snprintf(name, sizeof(name), "/game_%08lld.trp", (long long)game);
+                    if (!recorder.Save((path + name).c_str()))
+                        cntFailed++;
+                    cntBytes += (int64_t)recorder.GetData().size();
+                }
+                return;
+            }
+            // (the tickets are the batch numbers: every ticket is committed, even past the last game)
+            TetrisReplayBatch batch;
+            for (;;)
+            {
+                uint64_t ticket = writer.TakeTicket();
+                int64_t first = (int64_t)ticket * BATCH_GAMES;
+                for (int64_t game = first; game < first + BATCH_GAMES && game < cntGames; game++)
+                {
+                    cntForced += RecordGame(seed + (uint64_t)game, maxPieces, recorder);
+                    batch.Add(recorder);
+                    cntBytes += (int64_t)recorder.GetData().size();
+                }
+                int64_t cntBatchGames = (int64_t)batch.GetGameCount();
+                if (!writer.Commit(batch, ticket))
+                    cntFailed += cntBatchGames;
+                if (first + BATCH_GAMES >= cntGames)
+                    break;
+            }
+        };
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (int32_t t = 1; t < cntThreads; t++)
+            threads.emplace_back(work);
+        work();
+        for (thread& th : threads)
+            th.join();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << cntGames << " games recorded in " << seconds << " s, " << cntBytes << " bytes";
+        if (cntFailed > 0)
+            cout << " (" << cntFailed << " could not be written)";
+        cout << endl;
+        if (cntForced > 0)
+            cout << cntForced << " piece(s) hard-dropped by the safeguard of the bot !!!" << endl;
+        return (cntFailed > 0) ? 1 : 0;
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    string mode = (argc > 1) ? argv[1] : "";
+    if (argc < 3 || (mode != "verify" && mode != "record") || (mode == "record" && argc < 4)) {
+        cout << "usage: tetris_replay verify <directory> [threads]" << endl;
+        cout << "       tetris_replay record <directory> <games> [threads] [seed] [max pieces]" << endl;
+        return 1;
+    }
+
+    if (mode == "verify")
+    {
+        int32_t cntThreads = (argc > 3) ? atoi(argv[3]) : (int32_t)thread::hardware_concurrency();
+        return Verify(argv[2], (cntThreads > 0) ? cntThreads : 1);
+    }
+    int64_t cntGames = atoll(argv[3]);
+    int32_t cntThreads = (argc > 4) ? atoi(argv[4]) : (int32_t)thread::hardware_concurrency();
+    uint64_t seed = (argc > 5) ? strtoull(argv[5], nullptr, 10) : 1;
+    int32_t maxPieces = (argc > 6) ? atoi(argv[6]) : 1000;
+    return Record(argv[2], cntGames, (cntThreads > 0) ? cntThreads : 1, seed, maxPieces);
+}
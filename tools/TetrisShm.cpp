@@ -0,0 +1,133 @@
+//=======================
+//  tetris_shm: headless games for a trainer in another process, through a
+//  shared memory channel (TetrisShmEnvChannel: observations and actions in
+//  two lock-free rings, read and written in place).
+//  serve: creates the channel (e.g. in /dev/shm) and runs the games, until the
+//         trainer closes the channel
+//  learn: a stand-in trainer: reads the observations, answers random actions,
+//         and reports the transitions per second (then closes the channel)
+//
+//  usage: tetris_shm serve <path> [environments per batch] [batches] [threads] [seed]
+//         tetris_shm learn <path> [batch steps] [seed]
+//=======================
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisRandom.h"
+#include "TetrisShmEnv.h"
+#include "TetrisThreadPool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+
+namespace
+{
+    int Serve(const char* pPath, int32_t cntEnvs, int32_t cntBatches, int32_t cntThreads, uint64_t seed)
+    {
+        TetrisShmEnvChannel channel;
+        if (!channel.Create(pPath, cntEnvs, cntBatches)) {
+            cerr << "cannot create the channel " << pPath << endl;
+            return 1;
+        }
+        // (the serving thread steps environments too)
+        unique_ptr<TetrisThreadPool> pPool((cntThreads > 1) ? new TetrisThreadPool(cntThreads - 1) : nullptr);
+        TetrisRules rules = { 1, 0, 0, 0 };
+        TetrisShmEnvServer server(channel, rules, seed, nullptr, pPool.get());
+        cout << "serving " << cntBatches << " x " << cntEnvs << " environments on " << pPath
+             << " (session " << hex << channel.GetHeader().nSessionId << dec << ")" << endl;
+        int64_t cntSteps = server.Run(0);
+        cout << cntSteps << " batch steps served" << endl;
+        // (the channel file is removed as the channel goes)
+        return 0;
+    }
+
+
+    int Learn(const char* pPath, int64_t maxSteps, uint64_t seed)
+    {
+        // (the games may not have created the channel yet: a channel left closed by a previous run
+        // is not opened, the next run replaces it)
+        TetrisShmEnvChannel channel;
+        for (int32_t attempt = 0; !channel.Open(pPath); attempt++)
+        {
+            if (attempt == 100) {
+                cerr << "cannot open the channel " << pPath << endl;
+                return 1;
+            }
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        const TetrisShmEnvHeader& header = channel.GetHeader();
+        int32_t cntEnvs = (int32_t)header.nCntEnvs;
+        cout << "learning on " << pPath << " (session " << hex << header.nSessionId << dec << ")" << endl;
+
+        TetrisRng rng;
+        rng.Seed(seed);
+        int64_t cntSteps = 0, cntEpisodes = 0;
+        double totalReward = 0.0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        while (cntSteps < maxSteps)
+        {
+            const uint8_t* pObs = channel.WaitRead(channel.GetObservations());
+            uint8_t* pActionSlot = (pObs != nullptr) ? channel.WaitWrite(channel.GetActions()) : nullptr;
+            if (pActionSlot == nullptr)
+                break;
+
+            // (read in place, as a trainer would map the arrays)
+            const TetrisShmSlotHeader* pObsHeader = reinterpret_cast<const TetrisShmSlotHeader*>(pObs);
+            const float* pRewards = reinterpret_cast<const float*>(pObs + header.nRewardsOffset);
+            const uint8_t* pDones = pObs + header.nDonesOffset;
+            for (int32_t i = 0; i < cntEnvs; i++) {
+                totalReward += pRewards[i];
+                cntEpisodes += pDones[i];
+            }
+
+            reinterpret_cast<TetrisShmSlotHeader*>(pActionSlot)->nBatch = pObsHeader->nBatch;
+            uint8_t* pActions = pActionSlot + header.nActionsOffset;
+            for (int32_t i = 0; i < cntEnvs; i++) {
+                uint32_t r = rng.NextBelow(2 * CNT_ACTIONS);
+                pActions[i] = (r < (uint32_t)CNT_ACTIONS) ? (uint8_t)(1 << r) : 0;
+            }
+            channel.GetActions().EndWrite();
+            channel.GetObservations().EndRead();
+            cntSteps++;
+        }
+        channel.Close();
+
+        int64_t micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        int64_t transitions = cntSteps * cntEnvs;
+        cout << cntSteps << " batch steps of " << cntEnvs << " environments: "
+             << (int64_t)(transitions * 1e6 / (micros > 0 ? micros : 1)) << " transitions/s" << endl;
+        cout << cntEpisodes << " episodes finished, total reward " << (int64_t)totalReward << endl;
+        return 0;
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    string command = (argc > 1) ? argv[1] : "";
+    if (argc < 3 || (command != "serve" && command != "learn"))
+    {
+        cerr << "usage: tetris_shm serve <path> [environments per batch] [batches] [threads] [seed]" << endl;
+        cerr << "       tetris_shm learn <path> [batch steps] [seed]" << endl;
+        return 1;
+    }
+    if (command == "serve")
+    {
+        int32_t cntEnvs = (argc > 3) ? atoi(argv[3]) : 256;
+        int32_t cntBatches = (argc > 4) ? atoi(argv[4]) : 2;
+        int32_t cntThreads = (argc > 5) ? atoi(argv[5]) : (int32_t)thread::hardware_concurrency();
+        uint64_t seed = (argc > 6) ? strtoull(argv[6], nullptr, 10) : 1;
+        return Serve(argv[2], cntEnvs, cntBatches, cntThreads, seed);
+    }
+    int64_t maxSteps = (argc > 3) ? atoll(argv[3]) : 10000;
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 1;
+    return Learn(argv[2], maxSteps, seed);
+}
@@ -0,0 +1,242 @@
+//=======================
+//  tetris_tournament: round-robin tournament between bots.
+//  A match plays the same piece sequences (seeds) with both bots; the bot with
+//  the higher score wins each game. Matches and their games (sub-tasks) run on
+//  a work-stealing thread pool, so the short games of weak bots and the long
+//  games of strong (and slow) bots keep all the cores busy until the end.
+//
+//  usage: tetris_tournament [games per match] [max pieces] [threads] [seed]
+//=======================
+#include "TetrisAI.h"
+#include "TetrisBeamSearch.h"
+#include "TetrisBoard.h"
+#include "TetrisBot.h"
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisMoveGen.h"
+#include "TetrisThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+
+namespace
+{
+    //=======================
+    //  Tournament bots (besides the greedy one and the heuristic AI)
+    //=======================
+
+    // Plays any legal move
+    class RandomBot : public TetrisBot
+    {
+    public:
+        const char* GetName() const override    { return "Random"; }
+        void NewGame(uint64_t seed) override    { m_Rng.Seed(seed); }
+
+        int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) override
+        {
+            return (int32_t)m_Rng.NextBelow((uint32_t)cntMoves);
+        }
+
+    private:
+        TetrisRng m_Rng;
+    };
+
+
+    // Board after a piece locked (full lines removed)
+    TetrisBoard BoardAfterLock(const TetrisBoard& board, const TetroPlacement& placement, int32_t* pCntLines)
+    {
+        TetrisBoard after = board;
+        after.PlacePiece(Tetrimino(placement));
+        int32_t fullLines[TABLE_HEIGHT_TILES];
+        *pCntLines = after.FindFullLines(fullLines);
+        after.RemoveLines(fullLines, *pCntLines);
+        return after;
+    }
+
+
+    // Column heights, holes and bumpiness (the higher, the better)
+    int32_t EvaluateBoard(const TetrisBoard& board)
+    {
+        int32_t heights[TABLE_WIDTH_TILES] = {};
+        int32_t holes = 0;
+        for (int32_t y = -EXTRA_HEIGHT_TILES; y < TABLE_HEIGHT_TILES; y++)
+        {
+            uint16_t row = board.GetRowMask(y);
+            for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++)
+            {
+                bool occupied = ((row >> x) & 0x01) != 0;
+                if (occupied && heights[x] == 0)
+                    heights[x] = TABLE_HEIGHT_TILES - y;
+                else if (!occupied && heights[x] > 0)
+                    holes++;
+            }
+        }
+        int32_t sumHeights = 0, bumpiness = 0;
+        for (int32_t x = 0; x < TABLE_WIDTH_TILES; x++) {
+            sumHeights += heights[x];
+            if (x > 0)
+                bumpiness += abs(heights[x] - heights[x - 1]);
+        }
+        return -(sumHeights * 5 + holes * 36 + bumpiness * 2);
+    }
+
+
+    // Evaluates each move with the best move of the next piece (2 plies: slow, but much stronger)
+    class LookaheadBot : public TetrisBot
+    {
+    public:
+        const char* GetName() const override    { return "Lookahead"; }
+
+        int32_t ChooseMove(const TetrisEngine& engine, const TetrisMove* pMoves, int32_t cntMoves) override
+        {
+            Tetrimino nextPiece(engine.GetNextPiece(0).getTypeIndex());
+            int32_t bestIdx = 0, bestScore = INT32_MIN;
+            for (int32_t i = 0; i < cntMoves; i++)
+            {
+                int32_t cntLines;
+                TetrisBoard board = BoardAfterLock(engine.GetBoard(), pMoves[i].placement, &cntLines);
+                int32_t cntNextMoves = m_MoveGen.Generate(board, nextPiece, m_NextMoves, TetrisMoveGen::MAX_MOVES);
+                int32_t score = INT32_MIN + 1;
+                for (int32_t j = 0; j < cntNextMoves; j++)
+                {
+                    int32_t cntNextLines;
+                    TetrisBoard nextBoard = BoardAfterLock(board, m_NextMoves[j].placement, &cntNextLines);
+                    int32_t s = EvaluateBoard(nextBoard) + (cntLines + cntNextLines) * 20;
+                    score = (s > score) ? s : score;
+                }
+                if (score > bestScore) {
+                    bestIdx = i, bestScore = score;
+                }
+            }
+            return bestIdx;
+        }
+
+    private:
+        TetrisMoveGen m_MoveGen;
+        TetrisMove m_NextMoves[TetrisMoveGen::MAX_MOVES];
+    };
+
+
+    const int32_t CNT_BOTS = 5;
+    // (no time budget: the results don't depend on the load of the machine)
+    const int32_t BEAM_WIDTH = 16;
+
+    // (the beam search expands its nodes on the pool, if any)
+    TetrisBot* CreateBot(int32_t botIdx, TetrisThreadPool* pPool)
+    {
+        switch (botIdx)
+        {
+        case 0:     return new RandomBot();
+        case 1:     return new TetrisGreedyBot();
+        case 2:     return new LookaheadBot();
+        case 3:     return new TetrisAI();
+        default:    return new TetrisBeamBot(BEAM_WIDTH, 0, pPool);
+        }
+    }
+
+
+
+    //=======================
+    //  Tournament
+    //=======================
+    struct MatchResult
+    {
+        int32_t botA, botB;
+        atomic<int32_t> nWinsA, nWinsB;
+        atomic<int64_t> nScoreA, nScoreB;
+    };
+
+
+    int32_t PlayGame(TetrisThreadPool& pool, int32_t botIdx, uint64_t seed, int32_t maxPieces)
+    {
+        unique_ptr<TetrisBot> pBot(CreateBot(botIdx, &pool));
+        unique_ptr<TetrisBotPlayer> pPlayer(new TetrisBotPlayer());
+        TetrisRules rules = { 1, 0, 0, 0 };
+        TetrisEngine engine(rules, seed);
+        pBot->NewGame(seed);
+        return pPlayer->PlayGame(engine, *pBot, maxPieces).nScore;
+    }
+
+
+    // A match: one sub-task per game, then the results are compared
+    void PlayMatch(TetrisThreadPool& pool, MatchResult& match, int32_t cntGames, int32_t maxPieces, uint64_t seed)
+    {
+        vector<int32_t> scoresA(cntGames), scoresB(cntGames);
+        TetrisTaskGroup games;
+        for (int32_t g = 0; g < cntGames; g++)
+        {
+            uint64_t gameSeed = seed + (uint64_t)g;
+            pool.Submit([&, g, gameSeed]() { scoresA[g] = PlayGame(pool, match.botA, gameSeed, maxPieces); }, &games);
+            pool.Submit([&, g, gameSeed]() { scoresB[g] = PlayGame(pool, match.botB, gameSeed, maxPieces); }, &games);
+        }
+        pool.Wait(games);
+
+        for (int32_t g = 0; g < cntGames; g++) {
+            match.nWinsA += (scoresA[g] > scoresB[g]) ? 1 : 0;
+            match.nWinsB += (scoresB[g] > scoresA[g]) ? 1 : 0;
+            match.nScoreA += scoresA[g];
+            match.nScoreB += scoresB[g];
+        }
+    }
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    int32_t cntGames = (argc > 1) ? atoi(argv[1]) : 8;
+    int32_t maxPieces = (argc > 2) ? atoi(argv[2]) : 500;
+    int32_t cntThreads = (argc > 3) ? atoi(argv[3]) : 0;
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 1;
+
+    TetrisThreadPool pool(cntThreads);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // round robin: every pair of bots plays a match
+    vector<unique_ptr<MatchResult>> matches;
+    for (int32_t a = 0; a < CNT_BOTS; a++) {
+        for (int32_t b = a + 1; b < CNT_BOTS; b++) {
+            MatchResult* pMatch = new MatchResult();
+            pMatch->botA = a, pMatch->botB = b;
+            pMatch->nWinsA = pMatch->nWinsB = 0;
+            pMatch->nScoreA = pMatch->nScoreB = 0;
+            matches.emplace_back(pMatch);
+        }
+    }
+    TetrisTaskGroup allMatches;
+    for (unique_ptr<MatchResult>& pMatch : matches) {
+        MatchResult* p = pMatch.get();
+        pool.Submit([&pool, p, cntGames, maxPieces, seed]() { PlayMatch(pool, *p, cntGames, maxPieces, seed); }, &allMatches);
+    }
+    pool.Wait(allMatches);
+    int64_t wallMicros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+    // results
+    for (unique_ptr<MatchResult>& pMatch : matches)
+    {
+        unique_ptr<TetrisBot> pBotA(CreateBot(pMatch->botA, nullptr)), pBotB(CreateBot(pMatch->botB, nullptr));
+        cout << setw(12) << pBotA->GetName() << " vs " << left << setw(12) << pBotB->GetName() << right
+             << "  " << pMatch->nWinsA << " - " << pMatch->nWinsB
+             << "   (avg scores " << pMatch->nScoreA / cntGames << " / " << pMatch->nScoreB / cntGames << ")" << endl;
+    }
+
+    // utilisation of the workers
+    cout << "total time: " << wallMicros / 1000 << " ms" << endl;
+    for (int32_t w = 0; w < pool.GetThreadCount(); w++)
+    {
+        TetrisThreadPool::WorkerStats stats = pool.GetWorkerStats(w);
+        cout << "worker " << setw(2) << w << ": " << setw(5) << stats.nTasks << " tasks, " << setw(4) << stats.nSteals
+             << " stolen, busy " << fixed << setprecision(1) << (100.0 * stats.nBusyMicros / wallMicros) << "%" << endl;
+        cout.unsetf(ios::fixed);
+    }
+    return 0;
+}
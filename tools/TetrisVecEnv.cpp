@@ -0,0 +1,76 @@
+//=======================
+//  tetris_vecenv: stepping speed of the vectorized environment (VecTetrisEnv).
+//  Steps N environments with random actions (one key pressed every other
+//  step, on average), as a reinforcement learning trainer would, and reports
+//  the environment steps per second and the episodes played.
+//
+//  usage: tetris_vecenv [environments] [steps] [threads] [seed]
+//=======================
+#include "TetrisConstants.h"
+#include "TetrisEngine.h"
+#include "TetrisRandom.h"
+#include "TetrisThreadPool.h"
+#include "VecTetrisEnv.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+
+int main(int argc, char* argv[])
+{
+    int32_t cntEnvs = (argc > 1) ? atoi(argv[1]) : 1024;
+    int32_t cntSteps = (argc > 2) ? atoi(argv[2]) : 2000;
+    int32_t cntThreads = (argc > 3) ? atoi(argv[3]) : (int32_t)thread::hardware_concurrency();
+    uint64_t seed = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 1;
+    cntEnvs = (cntEnvs > 0) ? cntEnvs : 1;
+
+    // (the calling thread steps environments too)
+    unique_ptr<TetrisThreadPool> pPool((cntThreads > 1) ? new TetrisThreadPool(cntThreads - 1) : nullptr);
+    TetrisRules rules = { 1, 0, 0, 0 };
+    VecTetrisEnv env(cntEnvs, rules, seed, nullptr, pPool.get());
+
+    // the buffers of a trainer
+    vector<uint16_t> boards((size_t)cntEnvs * VecTetrisEnv::CNT_BOARD_PLANES * TABLE_HEIGHT_TILES);
+    vector<int8_t> pieces((size_t)cntEnvs * VecTetrisEnv::CNT_OBS_PIECES);
+    vector<int32_t> stats((size_t)cntEnvs * VecTetrisEnv::CNT_STATS);
+    vector<float> rewards(cntEnvs);
+    vector<uint8_t> dones(cntEnvs);
+    vector<uint8_t> actions(cntEnvs);
+    VecTetrisBuffers buffers = { boards.data(), pieces.data(), stats.data(), rewards.data(), dones.data() };
+    env.Reset(buffers);
+
+    TetrisRng rng;
+    rng.Seed(seed);
+    int64_t cntEpisodes = 0;
+    double totalReward = 0.0;
+    int64_t stepMicros = 0;
+    for (int32_t step = 0; step < cntSteps; step++)
+    {
+        for (int32_t i = 0; i < cntEnvs; i++) {
+            uint32_t r = rng.NextBelow(2 * CNT_ACTIONS);
+            actions[i] = (r < (uint32_t)CNT_ACTIONS) ? (uint8_t)(1 << r) : 0;
+        }
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        env.Step(actions.data(), buffers);
+        stepMicros += chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        for (int32_t i = 0; i < cntEnvs; i++) {
+            cntEpisodes += dones[i];
+            totalReward += rewards[i];
+        }
+    }
+
+    int64_t envSteps = (int64_t)cntEnvs * cntSteps;
+    cout << cntEnvs << " environments x " << cntSteps << " steps, "
+         << ((pPool != nullptr) ? pPool->GetThreadCount() + 1 : 1) << " thread(s)" << endl;
+    cout << (int64_t)(envSteps * 1e6 / (stepMicros > 0 ? stepMicros : 1)) << " environment steps/s" << endl;
+    cout << cntEpisodes << " episodes finished, total reward " << (int64_t)totalReward << endl;
+    return 0;
+}